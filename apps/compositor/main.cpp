@@ -66,11 +66,12 @@ int main(int argc, char const *argv[])
     }
 
     EventLoop::initialize();
+    EventLoop::use_ring();
 
     IO::File keyboard_stream{KEYBOARD_DEVICE_PATH, OPEN_READ};
     IO::File mouse_stream{MOUSE_DEVICE_PATH, OPEN_READ};
 
-    IO::Socket socket{"/Session/compositor.ipc", OPEN_CREATE};
+    IO::Socket socket{"/Session/compositor.ipc", OPEN_CREATE | OPEN_SEQPACKET};
 
     auto keyboard_notifier = own<Notifier>(keyboard_stream, POLL_READ, [&]() {
         KeyboardPacket packet;
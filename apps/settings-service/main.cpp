@@ -12,6 +12,7 @@ int main(int argc, const char **argv)
     logger_info("Initializing setting-service...");
 
     EventLoop::initialize();
+    EventLoop::use_ring();
 
     logger_info("Loading settings...");
 
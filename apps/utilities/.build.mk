@@ -34,6 +34,7 @@ UTILITIES = \
 	SYSFETCH \
 	TAC \
 	TOUCH \
+	TRACE \
 	TRUE \
 	UNAME \
 	UNLINK \
@@ -120,6 +121,9 @@ SYSFETCH_NAME = sysfetch
 TAC_LIBS = system io
 TAC_NAME = tac
 
+TRACE_LIBS = system io
+TRACE_NAME = trace
+
 TOUCH_LIBS = system io
 TOUCH_NAME = touch
 
@@ -0,0 +1,230 @@
+#include <abi/Paths.h>
+#include <abi/Syscalls.h>
+#include <abi/Trace.h>
+
+#include <libutils/ArgParse.h>
+#include <libutils/NumberFormat.h>
+
+#include <libio/Copy.h>
+#include <libio/File.h>
+#include <libio/Streams.h>
+
+#define TRACE_NAMES_ENTRY(__entry) #__entry,
+static const char *_syscall_names[] = {SYSCALL_LIST(TRACE_NAMES_ENTRY)};
+
+static const char *syscall_name(uint32_t syscall)
+{
+    if (syscall >= __SYSCALL_COUNT)
+    {
+        return "HJ_UNKNOWN";
+    }
+
+    return _syscall_names[syscall];
+}
+
+// Chrome wants microseconds, keep the nanoseconds as decimals.
+static void trace_write_timestamp(uint64_t nanoseconds)
+{
+    NumberFormat::decimal().format(IO::out(), nanoseconds / 1000);
+
+    uint64_t decimals = nanoseconds % 1000;
+
+    char buffer[] = {
+        '.',
+        (char)('0' + decimals / 100),
+        (char)('0' + decimals / 10 % 10),
+        (char)('0' + decimals % 10),
+    };
+
+    IO::out().write(buffer, sizeof(buffer));
+}
+
+static bool _first_event = true;
+
+static void trace_begin_event(const char *phase, int pid, int tid, uint64_t timestamp)
+{
+    IO::out(_first_event ? "\n" : ",\n");
+    _first_event = false;
+
+    // Braces are only literal after the last argument of a format string.
+    IO::out("{\"ph\":\"");
+    IO::out("{}\",\"pid\":{},\"tid\":{},\"ts\":", phase, pid, tid);
+    trace_write_timestamp(timestamp);
+}
+
+static void trace_begin_args()
+{
+    IO::out(",\"args\":");
+    IO::out("{");
+}
+
+// Processors are shown as the first process, with the tasks they ran as
+// slices, and tasks as the second one with their syscalls and wakeups.
+#define TRACE_PID_CPUS 0
+#define TRACE_PID_TASKS 1
+#define TRACE_MAX_CPUS 256
+
+static void trace_dump_record(const TraceRecord &record, uint64_t *running_since)
+{
+    switch (record.event)
+    {
+    case TRACE_EVENT_SWITCH:
+    {
+        if (record.cpu >= TRACE_MAX_CPUS)
+        {
+            return;
+        }
+
+        // The first switch of each processor only tells when it started.
+        uint64_t since = running_since[record.cpu];
+        running_since[record.cpu] = record.timestamp;
+
+        if (since == 0)
+        {
+            return;
+        }
+
+        trace_begin_event("X", TRACE_PID_CPUS, record.cpu, since);
+        IO::out(",\"dur\":");
+        trace_write_timestamp(record.timestamp - since);
+        IO::out(",\"name\":\"task {}\"", record.task);
+        trace_begin_args();
+        IO::out("\"next\":{},\"state\":{}}}", (int)record.arg0, record.arg1);
+        break;
+    }
+
+    case TRACE_EVENT_BLOCK:
+        trace_begin_event("i", TRACE_PID_TASKS, record.task, record.timestamp);
+        IO::out(",\"s\":\"t\",\"name\":\"block\"");
+        trace_begin_args();
+        IO::out("\"timeout\":{}}}", (int)record.arg0);
+        break;
+
+    case TRACE_EVENT_UNBLOCK:
+        trace_begin_event("i", TRACE_PID_TASKS, record.task, record.timestamp);
+        IO::out(",\"s\":\"t\",\"name\":\"unblock\"");
+        trace_begin_args();
+        IO::out("\"result\":{}}}", record.arg0);
+        break;
+
+    case TRACE_EVENT_SYSCALL_ENTER:
+        trace_begin_event("B", TRACE_PID_TASKS, record.task, record.timestamp);
+        IO::out(",\"name\":\"{}\"}", syscall_name(record.arg0));
+        break;
+
+    case TRACE_EVENT_SYSCALL_EXIT:
+        trace_begin_event("E", TRACE_PID_TASKS, record.task, record.timestamp);
+        IO::out(",\"name\":\"{}\"", syscall_name(record.arg0));
+        trace_begin_args();
+        IO::out("\"result\":\"{}\"}}", get_result_description((Result)record.arg1));
+        break;
+
+    case TRACE_EVENT_INTERRUPT:
+        trace_begin_event("i", TRACE_PID_CPUS, record.cpu, record.timestamp);
+        IO::out(",\"s\":\"t\",\"name\":\"irq {}\"", record.arg0);
+        trace_begin_args();
+        IO::out("\"task\":{}}}", record.task);
+        break;
+
+    default:
+        break;
+    }
+}
+
+int trace_dump()
+{
+    // The records are captured when the node is opened.
+    IO::File file{TRACE_PATH, OPEN_READ};
+    auto read_all_result = IO::read_all(file);
+
+    if (!read_all_result.success())
+    {
+        IO::errln("trace: Failed to read the trace: {}", read_all_result.description());
+        return PROCESS_FAILURE;
+    }
+
+    auto records = reinterpret_cast<const TraceRecord *>(read_all_result.value().start());
+    size_t count = read_all_result.value().size() / sizeof(TraceRecord);
+
+    uint64_t running_since[TRACE_MAX_CPUS] = {};
+
+    IO::out("{\"traceEvents\":[");
+
+    for (size_t i = 0; i < count; i++)
+    {
+        trace_dump_record(records[i], running_since);
+    }
+
+    IO::outln("\n]}");
+
+    return PROCESS_SUCCESS;
+}
+
+int trace_call(IOCall request, IOCallTraceStateArgs *args)
+{
+    auto trace_handle = make<IO::Handle>(TRACE_PATH, OPEN_READ);
+
+    if (!trace_handle->valid())
+    {
+        IO::errln("trace: Failed to open the trace device");
+        return PROCESS_FAILURE;
+    }
+
+    auto call_result = trace_handle->call(request, args);
+
+    if (call_result != SUCCESS)
+    {
+        IO::errln("trace: {}", get_result_description(call_result));
+        return PROCESS_FAILURE;
+    }
+
+    return PROCESS_SUCCESS;
+}
+
+int main(int argc, const char *argv[])
+{
+    ArgParse args{};
+    args.should_abort_on_failure();
+    args.show_help_if_no_option_given();
+
+    args.prologue("Record scheduler, syscall and interrupt events, and dump them in the Chrome trace format");
+
+    args.usage("");
+    args.usage("OPTION...");
+
+    args.epiloge("Options can be combined, the size can only be changed while stopped.");
+
+    args.option('s', "start", "Start recording events.", [&](auto &) {
+        return trace_call(IOCALL_TRACE_START, nullptr);
+    });
+
+    args.option('x', "stop", "Stop recording events.", [&](auto &) {
+        return trace_call(IOCALL_TRACE_STOP, nullptr);
+    });
+
+    args.option_int('n', "size", "Set the number of events kept per processor.", [&](int size) {
+        IOCallTraceStateArgs state = {};
+        state.size = size;
+
+        return trace_call(IOCALL_TRACE_SET_SIZE, &state);
+    });
+
+    args.option('i', "info", "Show if events are being recorded and how many are kept.", [&](auto &) {
+        IOCallTraceStateArgs state = {};
+
+        int result = trace_call(IOCALL_TRACE_GET_STATE, &state);
+
+        if (result == PROCESS_SUCCESS)
+        {
+            IO::outln("{} events per processor, {}", state.size, state.running ? "running" : "stopped");
+        }
+
+        return result;
+    });
+
+    args.option('d', "dump", "Write the recorded events to the standard output.", [&](auto &) {
+        return trace_dump();
+    });
+
+    return args.eval(argc, argv);
+}
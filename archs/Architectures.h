@@ -8,10 +8,19 @@ void arch_disable_interrupts();
 
 void arch_enable_interrupts();
 
+bool arch_interrupts_enabled();
+
 void arch_halt();
 
+// Enable the interrupts and wait for the next one,
+// one coming in between can't be missed.
+void arch_idle();
+
 void arch_yield();
 
+// Give a new task a clean processor context (FPU...).
+void arch_initialize_context(Task *task);
+
 void arch_save_context(Task *task);
 
 void arch_load_context(Task *task);
@@ -22,6 +31,32 @@ size_t arch_debug_write(const void *buffer, size_t size);
 
 TimeStamp arch_get_time();
 
+uint64_t arch_get_cycles();
+
+// Calibrate the clock and switch to the best timer available,
+// called once the interrupts are enabled.
+void arch_timer_initialize();
+
+// Monotonic clock, valid once system_clock_start() was called by the arch.
+uint64_t arch_get_nanoseconds();
+
+// Fire the next timer interrupt of this processor when the clock reaches
+// `nanoseconds`, or as late as possible if it is -1.
+// Does nothing if the timer is periodic.
+void arch_timer_oneshot(uint64_t nanoseconds);
+
+// Index of the processor running this code, see kernel/system/CPU.h.
+int arch_cpu_current();
+
+// Bring up the application processors, called once the interrupts are enabled.
+void arch_cpu_start_others();
+
+// Interrupt an idle processor, so it looks at its run queue again.
+void arch_cpu_wake(int cpu);
+
+// Halt every other processors, used when panicking.
+void arch_cpu_stop_others();
+
 __no_return void arch_reboot();
 
 __no_return void arch_shutdown();
@@ -12,6 +12,10 @@ void arch_virtual_initialize();
 
 void arch_virtual_memory_enable();
 
+// Size of the pages mapping a whole aligned and physically contiguous run of
+// user memory with a single entry, zero if the processor doesn't have them.
+size_t arch_large_page_size();
+
 bool arch_virtual_present(void *address_space, uintptr_t virtual_address);
 
 uintptr_t arch_virtual_to_physical(void *address_space, uintptr_t virtual_address);
@@ -20,6 +24,11 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
 
 MemoryRange arch_virtual_alloc(void *address_space, MemoryRange physical_range, MemoryFlags flags);
 
+// Reserve free virtual memory without mapping anything, so pages can be mapped in later.
+MemoryRange arch_virtual_reserve(void *address_space, size_t size, MemoryFlags flags);
+
+void arch_virtual_reserve_at(void *address_space, MemoryRange virtual_range);
+
 void arch_virtual_free(void *address_space, MemoryRange virtual_range);
 
 void *arch_address_space_create();
@@ -1,4 +1,4 @@
-#include "kernel/interrupts/Interupts.h"
+#include "kernel/system/Spinlock.h"
 
 #include "archs/x86/kernel/COM.h"
 #include "archs/x86_32/kernel/x86_32.h"
@@ -39,9 +39,12 @@ char com_getc(COMPort port)
     return in8(port);
 }
 
+// Also used by the logger, so it can't take the big kernel lock.
+static Spinlock _com_lock{"com"};
+
 size_t com_write(COMPort port, const void *buffer, size_t size)
 {
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(_com_lock);
 
     for (size_t i = 0; i < size; i++)
     {
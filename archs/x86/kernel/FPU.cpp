@@ -1,6 +1,23 @@
 #include <string.h>
 
 #include "archs/x86/kernel/FPU.h"
+#include "archs/x86/kernel/x86.h"
+
+#include "kernel/system/CPU.h"
+
+#define CR0_TS (1 << 3)
+
+// The FPU state of a task stays in the registers of the processor it ran on
+// until it's switched out having used them. Tasks are switched in with CR0.TS
+// set, their state is only brought back when they touch the FPU (#NM).
+static Task *_fpu_owner[CPU_MAX_COUNT] = {};
+
+static char _fpu_initial_context[512] __aligned(16);
+
+static void fpu_set_task_switched()
+{
+    asm volatile("mov %0, %%cr0" ::"r"(CR0() | CR0_TS));
+}
 
 void fpu_initialize()
 {
@@ -19,18 +36,55 @@ void fpu_initialize()
 
     // Initialize the FPU
     asm volatile("fninit");
+
+    if (arch_cpu_current() == 0)
+    {
+        asm volatile("fxsave (%0)" ::"r"(_fpu_initial_context));
+    }
+
+    fpu_set_task_switched();
 }
 
-char fpu_registers[512] __aligned(16);
+void fpu_initialize_context(Task *task)
+{
+    memcpy(&task->fpu_registers, &_fpu_initial_context, 512);
+}
 
 void fpu_save_context(Task *task)
 {
-    asm volatile("fxsave (%0)" ::"r"(fpu_registers));
-    memcpy(&task->fpu_registers, &fpu_registers, 512);
+    // CR0.TS is only cleared when the task used the FPU since it was switched in.
+    if (!(CR0() & CR0_TS))
+    {
+        asm volatile("fxsave (%0)" ::"r"(task->fpu_registers));
+    }
 }
 
-void fpu_load_context(Task *task)
+void fpu_load_context(Task *)
 {
-    memcpy(&fpu_registers, &task->fpu_registers, 512);
-    asm volatile("fxrstor (%0)" ::"r"(fpu_registers));
+    fpu_set_task_switched();
+}
+
+void fpu_handle_not_available(Task *task)
+{
+    asm volatile("clts");
+
+    // The kernel may use the FPU before the first task is running.
+    if (task == nullptr)
+    {
+        return;
+    }
+
+    int cpu = arch_cpu_current();
+
+    // The registers still hold our state if no one used them in the meantime
+    // and we didn't run on another processor since.
+    if (_fpu_owner[cpu] == task && task->fpu_cpu == cpu)
+    {
+        return;
+    }
+
+    asm volatile("fxrstor (%0)" ::"r"(task->fpu_registers));
+
+    _fpu_owner[cpu] = task;
+    task->fpu_cpu = cpu;
 }
@@ -4,6 +4,12 @@
 
 void fpu_initialize();
 
+// Give `task` the state of a freshly initialized FPU.
+void fpu_initialize_context(Task *task);
+
 void fpu_save_context(Task *task);
 
 void fpu_load_context(Task *task);
+
+// Device not available (#NM), `task` touched the FPU with CR0.TS set.
+void fpu_handle_not_available(Task *task);
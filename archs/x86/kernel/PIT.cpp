@@ -9,3 +9,9 @@ void pit_initialize(int frequency)
     out8(0x40, divisor & 0xFF);
     out8(0x40, (divisor >> 8) & 0xFF);
 }
+
+void pit_stop()
+{
+    // Interrupt on terminal count, which doesn't start counting until a count is written.
+    out8(0x43, 0x30);
+}
@@ -3,3 +3,6 @@
 #include <libsystem/Common.h>
 
 void pit_initialize(int frequency);
+
+// Stop the periodic interrupt, once another timer took over.
+void pit_stop();
@@ -0,0 +1,67 @@
+#include <libsystem/Logger.h>
+
+#include "archs/x86/kernel/CPUID.h"
+#include "archs/x86/kernel/TSC.h"
+#include "archs/x86/kernel/x86.h"
+
+#include "kernel/system/System.h"
+
+constexpr int TSC_CALIBRATION_TICKS = 50;
+constexpr uint64_t NANOSECONDS_PER_SECOND = 1000000000;
+
+static uint64_t _tsc_base = 0;
+static uint64_t _tsc_frequency = 0;
+
+void tsc_calibrate()
+{
+    if (!(cpuid_get_feature_EDX() & CPUID_FEAT_EDX_TSC))
+    {
+        logger_warn("No time stamp counter, staying on the periodic tick");
+        return;
+    }
+
+    // Start counting on a tick boundary.
+    uint32_t start = system_get_tick();
+
+    while (system_get_tick() == start)
+    {
+        asm("pause");
+    }
+
+    uint64_t start_cycles = rdtsc();
+    start = system_get_tick();
+
+    while (system_get_tick() - start < TSC_CALIBRATION_TICKS)
+    {
+        asm("pause");
+    }
+
+    uint64_t elapsed = rdtsc() - start_cycles;
+
+    _tsc_base = start_cycles;
+    _tsc_frequency = elapsed * SYSTEM_TICKS_PER_SECOND / TSC_CALIBRATION_TICKS;
+
+    logger_info("TSC runs at %uKHz", (uint32_t)(_tsc_frequency / 1000));
+}
+
+bool tsc_calibrated()
+{
+    return _tsc_frequency != 0;
+}
+
+// Both conversions are split in whole seconds and a remainder,
+// so the intermediate products don't overflow after a few seconds.
+uint64_t tsc_nanoseconds()
+{
+    uint64_t cycles = rdtsc() - _tsc_base;
+
+    return (cycles / _tsc_frequency) * NANOSECONDS_PER_SECOND +
+           (cycles % _tsc_frequency) * NANOSECONDS_PER_SECOND / _tsc_frequency;
+}
+
+uint64_t tsc_deadline(uint64_t nanoseconds)
+{
+    return _tsc_base +
+           (nanoseconds / NANOSECONDS_PER_SECOND) * _tsc_frequency +
+           (nanoseconds % NANOSECONDS_PER_SECOND) * _tsc_frequency / NANOSECONDS_PER_SECOND;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+// Measure the time stamp counter frequency against the system tick,
+// must be called with interrupts enabled. The counter is assumed to run
+// at a constant rate and to be in sync between processors.
+void tsc_calibrate();
+
+bool tsc_calibrated();
+
+// Time since the calibration.
+uint64_t tsc_nanoseconds();
+
+// Value of the counter when tsc_nanoseconds() reaches `nanoseconds`.
+uint64_t tsc_deadline(uint64_t nanoseconds);
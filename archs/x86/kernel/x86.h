@@ -53,3 +53,31 @@ static inline void cli() { asm volatile("cli"); }
 static inline void sti() { asm volatile("sti"); }
 
 static inline void hlt() { asm volatile("hlt"); }
+
+static inline bool interrupts_flag()
+{
+#ifdef __x86_64__
+    uint64_t flags;
+#else
+    uint32_t flags;
+#endif
+    asm volatile("pushf; pop %0"
+                 : "=r"(flags));
+    return flags & (1 << 9);
+}
+
+static inline uint16_t str()
+{
+    uint16_t selector;
+    asm volatile("str %0"
+                 : "=r"(selector));
+    return selector;
+}
+
+static inline uint64_t rdtsc()
+{
+    uint32_t low, high;
+    asm volatile("rdtsc"
+                 : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
@@ -1,6 +1,7 @@
+#include "archs/Architectures.h"
 #include "archs/x86_32/kernel/GDT.h"
 
-static TSS tss = {
+static constexpr TSS TSS_INITIAL = {
     .prev_tss = 0,
     .esp0 = 0,
     .ss0 = 0x10,
@@ -30,6 +31,8 @@ static TSS tss = {
     .iomap_base = 0,
 };
 
+static TSS tss[CPU_MAX_COUNT] = {};
+
 static GDTEntry gdt[GDT_ENTRY_COUNT];
 
 static GDTDescriptor gdt_descriptor = {
@@ -44,12 +47,23 @@ void gdt_initialize()
     gdt[2] = {0, 0xffffffff, GDT_PRESENT | GDT_READWRITE, GDT_FLAGS};
     gdt[3] = {0, 0xffffffff, GDT_PRESENT | GDT_READWRITE | GDT_USER | GDT_EXECUTABLE, GDT_FLAGS};
     gdt[4] = {0, 0xffffffff, GDT_PRESENT | GDT_READWRITE | GDT_USER, GDT_FLAGS};
-    gdt[5] = {&tss, GDT_TSS_PRESENT | GDT_ACCESSED | GDT_EXECUTABLE | GDT_USER, TSS_FLAGS};
 
+    for (int i = 0; i < CPU_MAX_COUNT; i++)
+    {
+        tss[i] = TSS_INITIAL;
+        gdt[GDT_TSS_ENTRY + i] = {&tss[i], GDT_TSS_PRESENT | GDT_ACCESSED | GDT_EXECUTABLE | GDT_USER, TSS_FLAGS};
+    }
+
+    gdt_load(0);
+}
+
+void gdt_load(int cpu)
+{
     gdt_flush((uint32_t)&gdt_descriptor);
+    tss_flush(GDT_TSS_SELECTOR(cpu));
 }
 
 void set_kernel_stack(uint32_t stack)
 {
-    tss.esp0 = stack;
+    tss[arch_cpu_current()].esp0 = stack;
 }
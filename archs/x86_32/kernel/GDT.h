@@ -3,7 +3,12 @@
 #include <libsystem/Common.h>
 #include <libsystem/Logger.h>
 
-#define GDT_ENTRY_COUNT 6
+#include "kernel/system/CPU.h"
+
+// One task state segment per processor, after the kernel and user segments.
+#define GDT_TSS_ENTRY 5
+#define GDT_TSS_SELECTOR(__cpu) ((GDT_TSS_ENTRY + (__cpu)) * sizeof(GDTEntry))
+#define GDT_ENTRY_COUNT (GDT_TSS_ENTRY + CPU_MAX_COUNT)
 
 #define GDT_PRESENT 0b10010000     // Present bit. This must be 1 for all valid selectors.
 #define GDT_TSS_PRESENT 0b10000000 // Present bit. This must be 1 for all valid selectors.
@@ -99,8 +104,12 @@ struct __packed GDTEntry
 
 void gdt_initialize();
 
+// Load the GDT and the task state segment of `cpu` on the processor running this code.
+void gdt_load(int cpu);
+
 extern "C" void gdt_flush(uint32_t);
 
 extern "C" void tss_flush(uint32_t);
 
+// Set the kernel stack of the processor running this code.
 void set_kernel_stack(uint32_t stack);
@@ -1,5 +1,6 @@
 
 #include "archs/x86_32/kernel/IDT.h"
+#include "archs/x86_32/kernel/Interrupts.h"
 
 extern uintptr_t __interrupt_vector[];
 
@@ -28,5 +29,15 @@ void idt_initialize()
     idt[127] = IDT_ENTRY(__interrupt_vector[48], 0x08, INTGATE);
     idt[128] = IDT_ENTRY(__interrupt_vector[49], 0x08, INTGATE | IDT_USER);
 
+    idt[INTERRUPT_LAPIC_TIMER] = IDT_ENTRY(__interrupt_vector[50], 0x08, INTGATE);
+    idt[INTERRUPT_TLB_SHOOTDOWN] = IDT_ENTRY(__interrupt_vector[51], 0x08, INTGATE);
+    idt[INTERRUPT_SPURIOUS] = IDT_ENTRY(__interrupt_vector[52], 0x08, INTGATE);
+    idt[INTERRUPT_WAKEUP] = IDT_ENTRY(__interrupt_vector[53], 0x08, INTGATE);
+
+    idt_load();
+}
+
+void idt_load()
+{
     idt_flush((uint32_t)&idt_descriptor);
 }
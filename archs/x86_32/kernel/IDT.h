@@ -38,3 +38,6 @@ struct __packed IDTEntry
 extern "C" void idt_flush(uint32_t);
 
 void idt_initialize();
+
+// Load the IDT on the processor running this code.
+void idt_load();
@@ -5,10 +5,16 @@
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
+#include "kernel/system/Trace.h"
 #include "kernel/tasking/Syscalls.h"
+#include "kernel/tasking/Task-Memory.h"
 
+#include "archs/x86/kernel/FPU.h"
 #include "archs/x86/kernel/PIC.h"
 #include "archs/x86_32/kernel/Interrupts.h"
+#include "archs/x86_32/kernel/LAPIC.h"
+#include "archs/x86_32/kernel/Paging.h"
+#include "archs/x86_32/kernel/SMP.h"
 #include "archs/x86_32/kernel/x86_32.h"
 
 static const char *_exception_messages[32] = {
@@ -48,9 +54,24 @@ static const char *_exception_messages[32] = {
 
 extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackframe)
 {
+    if (stackframe.intno == 2 && smp_is_stopping())
+    {
+        // Another processor is panicking.
+        system_hang();
+    }
+
     if (stackframe.intno < 32)
     {
-        if (stackframe.cs == 0x1B)
+        if (stackframe.intno == 7)
+        {
+            // The task touched the FPU since it was switched in, bring its state back.
+            fpu_handle_not_available(scheduler_running());
+        }
+        else if (stackframe.intno == 14 && task_memory_handle_fault(scheduler_running(), CR2()))
+        {
+            // The page was brought in, retry the access.
+        }
+        else if (stackframe.cs == 0x1B)
         {
             sti();
 
@@ -82,6 +103,8 @@ extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackf
     {
         interrupts_disable_holding();
 
+        trace_record(TRACE_EVENT_INTERRUPT, scheduler_running_id(), stackframe.intno);
+
         int irq = stackframe.intno - 32;
 
         if (irq == 0)
@@ -140,6 +163,42 @@ extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackf
 
         cli();
     }
+    else if (stackframe.intno == INTERRUPT_LAPIC_TIMER)
+    {
+        interrupts_disable_holding();
+
+        trace_record(TRACE_EVENT_INTERRUPT, scheduler_running_id(), stackframe.intno);
+
+        // The PIT is stopped, see arch_timer_initialize().
+        if (lapic_timer_is_oneshot())
+        {
+            system_tick();
+        }
+
+        esp = schedule(esp);
+
+        interrupts_enable_holding();
+
+        lapic_ack();
+        return esp;
+    }
+    else if (stackframe.intno == INTERRUPT_TLB_SHOOTDOWN)
+    {
+        paging_invalidate_tlb();
+
+        lapic_ack();
+        return esp;
+    }
+    else if (stackframe.intno == INTERRUPT_WAKEUP)
+    {
+        // Nothing to do, the idle loop looks at its run queue when interrupted.
+        lapic_ack();
+        return esp;
+    }
+    else if (stackframe.intno == INTERRUPT_SPURIOUS)
+    {
+        return esp;
+    }
 
     pic_ack(stackframe.intno);
 
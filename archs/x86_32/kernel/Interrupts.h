@@ -2,6 +2,12 @@
 
 #include <libsystem/Common.h>
 
+// Local APIC vectors, the legacy PIC uses 32 to 47.
+#define INTERRUPT_LAPIC_TIMER 48
+#define INTERRUPT_TLB_SHOOTDOWN 49
+#define INTERRUPT_WAKEUP 50
+#define INTERRUPT_SPURIOUS 255
+
 struct __packed InterruptStackFrame
 {
     uint32_t gs, fs, es, ds;
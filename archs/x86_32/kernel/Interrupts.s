@@ -108,6 +108,11 @@ INTERRUPT_NOERR 45
 INTERRUPT_NOERR 46
 INTERRUPT_NOERR 47
 
+INTERRUPT_NOERR 48
+INTERRUPT_NOERR 49
+INTERRUPT_NOERR 50
+INTERRUPT_NOERR 255
+
 INTERRUPT_NOERR 127
 INTERRUPT_SYSCALL 128
 
@@ -166,3 +171,8 @@ __interrupt_vector:
 
     INTERRUPT_NAME 127
     INTERRUPT_NAME 128
+
+    INTERRUPT_NAME 48
+    INTERRUPT_NAME 49
+    INTERRUPT_NAME 255
+    INTERRUPT_NAME 50
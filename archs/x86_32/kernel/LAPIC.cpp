@@ -1,26 +1,105 @@
 #include <libsystem/Logger.h>
+#include <libsystem/math/MinMax.h>
 
-#include "archs/x86/kernel/PIC.h"
+#include "archs/Memory.h"
+#include "archs/x86/kernel/CPUID.h"
+#include "archs/x86/kernel/TSC.h"
 #include "archs/x86_32/kernel/LAPIC.h"
+#include "archs/x86_32/kernel/x86_32.h"
 
+#include "kernel/memory/MMIO.h"
+#include "kernel/system/Spinlock.h"
+#include "kernel/system/System.h"
+
+constexpr int LAPIC_ID = 0x0020;
+constexpr int LAPIC_TPR = 0x0080;
 constexpr int LAPIC_EOI = 0x00B0;
+constexpr int LAPIC_SPURIOUS = 0x00F0;
+constexpr int LAPIC_ICR_LOW = 0x0300;
+constexpr int LAPIC_ICR_HIGH = 0x0310;
+constexpr int LAPIC_TIMER = 0x0320;
+constexpr int LAPIC_LINT0 = 0x0350;
+constexpr int LAPIC_LINT1 = 0x0360;
+constexpr int LAPIC_TIMER_INITIAL = 0x0380;
+constexpr int LAPIC_TIMER_CURRENT = 0x0390;
+constexpr int LAPIC_TIMER_DIVIDE = 0x03E0;
+
+constexpr uint32_t LAPIC_ENABLE = 0x100;
+constexpr uint32_t LAPIC_SPURIOUS_VECTOR = 0xFF;
+
+constexpr uint32_t LAPIC_ICR_FIXED = 0x000;
+constexpr uint32_t LAPIC_ICR_NMI = 0x400;
+constexpr uint32_t LAPIC_ICR_INIT = 0x500;
+constexpr uint32_t LAPIC_ICR_STARTUP = 0x600;
+constexpr uint32_t LAPIC_ICR_PENDING = 1 << 12;
+constexpr uint32_t LAPIC_ICR_ASSERT = 1 << 14;
+constexpr uint32_t LAPIC_ICR_LEVEL = 1 << 15;
+constexpr uint32_t LAPIC_ICR_ALL_EXCLUDING_SELF = 0b11 << 18;
+
+constexpr uint32_t LAPIC_LINT_NMI = 0x400;
+constexpr uint32_t LAPIC_LINT_EXTINT = 0x700;
+
+constexpr uint32_t LAPIC_TIMER_MASKED = 1 << 16;
+constexpr uint32_t LAPIC_TIMER_PERIODIC = 1 << 17;
+constexpr uint32_t LAPIC_TIMER_TSC_DEADLINE = 1 << 18;
+constexpr uint32_t LAPIC_TIMER_DIVIDE_BY_16 = 0x3;
+
+constexpr int LAPIC_CALIBRATION_TICKS = 10;
+
+constexpr uint32_t IA32_TSC_DEADLINE = 0x6E0;
+
+static uintptr_t _lapic_physical = 0;
+static MMIORange *_lapic = nullptr;
+
+// The interrupt command register is written in two steps.
+static Spinlock _lapic_lock{"lapic"};
+
+static uint32_t _lapic_timer_frequency = 0;
 
-static volatile uint32_t *lapic = nullptr;
+static bool _lapic_timer_oneshot = false;
+static bool _lapic_timer_tsc_deadline = false;
 
 void lapic_found(uintptr_t address)
 {
-    lapic = reinterpret_cast<uint32_t *>(address);
-    logger_info("LAPIC found at %08x", lapic);
+    _lapic_physical = address;
+    logger_info("LAPIC found at %08x", address);
 }
 
-uint32_t lapic_read(uint32_t reg)
+bool lapic_available()
 {
-    return *((volatile uint32_t *)(lapic + reg));
+    return _lapic_physical != 0;
 }
 
-void lapic_write(uint32_t reg, uint32_t data)
+static uint32_t lapic_read(uint32_t reg)
 {
-    *((volatile uint32_t *)(lapic + reg)) = data;
+    return _lapic->read32(reg);
+}
+
+static void lapic_write(uint32_t reg, uint32_t data)
+{
+    _lapic->write32(reg, data);
+}
+
+void lapic_initialize()
+{
+    _lapic = new MMIORange(MemoryRange{_lapic_physical, ARCH_PAGE_SIZE});
+}
+
+void lapic_enable()
+{
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SPURIOUS, LAPIC_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+void lapic_enable_legacy_interrupts()
+{
+    lapic_write(LAPIC_LINT0, LAPIC_LINT_EXTINT);
+    lapic_write(LAPIC_LINT1, LAPIC_LINT_NMI);
+}
+
+int lapic_id()
+{
+    return lapic_read(LAPIC_ID) >> 24;
 }
 
 void lapic_ack()
@@ -28,9 +107,132 @@ void lapic_ack()
     lapic_write(LAPIC_EOI, 0);
 }
 
-void lapic_initialize()
+static void lapic_send(int apic_id, uint32_t command)
+{
+    SpinlockHolder holder(_lapic_lock);
+
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING)
+    {
+        asm("pause");
+    }
+}
+
+void lapic_send_init(int apic_id)
 {
-    pic_disable();
+    lapic_send(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT | LAPIC_ICR_LEVEL);
+    lapic_send(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL);
+}
+
+void lapic_send_startup(int apic_id, uintptr_t address)
+{
+    lapic_send(apic_id, LAPIC_ICR_STARTUP | LAPIC_ICR_ASSERT | (address / ARCH_PAGE_SIZE));
+}
+
+void lapic_send_ipi(int apic_id, int vector)
+{
+    lapic_send(apic_id, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | vector);
+}
+
+void lapic_send_ipi_others(int vector)
+{
+    lapic_send(0, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | LAPIC_ICR_ALL_EXCLUDING_SELF | vector);
+}
+
+void lapic_send_nmi_others()
+{
+    lapic_send(0, LAPIC_ICR_NMI | LAPIC_ICR_ASSERT | LAPIC_ICR_ALL_EXCLUDING_SELF);
+}
+
+void lapic_timer_calibrate()
+{
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_BY_16);
+    lapic_write(LAPIC_TIMER, LAPIC_TIMER_MASKED);
+
+    // Start counting on a tick boundary.
+    uint32_t start = system_get_tick();
+
+    while (system_get_tick() == start)
+    {
+        asm("pause");
+    }
+
+    lapic_write(LAPIC_TIMER_INITIAL, 0xFFFFFFFF);
+    start = system_get_tick();
+
+    while (system_get_tick() - start < LAPIC_CALIBRATION_TICKS)
+    {
+        asm("pause");
+    }
+
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+    lapic_write(LAPIC_TIMER_INITIAL, 0);
+
+    _lapic_timer_frequency = elapsed / LAPIC_CALIBRATION_TICKS;
+
+    logger_info("LAPIC timer runs at %u cycles per tick", _lapic_timer_frequency);
+}
+
+void lapic_timer_start(int vector)
+{
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_BY_16);
+    lapic_write(LAPIC_TIMER, LAPIC_TIMER_PERIODIC | vector);
+    lapic_write(LAPIC_TIMER_INITIAL, _lapic_timer_frequency);
+}
+
+void lapic_timer_start_oneshot(int vector)
+{
+    _lapic_timer_tsc_deadline = cpuid_get_feature_ECX() & CPUID_FEAT_ECX_TSC_DEADLINE;
+
+    if (_lapic_timer_tsc_deadline)
+    {
+        lapic_write(LAPIC_TIMER, LAPIC_TIMER_TSC_DEADLINE | vector);
+    }
+    else
+    {
+        lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_BY_16);
+        lapic_write(LAPIC_TIMER, vector);
+        lapic_write(LAPIC_TIMER_INITIAL, 0);
+    }
+
+    _lapic_timer_oneshot = true;
+}
+
+bool lapic_timer_is_oneshot()
+{
+    return _lapic_timer_oneshot;
+}
+
+void lapic_timer_oneshot(uint64_t nanoseconds)
+{
+    if (_lapic_timer_tsc_deadline)
+    {
+        // Writing zero disarms the timer, a deadline in the past fires right away.
+        uint64_t deadline = nanoseconds == (uint64_t)-1 ? 0 : tsc_deadline(nanoseconds);
+        wrmsr(IA32_TSC_DEADLINE, deadline & 0xFFFFFFFF, deadline >> 32);
+
+        return;
+    }
+
+    if (nanoseconds == (uint64_t)-1)
+    {
+        lapic_write(LAPIC_TIMER_INITIAL, 0);
+        return;
+    }
+
+    uint64_t now = tsc_nanoseconds();
+    uint64_t delay = nanoseconds > now ? nanoseconds - now : 0;
+
+    // Far away deadlines fire early, they get programmed again from there.
+    uint32_t count = 0xFFFFFFFF;
+
+    if (delay < (uint64_t)(0xFFFFFFFF / _lapic_timer_frequency) * NANOSECONDS_PER_TICK)
+    {
+        // Zero would stop the timer instead of firing right away.
+        count = MAX(1, delay * _lapic_timer_frequency / NANOSECONDS_PER_TICK);
+    }
 
-    lapic_write(0xF0, lapic_read(0xF0) | 0x100);
+    lapic_write(LAPIC_TIMER_INITIAL, count);
 }
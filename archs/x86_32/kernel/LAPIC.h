@@ -4,6 +4,45 @@
 
 void lapic_found(uintptr_t address);
 
+bool lapic_available();
+
+// Map the local APIC registers, done once by the boot processor.
 void lapic_initialize();
 
+// Enable the local APIC of the processor running this code.
+void lapic_enable();
+
+// Keep receiving the legacy PIC interrupts through LINT0 on the boot processor.
+void lapic_enable_legacy_interrupts();
+
+int lapic_id();
+
 void lapic_ack();
+
+void lapic_send_init(int apic_id);
+
+void lapic_send_startup(int apic_id, uintptr_t address);
+
+void lapic_send_ipi(int apic_id, int vector);
+
+void lapic_send_ipi_others(int vector);
+
+void lapic_send_nmi_others();
+
+// Measure the local APIC timer frequency against the system tick,
+// must be called with interrupts enabled.
+void lapic_timer_calibrate();
+
+// Fire `vector` on the processor running this code once per system tick.
+void lapic_timer_start(int vector);
+
+// Same as lapic_timer_start() but the timer only fires when asked to by
+// lapic_timer_oneshot(), using the TSC-deadline mode if it is available.
+// The TSC must be calibrated.
+void lapic_timer_start_oneshot(int vector);
+
+// The boot processor switched to one-shot, the others should follow.
+bool lapic_timer_is_oneshot();
+
+// Fire once when tsc_nanoseconds() reaches `nanoseconds`, never if it is -1.
+void lapic_timer_oneshot(uint64_t nanoseconds);
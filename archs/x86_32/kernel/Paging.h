@@ -4,12 +4,17 @@
 
 #include "archs/Memory.h"
 
+#include "kernel/memory/VirtualRanges.h"
+
 #define PAGE_DIRECTORY_INDEX(vaddr) ((vaddr) >> 22)
 #define PAGE_TABLE_INDEX(vaddr) (((vaddr) >> 12) & 0x03ff)
 
 #define PAGE_TABLE_ENTRY_COUNT 1024
 #define PAGE_DIRECTORY_ENTRY_COUNT 1024
 
+// A page directory entry with PSE maps 4Mio at once.
+#define LARGE_PAGE_SIZE (PAGE_TABLE_ENTRY_COUNT * ARCH_PAGE_SIZE)
+
 union __packed PageTableEntry
 {
     struct __packed
@@ -57,8 +62,20 @@ struct __packed PageDirectory
     PageDirectoryEntry entries[PAGE_DIRECTORY_ENTRY_COUNT];
 };
 
+struct AddressSpace
+{
+    PageDirectory *directory;
+
+    // Free virtual memory of the user half, the kernel half is shared by
+    // every address spaces and tracked by the kernel address space.
+    VirtualRanges ranges;
+};
+
 extern "C" void paging_enable();
 
+// Turn on 4Mio pages (CR4.PSE) on the processor running this code, if it has them.
+void paging_enable_large_pages();
+
 extern "C" void paging_disable();
 
 extern "C" void paging_load_directory(uintptr_t directory);
@@ -3,7 +3,7 @@ section .text
 global paging_enable
 paging_enable:
     mov eax, cr0
-    or eax, 0x80000000
+    or eax, 0x80010000 ; PG | WP
     mov cr0, eax
     ret
 
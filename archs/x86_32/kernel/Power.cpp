@@ -1,11 +1,11 @@
 #include <libsystem/Logger.h>
 
 #include "archs/Architectures.h"
-#include "archs/VirtualMemory.h"
 
 #include "archs/x86/kernel/IOPort.h"
 #include "archs/x86/kernel/x86.h"
 #include "archs/x86_32/kernel/ACPI.h"
+#include "archs/x86_32/kernel/Paging.h"
 #include "archs/x86_32/kernel/Power.h"
 
 namespace x86
@@ -30,7 +30,7 @@ void reboot_triple_fault()
 {
     logger_info("Trying to reboot by doing a triple fault...");
     cli();
-    arch_address_space_switch(0x0);
+    paging_load_directory(0x0);
     *(uint32_t *)0x0 = 0xDEADDEAD;
 }
 
@@ -0,0 +1,217 @@
+#include <abi/Process.h>
+#include <libsystem/Logger.h>
+#include <string.h>
+
+#include "archs/VirtualMemory.h"
+#include "archs/x86/kernel/FPU.h"
+#include "archs/x86_32/kernel/GDT.h"
+#include "archs/x86_32/kernel/IDT.h"
+#include "archs/x86_32/kernel/Interrupts.h"
+#include "archs/x86_32/kernel/LAPIC.h"
+#include "archs/x86_32/kernel/Paging.h"
+#include "archs/x86_32/kernel/SMP.h"
+#include "archs/x86_32/kernel/x86_32.h"
+
+#include "kernel/interrupts/Interupts.h"
+#include "kernel/memory/Memory.h"
+#include "kernel/scheduling/Scheduler.h"
+#include "kernel/system/CPU.h"
+#include "kernel/system/System.h"
+#include "kernel/tasking/Tasking.h"
+
+extern "C" char smp_trampoline_start[];
+extern "C" char smp_trampoline_end[];
+
+static constexpr uint32_t SMP_INIT_DELAY = 10;
+static constexpr uint32_t SMP_STARTUP_DELAY = 1;
+static constexpr uint32_t SMP_ONLINE_TIMEOUT = 100;
+
+// Local APIC ids of the processors listed in the MADT.
+static int _processors[CPU_MAX_COUNT] = {};
+static int _processors_count = 0;
+
+// Processors are started one at a time, the trampoline doesn't tell them who they are.
+static CPU *_starting_cpu = nullptr;
+static Task *_starting_idle = nullptr;
+
+static bool _stopping = false;
+
+void smp_found_processor(int apic_id, bool enabled)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    if (_processors_count == CPU_MAX_COUNT)
+    {
+        logger_warn("Too many processors, ignoring APIC %d!", apic_id);
+        return;
+    }
+
+    _processors[_processors_count] = apic_id;
+    _processors_count++;
+}
+
+extern "C" void smp_application_processor_main()
+{
+    CPU *cpu = _starting_cpu;
+
+    gdt_load(cpu->id);
+    idt_load();
+    fpu_initialize();
+    paging_enable_large_pages();
+    lapic_enable();
+
+    interrupts_disable_holding();
+
+    scheduler_did_create_idle_task(_starting_idle);
+    scheduler_did_create_running_task(_starting_idle);
+
+    if (lapic_timer_is_oneshot())
+    {
+        lapic_timer_start_oneshot(INTERRUPT_LAPIC_TIMER);
+        system_timer_rearm(true);
+    }
+    else
+    {
+        lapic_timer_start(INTERRUPT_LAPIC_TIMER);
+    }
+
+    __atomic_store_n(&cpu->online, true, __ATOMIC_RELEASE);
+    logger_info("Processor %d (APIC %d) is online", cpu->id, cpu->arch_id);
+
+    interrupts_enable_holding();
+    sti();
+
+    scheduler_idle();
+}
+
+static void smp_wait(uint32_t ticks)
+{
+    uint32_t start = system_get_tick();
+
+    while (system_get_tick() - start < ticks)
+    {
+        asm("pause");
+    }
+}
+
+static bool smp_wait_online(CPU *cpu, uint32_t ticks)
+{
+    uint32_t start = system_get_tick();
+
+    while (system_get_tick() - start < ticks)
+    {
+        if (__atomic_load_n(&cpu->online, __ATOMIC_ACQUIRE))
+        {
+            return true;
+        }
+
+        asm("pause");
+    }
+
+    return false;
+}
+
+static void smp_start(CPU *cpu)
+{
+    auto parameters = reinterpret_cast<SMPTrampolineParameters *>(SMP_TRAMPOLINE_PARAMETERS);
+
+    _starting_cpu = cpu;
+    _starting_idle = tasking_create_idle_task();
+
+    {
+        SpinlockHolder holder(memory_lock);
+        auto kernel_address_space = reinterpret_cast<AddressSpace *>(arch_kernel_address_space());
+        parameters->page_directory = arch_virtual_to_physical(kernel_address_space, (uintptr_t)kernel_address_space->directory);
+    }
+
+    parameters->stack = (uintptr_t)_starting_idle->kernel_stack + PROCESS_STACK_SIZE;
+    parameters->entry = (uintptr_t)smp_application_processor_main;
+
+    lapic_send_init(cpu->arch_id);
+    smp_wait(SMP_INIT_DELAY);
+
+    lapic_send_startup(cpu->arch_id, SMP_TRAMPOLINE);
+
+    if (!smp_wait_online(cpu, SMP_STARTUP_DELAY))
+    {
+        lapic_send_startup(cpu->arch_id, SMP_TRAMPOLINE);
+
+        if (!smp_wait_online(cpu, SMP_ONLINE_TIMEOUT))
+        {
+            logger_error("Processor %d (APIC %d) didn't start!", cpu->id, cpu->arch_id);
+        }
+    }
+}
+
+void smp_initialize()
+{
+    if (!lapic_available() || _processors_count <= 1)
+    {
+        logger_info("Running on a single processor");
+        return;
+    }
+
+    // The local APIC of the boot processor was brought up by arch_timer_initialize().
+    int boot_apic_id = lapic_id();
+    cpu_by_id(0)->arch_id = boot_apic_id;
+
+    {
+        SpinlockHolder holder(memory_lock);
+
+        // The page was reserved by arch_virtual_initialize().
+        MemoryRange trampoline_range{SMP_TRAMPOLINE, ARCH_PAGE_SIZE};
+        assert(SUCCESS == arch_virtual_map(arch_kernel_address_space(), trampoline_range, SMP_TRAMPOLINE, MEMORY_NONE));
+    }
+
+    memcpy((void *)SMP_TRAMPOLINE, smp_trampoline_start, smp_trampoline_end - smp_trampoline_start);
+
+    for (int i = 0; i < _processors_count; i++)
+    {
+        if (_processors[i] == boot_apic_id)
+        {
+            continue;
+        }
+
+        CPU *cpu = cpu_register(_processors[i]);
+
+        if (!cpu)
+        {
+            break;
+        }
+
+        smp_start(cpu);
+    }
+
+    logger_info("%d processors online", cpu_online_count());
+}
+
+void smp_invalidate_tlb_others()
+{
+    if (cpu_online_count() > 1)
+    {
+        lapic_send_ipi_others(INTERRUPT_TLB_SHOOTDOWN);
+    }
+}
+
+void smp_wake(int cpu)
+{
+    lapic_send_ipi(cpu_by_id(cpu)->arch_id, INTERRUPT_WAKEUP);
+}
+
+void smp_stop_others()
+{
+    _stopping = true;
+
+    if (cpu_online_count() > 1)
+    {
+        lapic_send_nmi_others();
+    }
+}
+
+bool smp_is_stopping()
+{
+    return _stopping;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+// The application processors start in real mode, so they can only run from
+// low memory. The parameters of the trampoline live in the same page, see SMP.s
+#define SMP_TRAMPOLINE 0x8000
+#define SMP_TRAMPOLINE_PARAMETERS 0x8F00
+
+struct __packed SMPTrampolineParameters
+{
+    uint32_t page_directory;
+    uint32_t stack;
+    uint32_t entry;
+};
+
+void smp_found_processor(int apic_id, bool enabled);
+
+void smp_initialize();
+
+void smp_invalidate_tlb_others();
+
+void smp_wake(int cpu);
+
+void smp_stop_others();
+
+bool smp_is_stopping();
@@ -0,0 +1,70 @@
+;; Application processors start here in real mode, this code is copied to
+;; SMP_TRAMPOLINE by smp_initialize(), keep the addresses in sync with SMP.h
+
+SMP_TRAMPOLINE equ 0x8000
+SMP_TRAMPOLINE_PARAMETERS equ 0x8F00
+
+%define TRAMPOLINE(__label) (SMP_TRAMPOLINE + (__label - smp_trampoline_start))
+
+section .text
+
+global smp_trampoline_start
+global smp_trampoline_end
+
+[bits 16]
+smp_trampoline_start:
+    cli
+    cld
+
+    xor ax, ax
+    mov ds, ax
+
+    lgdt [TRAMPOLINE(smp_trampoline_gdt_descriptor)]
+
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+
+    jmp 0x08:TRAMPOLINE(smp_trampoline_protected)
+
+[bits 32]
+smp_trampoline_protected:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ;; SMPTrampolineParameters::page_directory
+    mov eax, [SMP_TRAMPOLINE_PARAMETERS + 0]
+    mov cr3, eax
+
+    mov eax, cr0
+    or eax, 0x80010000 ; PG | WP
+    mov cr0, eax
+
+    ;; SMPTrampolineParameters::stack
+    mov esp, [SMP_TRAMPOLINE_PARAMETERS + 4]
+    xor ebp, ebp
+
+    ;; SMPTrampolineParameters::entry
+    mov eax, [SMP_TRAMPOLINE_PARAMETERS + 8]
+    call eax
+
+.hang:
+    cli
+    hlt
+    jmp .hang
+
+align 8
+smp_trampoline_gdt:
+    dq 0x0000000000000000
+    dq 0x00CF9A000000FFFF ; Kernel code
+    dq 0x00CF92000000FFFF ; Kernel data
+
+smp_trampoline_gdt_descriptor:
+    dw smp_trampoline_gdt_descriptor - smp_trampoline_gdt - 1
+    dd TRAMPOLINE(smp_trampoline_gdt)
+
+smp_trampoline_end:
@@ -5,7 +5,10 @@
 #include <libutils/ResultOr.h>
 
 #include "archs/VirtualMemory.h"
+#include "archs/x86/kernel/CPUID.h"
+#include "archs/x86/kernel/x86.h"
 #include "archs/x86_32/kernel/Paging.h"
+#include "archs/x86_32/kernel/SMP.h"
 
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/memory/Memory.h"
@@ -15,8 +18,38 @@
 PageDirectory _kernel_page_directory __aligned(ARCH_PAGE_SIZE) = {};
 PageTable _kernel_page_tables[256] __aligned(ARCH_PAGE_SIZE) = {};
 
+AddressSpace _kernel_address_space = {};
+
+// The first gigabyte belongs to the kernel, the rest to userspace.
+static constexpr uintptr_t USER_VIRTUAL_BASE = 256 * 1024 * ARCH_PAGE_SIZE;
+static constexpr size_t USER_VIRTUAL_SIZE = (size_t)768 * 1024 * ARCH_PAGE_SIZE;
+
+static bool _large_pages = false;
+
+static PageDirectory *page_directory_of(void *address_space)
+{
+    return reinterpret_cast<AddressSpace *>(address_space)->directory;
+}
+
+static VirtualRanges *virtual_ranges_of(void *address_space, uintptr_t virtual_address)
+{
+    if (virtual_address < USER_VIRTUAL_BASE)
+    {
+        return &_kernel_address_space.ranges;
+    }
+    else
+    {
+        return &reinterpret_cast<AddressSpace *>(address_space)->ranges;
+    }
+}
+
 void arch_virtual_initialize()
 {
+    _kernel_address_space.directory = &_kernel_page_directory;
+
+    // We skip the first page to make null deref trigger a page fault.
+    virtual_ranges_initialize(&_kernel_address_space.ranges, {ARCH_PAGE_SIZE, USER_VIRTUAL_BASE - ARCH_PAGE_SIZE});
+
     // Setup the kernel pagedirectory.
     for (size_t i = 0; i < 256; i++)
     {
@@ -26,23 +59,80 @@ void arch_virtual_initialize()
         entry->Present = 1;
         entry->PageFrameNumber = (size_t)&_kernel_page_tables[i] / ARCH_PAGE_SIZE;
     }
+
+    // Keep the application processors trampoline page for smp_initialize().
+    physical_set_used({SMP_TRAMPOLINE, ARCH_PAGE_SIZE});
+    virtual_ranges_reserve(&_kernel_address_space.ranges, {SMP_TRAMPOLINE, ARCH_PAGE_SIZE});
 }
 
 void arch_virtual_memory_enable()
 {
+    paging_enable_large_pages();
     paging_enable();
 }
 
+void paging_enable_large_pages()
+{
+    if (!cpuid().PSE)
+    {
+        return;
+    }
+
+    asm volatile("mov %0, %%cr4" ::"r"(CR4() | (1 << 4)));
+
+    _large_pages = true;
+}
+
+size_t arch_large_page_size()
+{
+    return _large_pages ? LARGE_PAGE_SIZE : 0;
+}
+
+// The kernel half is shared by every address spaces through the kernel page
+// tables, so only the user half can be mapped with large pages.
+static bool page_directory_can_map_large(uintptr_t virtual_address, uintptr_t physical_address, size_t size)
+{
+    return _large_pages &&
+           virtual_address >= USER_VIRTUAL_BASE &&
+           virtual_address % LARGE_PAGE_SIZE == 0 &&
+           physical_address % LARGE_PAGE_SIZE == 0 &&
+           size >= LARGE_PAGE_SIZE;
+}
+
+// Replace a large page by a page table mapping the same memory, so parts of it can be changed.
+static Result page_directory_split(void *address_space, PageDirectoryEntry &page_directory_entry)
+{
+    PageTable *page_table = nullptr;
+    TRY(memory_alloc_identity(address_space, MEMORY_CLEAR, (uintptr_t *)&page_table));
+
+    for (size_t i = 0; i < PAGE_TABLE_ENTRY_COUNT; i++)
+    {
+        PageTableEntry &page_table_entry = page_table->entries[i];
+
+        page_table_entry.Present = 1;
+        page_table_entry.Write = page_directory_entry.Write;
+        page_table_entry.User = page_directory_entry.User;
+        page_table_entry.PageFrameNumber = page_directory_entry.PageFrameNumber + i;
+    }
+
+    page_directory_entry.LargePage = 0;
+    page_directory_entry.Write = 1;
+    page_directory_entry.User = 1;
+    page_directory_entry.PageFrameNumber = (uint32_t)(page_table) >> 12;
+
+    return SUCCESS;
+}
+
 void *arch_kernel_address_space()
 {
-    return &_kernel_page_directory;
+    return &_kernel_address_space;
 }
 
 bool arch_virtual_present(void *address_space, uintptr_t virtual_address)
 {
     ASSERT_INTERRUPTS_RETAINED();
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = page_directory_of(address_space);
 
     int page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address);
     PageDirectoryEntry &page_directory_entry = page_directory->entries[page_directory_index];
@@ -52,6 +142,11 @@ bool arch_virtual_present(void *address_space, uintptr_t virtual_address)
         return false;
     }
 
+    if (page_directory_entry.LargePage)
+    {
+        return true;
+    }
+
     PageTable &page_table = *reinterpret_cast<PageTable *>(page_directory_entry.PageFrameNumber * ARCH_PAGE_SIZE);
 
     int page_table_index = PAGE_TABLE_INDEX(virtual_address);
@@ -64,7 +159,7 @@ uintptr_t arch_virtual_to_physical(void *address_space, uintptr_t virtual_addres
 {
     ASSERT_INTERRUPTS_RETAINED();
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = page_directory_of(address_space);
 
     int page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address);
     PageDirectoryEntry &page_directory_entry = page_directory->entries[page_directory_index];
@@ -74,6 +169,11 @@ uintptr_t arch_virtual_to_physical(void *address_space, uintptr_t virtual_addres
         return 0;
     }
 
+    if (page_directory_entry.LargePage)
+    {
+        return (page_directory_entry.PageFrameNumber * ARCH_PAGE_SIZE) + (virtual_address & (LARGE_PAGE_SIZE - 1));
+    }
+
     PageTable &page_table = *reinterpret_cast<PageTable *>(page_directory_entry.PageFrameNumber * ARCH_PAGE_SIZE);
 
     int page_table_index = PAGE_TABLE_INDEX(virtual_address);
@@ -91,19 +191,39 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
 {
     ASSERT_INTERRUPTS_RETAINED();
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = page_directory_of(address_space);
 
-    for (size_t i = 0; i < physical_range.size() / ARCH_PAGE_SIZE; i++)
-    {
-        size_t offset = i * ARCH_PAGE_SIZE;
+    size_t offset = 0;
 
+    while (offset < physical_range.size())
+    {
         int page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address + offset);
         PageDirectoryEntry &page_directory_entry = page_directory->entries[page_directory_index];
+
+        if ((!page_directory_entry.Present || page_directory_entry.LargePage) &&
+            page_directory_can_map_large(virtual_address + offset, physical_range.base() + offset, physical_range.size() - offset))
+        {
+            page_directory_entry.as_uint = 0;
+            page_directory_entry.Present = 1;
+            page_directory_entry.Write = !(flags & MEMORY_READONLY);
+            page_directory_entry.User = flags & MEMORY_USER;
+            page_directory_entry.LargePage = 1;
+            page_directory_entry.PageFrameNumber = (physical_range.base() + offset) >> 12;
+
+            offset += LARGE_PAGE_SIZE;
+            continue;
+        }
+
+        if (page_directory_entry.Present && page_directory_entry.LargePage)
+        {
+            TRY(page_directory_split(address_space, page_directory_entry));
+        }
+
         PageTable *page_table = reinterpret_cast<PageTable *>(page_directory_entry.PageFrameNumber * ARCH_PAGE_SIZE);
 
         if (!page_directory_entry.Present)
         {
-            TRY(memory_alloc_identity(page_directory, MEMORY_CLEAR, (uintptr_t *)&page_table));
+            TRY(memory_alloc_identity(address_space, MEMORY_CLEAR, (uintptr_t *)&page_table));
 
             page_directory_entry.Present = 1;
             page_directory_entry.Write = 1;
@@ -115,11 +235,15 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
         PageTableEntry &page_table_entry = page_table->entries[page_table_index];
 
         page_table_entry.Present = 1;
-        page_table_entry.Write = 1;
+        page_table_entry.Write = !(flags & MEMORY_READONLY);
         page_table_entry.User = flags & MEMORY_USER;
         page_table_entry.PageFrameNumber = (physical_range.base() + offset) >> 12;
+
+        offset += ARCH_PAGE_SIZE;
     }
 
+    virtual_ranges_reserve(virtual_ranges_of(address_space, virtual_address), {virtual_address, physical_range.size()});
+
     paging_invalidate_tlb();
 
     return SUCCESS;
@@ -129,141 +253,194 @@ MemoryRange arch_virtual_alloc(void *address_space, MemoryRange physical_range,
 {
     ASSERT_INTERRUPTS_RETAINED();
 
+    auto virtual_range = arch_virtual_reserve(address_space, physical_range.size(), flags);
+
+    assert(SUCCESS == arch_virtual_map(address_space, physical_range, virtual_range.base(), flags));
+
+    return virtual_range;
+}
+
+MemoryRange arch_virtual_reserve(void *address_space, size_t size, MemoryFlags flags)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
     bool is_user_memory = flags & MEMORY_USER;
 
-    uintptr_t virtual_address = 0;
-    size_t current_size = 0;
+    auto ranges = virtual_ranges_of(address_space, is_user_memory ? USER_VIRTUAL_BASE : 0);
 
-    // we skip the first page to make null deref trigger a page fault
-    for (size_t i = (is_user_memory ? 256 : 1) * 1024; i < (is_user_memory ? 1024 : 256) * 1024; i++)
+    // Big enough to be backed by large pages, which need aligned virtual addresses.
+    size_t align = ARCH_PAGE_SIZE;
+
+    if (is_user_memory && _large_pages && size >= LARGE_PAGE_SIZE)
     {
-        uintptr_t current_address = i * ARCH_PAGE_SIZE;
+        align = LARGE_PAGE_SIZE;
+    }
 
-        if (!arch_virtual_present(address_space, current_address))
-        {
-            if (current_size == 0)
-            {
-                virtual_address = current_address;
-            }
+    auto virtual_range = virtual_ranges_alloc_aligned(ranges, size, align);
 
-            current_size += ARCH_PAGE_SIZE;
+    if (virtual_range.empty())
+    {
+        system_panic("Out of virtual memory!");
+    }
 
-            if (current_size == physical_range.size())
-            {
-                assert(SUCCESS == arch_virtual_map(address_space, physical_range, virtual_address, flags));
+    return virtual_range;
+}
 
-                return (MemoryRange){virtual_address, current_size};
-            }
-        }
-        else
-        {
-            current_size = 0;
-        }
-    }
+void arch_virtual_reserve_at(void *address_space, MemoryRange virtual_range)
+{
+    ASSERT_INTERRUPTS_RETAINED();
 
-    system_panic("Out of virtual memory!");
+    virtual_ranges_reserve(virtual_ranges_of(address_space, virtual_range.base()), virtual_range);
 }
 
 void arch_virtual_free(void *address_space, MemoryRange virtual_range)
 {
     ASSERT_INTERRUPTS_RETAINED();
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = page_directory_of(address_space);
 
-    for (size_t i = 0; i < virtual_range.size() / ARCH_PAGE_SIZE; i++)
+    size_t offset = 0;
+
+    while (offset < virtual_range.size())
     {
-        size_t offset = i * ARCH_PAGE_SIZE;
+        uintptr_t virtual_address = virtual_range.base() + offset;
 
-        size_t page_directory_index = PAGE_DIRECTORY_INDEX(virtual_range.base() + offset);
+        size_t page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address);
         PageDirectoryEntry *page_directory_entry = &page_directory->entries[page_directory_index];
 
         if (!page_directory_entry->Present)
         {
+            offset += ARCH_PAGE_SIZE;
             continue;
         }
 
+        if (page_directory_entry->LargePage)
+        {
+            if (virtual_address % LARGE_PAGE_SIZE == 0 && virtual_range.size() - offset >= LARGE_PAGE_SIZE)
+            {
+                page_directory_entry->as_uint = 0;
+
+                offset += LARGE_PAGE_SIZE;
+                continue;
+            }
+
+            assert(SUCCESS == page_directory_split(address_space, *page_directory_entry));
+        }
+
         PageTable *page_table = (PageTable *)(page_directory_entry->PageFrameNumber * ARCH_PAGE_SIZE);
 
-        size_t page_table_index = PAGE_TABLE_INDEX(virtual_range.base() + offset);
+        size_t page_table_index = PAGE_TABLE_INDEX(virtual_address);
         PageTableEntry *page_table_entry = &page_table->entries[page_table_index];
 
         if (page_table_entry->Present)
         {
             page_table_entry->as_uint = 0;
         }
+
+        offset += ARCH_PAGE_SIZE;
     }
 
+    virtual_ranges_free(virtual_ranges_of(address_space, virtual_range.base()), virtual_range);
+
     paging_invalidate_tlb();
+
+    // The kernel page tables are shared by every address spaces,
+    // so other processors might have them in their TLB.
+    if (PAGE_DIRECTORY_INDEX(virtual_range.base()) < 256)
+    {
+        smp_invalidate_tlb_others();
+    }
 }
 
 void *arch_address_space_create()
 {
-    InterruptsRetainer retainer;
+    auto address_space = new AddressSpace{};
 
-    PageDirectory *page_directory = nullptr;
-
-    if (memory_alloc(arch_kernel_address_space(), sizeof(PageDirectory), MEMORY_CLEAR, (uintptr_t *)&page_directory) != SUCCESS)
     {
-        logger_error("Page directory allocation failed!");
+        SpinlockHolder holder(memory_lock);
 
-        return nullptr;
-    }
+        if (memory_alloc(arch_kernel_address_space(), sizeof(PageDirectory), MEMORY_CLEAR, (uintptr_t *)&address_space->directory) == SUCCESS)
+        {
+            PageDirectory *page_directory = address_space->directory;
 
-    memset(page_directory, 0, sizeof(PageDirectory));
+            memset(page_directory, 0, sizeof(PageDirectory));
 
-    // Copy first gigs of virtual memory (kernel space);
-    for (size_t i = 0; i < 256; i++)
+            // Copy first gigs of virtual memory (kernel space);
+            for (size_t i = 0; i < 256; i++)
+            {
+                PageDirectoryEntry *page_directory_entry = &page_directory->entries[i];
+
+                page_directory_entry->User = 0;
+                page_directory_entry->Write = 1;
+                page_directory_entry->Present = 1;
+                page_directory_entry->PageFrameNumber = (uint32_t)&_kernel_page_tables[i] / ARCH_PAGE_SIZE;
+            }
+
+            virtual_ranges_initialize(&address_space->ranges, {USER_VIRTUAL_BASE, USER_VIRTUAL_SIZE});
+        }
+    }
+
+    if (!address_space->directory)
     {
-        PageDirectoryEntry *page_directory_entry = &page_directory->entries[i];
+        logger_error("Page directory allocation failed!");
+
+        delete address_space;
 
-        page_directory_entry->User = 0;
-        page_directory_entry->Write = 1;
-        page_directory_entry->Present = 1;
-        page_directory_entry->PageFrameNumber = (uint32_t)&_kernel_page_tables[i] / ARCH_PAGE_SIZE;
+        return nullptr;
     }
 
-    return page_directory;
+    return address_space;
 }
 
 void arch_address_space_destroy(void *address_space)
 {
-    InterruptsRetainer retainer;
-
     assert(address_space != arch_kernel_address_space());
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
-
-    for (size_t i = 256; i < 1024; i++)
     {
-        PageDirectoryEntry *page_directory_entry = &page_directory->entries[i];
+        SpinlockHolder holder(memory_lock);
+
+        auto page_directory = page_directory_of(address_space);
 
-        if (page_directory_entry->Present)
+        for (size_t i = 256; i < 1024; i++)
         {
-            PageTable *page_table = (PageTable *)(page_directory_entry->PageFrameNumber * ARCH_PAGE_SIZE);
+            PageDirectoryEntry *page_directory_entry = &page_directory->entries[i];
 
-            for (size_t i = 0; i < 1024; i++)
+            if (page_directory_entry->Present && page_directory_entry->LargePage)
             {
-                PageTableEntry *page_table_entry = &page_table->entries[i];
+                physical_free({(uintptr_t)page_directory_entry->PageFrameNumber * ARCH_PAGE_SIZE, LARGE_PAGE_SIZE});
+            }
+            else if (page_directory_entry->Present)
+            {
+                PageTable *page_table = (PageTable *)(page_directory_entry->PageFrameNumber * ARCH_PAGE_SIZE);
 
-                if (page_table_entry->Present)
+                for (size_t i = 0; i < 1024; i++)
                 {
-                    uintptr_t physical_address = page_table_entry->PageFrameNumber * ARCH_PAGE_SIZE;
+                    PageTableEntry *page_table_entry = &page_table->entries[i];
 
-                    MemoryRange physical_range{physical_address, ARCH_PAGE_SIZE};
+                    if (page_table_entry->Present)
+                    {
+                        uintptr_t physical_address = page_table_entry->PageFrameNumber * ARCH_PAGE_SIZE;
 
-                    physical_free(physical_range);
+                        MemoryRange physical_range{physical_address, ARCH_PAGE_SIZE};
+
+                        physical_free(physical_range);
+                    }
                 }
-            }
 
-            memory_free(arch_kernel_address_space(), (MemoryRange){(uintptr_t)page_table, sizeof(PageTable)});
+                memory_free(arch_kernel_address_space(), (MemoryRange){(uintptr_t)page_table, sizeof(PageTable)});
+            }
         }
+
+        memory_free(arch_kernel_address_space(), (MemoryRange){(uintptr_t)page_directory, sizeof(PageDirectory)});
+
+        virtual_ranges_destroy(&reinterpret_cast<AddressSpace *>(address_space)->ranges);
     }
 
-    memory_free(arch_kernel_address_space(), (MemoryRange){(uintptr_t)page_directory, sizeof(PageDirectory)});
+    delete reinterpret_cast<AddressSpace *>(address_space);
 }
 
 void arch_address_space_switch(void *address_space)
 {
-    InterruptsRetainer retainer;
-    paging_load_directory(arch_virtual_to_physical(arch_kernel_address_space(), (uintptr_t)address_space));
+    SpinlockHolder holder(memory_lock);
+    paging_load_directory(arch_virtual_to_physical(arch_kernel_address_space(), (uintptr_t)page_directory_of(address_space)));
 }
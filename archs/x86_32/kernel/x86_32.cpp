@@ -8,27 +8,39 @@
 #include "archs/x86/kernel/PIC.h"
 #include "archs/x86/kernel/PIT.h"
 #include "archs/x86/kernel/RTC.h"
+#include "archs/x86/kernel/TSC.h"
 #include "archs/x86_32/kernel/ACPI.h"
 #include "archs/x86_32/kernel/GDT.h"
 #include "archs/x86_32/kernel/IDT.h"
 #include "archs/x86_32/kernel/Interrupts.h"
 #include "archs/x86_32/kernel/LAPIC.h"
 #include "archs/x86_32/kernel/Power.h"
+#include "archs/x86_32/kernel/SMP.h"
 #include "archs/x86_32/kernel/x86_32.h"
 
 #include "kernel/firmware/SMBIOS.h"
 #include "kernel/graphics/EarlyConsole.h"
 #include "kernel/graphics/Graphics.h"
+#include "kernel/interrupts/Interupts.h"
 #include "kernel/system/System.h"
 
 void arch_disable_interrupts() { cli(); }
 
 void arch_enable_interrupts() { sti(); }
 
+bool arch_interrupts_enabled() { return interrupts_flag(); }
+
 void arch_halt() { hlt(); }
 
+void arch_idle() { asm volatile("sti; hlt"); }
+
 void arch_yield() { asm("int $127"); }
 
+void arch_initialize_context(Task *task)
+{
+    fpu_initialize_context(task);
+}
+
 void arch_save_context(Task *task)
 {
     fpu_save_context(task);
@@ -83,6 +95,72 @@ size_t arch_debug_write(const void *buffer, size_t size) { return com_write(COM1
 
 TimeStamp arch_get_time() { return rtc_now(); }
 
+uint64_t arch_get_cycles() { return rdtsc(); }
+
+void arch_timer_initialize()
+{
+    tsc_calibrate();
+
+    if (lapic_available())
+    {
+        lapic_initialize();
+        lapic_enable();
+        lapic_enable_legacy_interrupts();
+        lapic_timer_calibrate();
+    }
+
+    if (!tsc_calibrated())
+    {
+        return;
+    }
+
+    system_clock_start();
+
+    if (!lapic_available())
+    {
+        return;
+    }
+
+    // The local APIC timer takes over from the PIT, every processors
+    // program it for the next thing they have to do, see system_timer_rearm().
+    InterruptsRetainer retainer;
+
+    pit_stop();
+    lapic_timer_start_oneshot(INTERRUPT_LAPIC_TIMER);
+    system_timer_rearm(false);
+
+    logger_info("Running tickless");
+}
+
+uint64_t arch_get_nanoseconds() { return tsc_nanoseconds(); }
+
+void arch_timer_oneshot(uint64_t nanoseconds)
+{
+    if (lapic_timer_is_oneshot())
+    {
+        lapic_timer_oneshot(nanoseconds);
+    }
+}
+
+int arch_cpu_current()
+{
+    uint16_t selector = str();
+
+    // The task register is loaded by gdt_initialize(), early in the boot.
+    if (selector < GDT_TSS_SELECTOR(0))
+    {
+        return 0;
+    }
+
+    return (selector - GDT_TSS_SELECTOR(0)) / sizeof(GDTEntry);
+}
+
+void arch_cpu_start_others() { smp_initialize(); }
+
+void arch_cpu_wake(int cpu) { smp_wake(cpu); }
+
+void arch_cpu_stop_others() { smp_stop_others(); }
+
 extern "C" void arch_main(void *info, uint32_t magic)
 {
     __plug_initialize();
@@ -105,7 +183,7 @@ extern "C" void arch_main(void *info, uint32_t magic)
     idt_initialize();
     pic_initialize();
     fpu_initialize();
-    pit_initialize(1000);
+    pit_initialize(SYSTEM_TICKS_PER_SECOND);
 
     acpi_initialize(handover);
     //lapic_initialize();
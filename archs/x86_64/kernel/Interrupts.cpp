@@ -4,8 +4,11 @@
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
+#include "kernel/system/Trace.h"
 #include "kernel/tasking/Syscalls.h"
+#include "kernel/tasking/Task-Memory.h"
 
+#include "archs/x86/kernel/FPU.h"
 #include "archs/x86/kernel/PIC.h"
 
 #include "archs/x86_64/kernel/Interrupts.h"
@@ -52,7 +55,16 @@ extern "C" uint64_t interrupts_handler(uintptr_t rsp)
 
     if (stackframe->intno < 32)
     {
-        if (stackframe->cs == 0x1B)
+        if (stackframe->intno == 7)
+        {
+            // The task touched the FPU since it was switched in, bring its state back.
+            fpu_handle_not_available(scheduler_running());
+        }
+        else if (stackframe->intno == 14 && task_memory_handle_fault(scheduler_running(), CR2()))
+        {
+            // The page was brought in, retry the access.
+        }
+        else if (stackframe->cs == 0x1B)
         {
             sti();
 
@@ -84,6 +96,8 @@ extern "C" uint64_t interrupts_handler(uintptr_t rsp)
     {
         interrupts_disable_holding();
 
+        trace_record(TRACE_EVENT_INTERRUPT, scheduler_running_id(), stackframe->intno);
+
         int irq = stackframe->intno - 32;
 
         if (irq == 0)
@@ -2,6 +2,8 @@
 
 #include <libsystem/Common.h>
 
+#include "kernel/memory/VirtualRanges.h"
+
 struct __packed PageMappingLevel4Entry
 {
     bool present : 1;               // Must be 1 to reference a PML-1
@@ -38,7 +40,7 @@ struct __packed PageMappingLevel3Entry
     bool cache : 1;                 // Page-level cache disable
     bool accessed : 1;              // Indicates whether this entry has been used
     int zero0 : 1;                  // Ignored
-    int size : 1;                   // Must be 0 otherwise, this entry maps a 1-GByte page.
+    bool size : 1;                  // Must be 0 otherwise, this entry maps a 1-GByte page.
     int zero1 : 4;                  // Ignored
     uint64_t physical_address : 36; // Physical address of a 4-KByte aligned PLM-1
     int zero2 : 15;                 // Ignored
@@ -67,7 +69,7 @@ struct __packed PageMappingLevel2Entry
     bool cache : 1;                 // Page-level cache disable
     bool accessed : 1;              // Indicates whether this entry has been used
     int zero0 : 1;                  // Ignored
-    int size : 1;                   // Must be 0 otherwise, this entry maps a 2-MByte page.
+    bool size : 1;                  // Must be 0 otherwise, this entry maps a 2-MByte page.
     int zero1 : 4;                  // Ignored
     uint64_t physical_address : 36; // Physical address of a 4-KByte aligned PLM-1
     int zero2 : 15;                 // Ignored
@@ -79,6 +81,9 @@ struct __packed PageMappingLevel2
     PageMappingLevel3Entry entries[512];
 };
 
+// A level 2 entry with the size bit set maps 2Mio at once.
+#define LARGE_PAGE_SIZE (512 * ARCH_PAGE_SIZE)
+
 static inline size_t pml2_index(uintptr_t address)
 {
     return (address >> 21) & 0x1FF;
@@ -118,6 +123,15 @@ static inline size_t pml1_index(uintptr_t address)
 static_assert(sizeof(PageMappingLevel1Entry) == sizeof(uint64_t));
 static_assert(sizeof(PageMappingLevel1) == 4096);
 
+struct AddressSpace
+{
+    PageMappingLevel4 *pml4;
+
+    // Free virtual memory of the user half, the kernel half is shared by
+    // every address spaces and tracked by the kernel address space.
+    VirtualRanges ranges;
+};
+
 extern "C" void paging_load_directory(uintptr_t directory);
 
 extern "C" void paging_invalidate_tlb();
@@ -16,13 +16,41 @@ PageMappingLevel3 kpml3 __aligned(ARCH_PAGE_SIZE) = {};
 PageMappingLevel2 kpml2 __aligned(ARCH_PAGE_SIZE) = {};
 PageMappingLevel1 kpml1[512] __aligned(ARCH_PAGE_SIZE) = {};
 
+AddressSpace _kernel_address_space = {};
+
+// The first gigabyte belongs to the kernel, the rest to userspace.
+static constexpr uintptr_t USER_VIRTUAL_BASE = 256 * 1024 * ARCH_PAGE_SIZE;
+static constexpr size_t USER_VIRTUAL_SIZE = (size_t)768 * 1024 * ARCH_PAGE_SIZE;
+
+static PageMappingLevel4 *pml4_of(void *address_space)
+{
+    return reinterpret_cast<AddressSpace *>(address_space)->pml4;
+}
+
+static VirtualRanges *virtual_ranges_of(void *address_space, uintptr_t virtual_address)
+{
+    if (virtual_address < USER_VIRTUAL_BASE)
+    {
+        return &_kernel_address_space.ranges;
+    }
+    else
+    {
+        return &reinterpret_cast<AddressSpace *>(address_space)->ranges;
+    }
+}
+
 void *arch_kernel_address_space()
 {
-    return &kpml4;
+    return &_kernel_address_space;
 }
 
 void arch_virtual_initialize()
 {
+    _kernel_address_space.pml4 = &kpml4;
+
+    // We skip the first page to make null deref trigger a page fault.
+    virtual_ranges_initialize(&_kernel_address_space.ranges, {ARCH_PAGE_SIZE, USER_VIRTUAL_BASE - ARCH_PAGE_SIZE});
+
     auto &pml4_entry = kpml4.entries[0];
     pml4_entry.user = 0;
     pml4_entry.writable = 1;
@@ -50,11 +78,50 @@ void arch_virtual_memory_enable()
     arch_address_space_switch(arch_kernel_address_space());
 }
 
+size_t arch_large_page_size()
+{
+    return LARGE_PAGE_SIZE;
+}
+
+// The kernel half is shared by every address spaces through the kernel page
+// tables, so only the user half can be mapped with large pages.
+static bool pml2_can_map_large(uintptr_t virtual_address, uintptr_t physical_address, size_t size)
+{
+    return virtual_address >= USER_VIRTUAL_BASE &&
+           virtual_address % LARGE_PAGE_SIZE == 0 &&
+           physical_address % LARGE_PAGE_SIZE == 0 &&
+           size >= LARGE_PAGE_SIZE;
+}
+
+// Replace a large page by a level 1 table mapping the same memory, so parts of it can be changed.
+static Result pml2_split(void *address_space, PageMappingLevel3Entry *pml2_entry)
+{
+    PageMappingLevel1 *pml1 = nullptr;
+    TRY(memory_alloc_identity(address_space, MEMORY_CLEAR, (uintptr_t *)&pml1));
+
+    for (size_t i = 0; i < 512; i++)
+    {
+        auto &pml1_entry = pml1->entries[i];
+
+        pml1_entry.present = 1;
+        pml1_entry.writable = pml2_entry->writable;
+        pml1_entry.user = pml2_entry->user;
+        pml1_entry.physical_address = pml2_entry->physical_address + i;
+    }
+
+    pml2_entry->size = 0;
+    pml2_entry->writable = 1;
+    pml2_entry->user = 1;
+    pml2_entry->physical_address = (uint64_t)(pml1) / ARCH_PAGE_SIZE;
+
+    return SUCCESS;
+}
+
 bool arch_virtual_present(void *address_space, uintptr_t virtual_address)
 {
     ASSERT_INTERRUPTS_RETAINED();
 
-    auto pml4 = reinterpret_cast<PageMappingLevel4 *>(address_space);
+    auto pml4 = pml4_of(address_space);
     auto &pml4_entry = pml4->entries[pml4_index(virtual_address)];
 
     if (!pml4_entry.present)
@@ -78,6 +145,11 @@ bool arch_virtual_present(void *address_space, uintptr_t virtual_address)
         return false;
     }
 
+    if (pml2_entry.size)
+    {
+        return true;
+    }
+
     auto pml1 = reinterpret_cast<PageMappingLevel1 *>(pml2_entry.physical_address * ARCH_PAGE_SIZE);
     auto &pml1_entry = pml1->entries[pml1_index(virtual_address)];
 
@@ -88,7 +160,7 @@ uintptr_t arch_virtual_to_physical(void *address_space, uintptr_t virtual_addres
 {
     ASSERT_INTERRUPTS_RETAINED();
 
-    auto pml4 = reinterpret_cast<PageMappingLevel4 *>(address_space);
+    auto pml4 = pml4_of(address_space);
     auto &pml4_entry = pml4->entries[pml4_index(virtual_address)];
 
     if (!pml4_entry.present)
@@ -112,6 +184,11 @@ uintptr_t arch_virtual_to_physical(void *address_space, uintptr_t virtual_addres
         return 0;
     }
 
+    if (pml2_entry.size)
+    {
+        return (pml2_entry.physical_address * ARCH_PAGE_SIZE) + (virtual_address & (LARGE_PAGE_SIZE - 1));
+    }
+
     auto pml1 = reinterpret_cast<PageMappingLevel1 *>(pml2_entry.physical_address * ARCH_PAGE_SIZE);
     auto &pml1_entry = pml1->entries[pml1_index(virtual_address)];
 
@@ -127,11 +204,13 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
 {
     ASSERT_INTERRUPTS_RETAINED();
 
-    auto plm4 = reinterpret_cast<PageMappingLevel4 *>(address_space);
+    auto plm4 = pml4_of(address_space);
+
+    size_t offset = 0;
 
-    for (size_t i = 0; i < physical_range.page_count(); i++)
+    while (offset < physical_range.size())
     {
-        uint64_t address = virtual_address + i * ARCH_PAGE_SIZE;
+        uint64_t address = virtual_address + offset;
 
         auto pml4_entry = &plm4->entries[pml4_index(address)];
         auto pml3 = reinterpret_cast<PageMappingLevel3 *>(pml4_entry->physical_address * ARCH_PAGE_SIZE);
@@ -160,6 +239,26 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
         }
 
         auto pml2_entry = &pml2->entries[pml2_index(address)];
+
+        if ((!pml2_entry->present || pml2_entry->size) &&
+            pml2_can_map_large(address, physical_range.base() + offset, physical_range.size() - offset))
+        {
+            *pml2_entry = {};
+            pml2_entry->present = 1;
+            pml2_entry->writable = !(flags & MEMORY_READONLY);
+            pml2_entry->user = flags & MEMORY_USER;
+            pml2_entry->size = 1;
+            pml2_entry->physical_address = (physical_range.base() + offset) / ARCH_PAGE_SIZE;
+
+            offset += LARGE_PAGE_SIZE;
+            continue;
+        }
+
+        if (pml2_entry->present && pml2_entry->size)
+        {
+            TRY(pml2_split(address_space, pml2_entry));
+        }
+
         auto pml1 = reinterpret_cast<PageMappingLevel1 *>(pml2_entry->physical_address * ARCH_PAGE_SIZE);
 
         if (!pml2_entry->present)
@@ -175,11 +274,15 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
         auto pml1_entry = &pml1->entries[pml1_index(address)];
 
         pml1_entry->present = 1;
-        pml1_entry->writable = 1;
+        pml1_entry->writable = !(flags & MEMORY_READONLY);
         pml1_entry->user = flags & MEMORY_USER;
-        pml1_entry->physical_address = (physical_range.base() + i * ARCH_PAGE_SIZE) / ARCH_PAGE_SIZE;
+        pml1_entry->physical_address = (physical_range.base() + offset) / ARCH_PAGE_SIZE;
+
+        offset += ARCH_PAGE_SIZE;
     }
 
+    virtual_ranges_reserve(virtual_ranges_of(address_space, virtual_address), {virtual_address, physical_range.size()});
+
     paging_invalidate_tlb();
 
     return SUCCESS;
@@ -189,50 +292,60 @@ MemoryRange arch_virtual_alloc(void *address_space, MemoryRange physical_range,
 {
     ASSERT_INTERRUPTS_RETAINED();
 
+    auto virtual_range = arch_virtual_reserve(address_space, physical_range.size(), flags);
+
+    assert(SUCCESS == arch_virtual_map(address_space, physical_range, virtual_range.base(), flags));
+
+    return virtual_range;
+}
+
+MemoryRange arch_virtual_reserve(void *address_space, size_t size, MemoryFlags flags)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
     bool is_user_memory = flags & MEMORY_USER;
 
-    uintptr_t virtual_address = 0;
-    size_t current_size = 0;
+    auto ranges = virtual_ranges_of(address_space, is_user_memory ? USER_VIRTUAL_BASE : 0);
+
+    // Big enough to be backed by large pages, which need aligned virtual addresses.
+    size_t align = ARCH_PAGE_SIZE;
 
-    // we skip the first page to make null deref trigger a page fault
-    for (size_t i = (is_user_memory ? 256 : 1) * 1024; i < (is_user_memory ? 1024 : 256) * 1024; i++)
+    if (is_user_memory && size >= LARGE_PAGE_SIZE)
     {
-        uintptr_t current_address = i * ARCH_PAGE_SIZE;
+        align = LARGE_PAGE_SIZE;
+    }
 
-        if (!arch_virtual_present(address_space, current_address))
-        {
-            if (current_size == 0)
-            {
-                virtual_address = current_address;
-            }
+    auto virtual_range = virtual_ranges_alloc_aligned(ranges, size, align);
 
-            current_size += ARCH_PAGE_SIZE;
+    if (virtual_range.empty())
+    {
+        system_panic("Out of virtual memory!");
+    }
 
-            if (current_size == physical_range.size())
-            {
-                assert(SUCCESS == arch_virtual_map(address_space, physical_range, virtual_address, flags));
+    return virtual_range;
+}
 
-                return (MemoryRange){virtual_address, current_size};
-            }
-        }
-        else
-        {
-            current_size = 0;
-        }
-    }
+void arch_virtual_reserve_at(void *address_space, MemoryRange virtual_range)
+{
+    ASSERT_INTERRUPTS_RETAINED();
 
-    system_panic("Out of virtual memory!");
+    virtual_ranges_reserve(virtual_ranges_of(address_space, virtual_range.base()), virtual_range);
 }
 
 void arch_virtual_free(void *address_space, MemoryRange virtual_range)
 {
     ASSERT_INTERRUPTS_RETAINED();
 
-    for (size_t i = 0; i < virtual_range.page_count(); i++)
+    size_t offset = 0;
+
+    while (offset < virtual_range.size())
     {
-        uint64_t address = virtual_range.base() + i * ARCH_PAGE_SIZE;
+        uint64_t address = virtual_range.base() + offset;
+        size_t remaining = virtual_range.size() - offset;
+
+        offset += ARCH_PAGE_SIZE;
 
-        auto plm4 = reinterpret_cast<PageMappingLevel4 *>(address_space);
+        auto plm4 = pml4_of(address_space);
         auto pml4_entry = &plm4->entries[pml4_index(address)];
 
         if (!pml4_entry->present)
@@ -256,12 +369,27 @@ void arch_virtual_free(void *address_space, MemoryRange virtual_range)
             continue;
         }
 
+        if (pml2_entry->size)
+        {
+            if (address % LARGE_PAGE_SIZE == 0 && remaining >= LARGE_PAGE_SIZE)
+            {
+                *pml2_entry = {};
+
+                offset = address - virtual_range.base() + LARGE_PAGE_SIZE;
+                continue;
+            }
+
+            assert(SUCCESS == pml2_split(address_space, pml2_entry));
+        }
+
         auto pml1 = reinterpret_cast<PageMappingLevel1 *>(pml2_entry->physical_address * ARCH_PAGE_SIZE);
         auto pml1_entry = &pml1->entries[pml1_index(address)];
 
         *pml1_entry = {};
     }
 
+    virtual_ranges_free(virtual_ranges_of(address_space, virtual_range.base()), virtual_range);
+
     paging_invalidate_tlb();
 }
 
@@ -297,7 +425,15 @@ void *arch_address_space_create()
         pml2_entry.physical_address = (uint64_t)&kpml1[i] / ARCH_PAGE_SIZE;
     }
 
-    return pml4;
+    auto address_space = new AddressSpace{};
+    address_space->pml4 = pml4;
+
+    {
+        SpinlockHolder holder(memory_lock);
+        virtual_ranges_initialize(&address_space->ranges, {USER_VIRTUAL_BASE, USER_VIRTUAL_SIZE});
+    }
+
+    return address_space;
 }
 
 void arch_address_space_destroy(void *address_space)
@@ -311,5 +447,5 @@ void arch_address_space_destroy(void *address_space)
 
 void arch_address_space_switch(void *address_space)
 {
-    paging_load_directory((uintptr_t)address_space);
+    paging_load_directory((uintptr_t)pml4_of(address_space));
 }
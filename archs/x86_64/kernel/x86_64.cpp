@@ -16,6 +16,7 @@
 #include "archs/x86/kernel/PIC.h"
 #include "archs/x86/kernel/PIT.h"
 #include "archs/x86/kernel/RTC.h"
+#include "archs/x86/kernel/TSC.h"
 
 #include "archs/x86_64/kernel/GDT.h"
 #include "archs/x86_64/kernel/IDT.h"
@@ -44,7 +45,7 @@ extern "C" void arch_main(void *info, uint32_t magic)
     idt_initialize();
     pic_initialize();
     fpu_initialize();
-    pit_initialize(1000);
+    pit_initialize(SYSTEM_TICKS_PER_SECOND);
 
     system_main(handover);
 
@@ -55,16 +56,28 @@ void arch_disable_interrupts() { cli(); }
 
 void arch_enable_interrupts() { sti(); }
 
+bool arch_interrupts_enabled() { return interrupts_flag(); }
+
 void arch_halt()
 {
     hlt();
 }
 
+void arch_idle()
+{
+    asm volatile("sti; hlt");
+}
+
 void arch_yield()
 {
     asm("int $127");
 }
 
+void arch_initialize_context(Task *task)
+{
+    fpu_initialize_context(task);
+}
+
 void arch_save_context(Task *task)
 {
     fpu_save_context(task);
@@ -120,6 +133,38 @@ TimeStamp arch_get_time()
     return rtc_now();
 }
 
+uint64_t arch_get_cycles()
+{
+    return rdtsc();
+}
+
+// There is no local APIC support yet, the PIT keeps ticking.
+void arch_timer_initialize()
+{
+    tsc_calibrate();
+
+    if (tsc_calibrated())
+    {
+        system_clock_start();
+    }
+}
+
+uint64_t arch_get_nanoseconds()
+{
+    return tsc_nanoseconds();
+}
+
+void arch_timer_oneshot(uint64_t) {}
+
+// Only the boot processor is used on x86_64.
+int arch_cpu_current() { return 0; }
+
+void arch_cpu_start_others() {}
+
+void arch_cpu_wake(int) {}
+
+void arch_cpu_stop_others() {}
+
 __no_return void arch_reboot()
 {
     logger_warn("STUB %s", __func__);
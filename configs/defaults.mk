@@ -12,6 +12,8 @@ CONFIGS = \
 	CONFIG_DISPLAY \
 	CONFIG_VMACHINE \
 	CONFIG_KEYBOARD_LAYOUT \
+	CONFIG_PIPE_BUFFER_MAX_SIZE \
+	CONFIG_CONNECTION_BUFFER_MAX_SIZE \
 	CONFIG_LOADER \
 	CONFIG_LOG \
 	CONFIG_LTO \
@@ -61,6 +63,12 @@ CONFIG_VMACHINE       ?=qemu
 # Possible values: (check the content of /System/Keyboard)
 CONFIG_KEYBOARD_LAYOUT?=en_us
 
+# How many kilobytes the buffer of a pipe can grow to.
+CONFIG_PIPE_BUFFER_MAX_SIZE?=256
+
+# How many kilobytes each direction of a connection can grow to.
+CONFIG_CONNECTION_BUFFER_MAX_SIZE?=64
+
 # Set the bootloader.
 # Possible values: grub, limine
 CONFIG_LOADER         ?=grub
@@ -42,7 +42,9 @@ KERNEL_CXXFLAGS += \
 	-ffreestanding \
 	-nostdlib \
 	-D__KERNEL__ \
-	-DCONFIG_KEYBOARD_LAYOUT=\""${CONFIG_KEYBOARD_LAYOUT}"\"
+	-DCONFIG_KEYBOARD_LAYOUT=\""${CONFIG_KEYBOARD_LAYOUT}"\" \
+	-DCONFIG_PIPE_BUFFER_MAX_SIZE=${CONFIG_PIPE_BUFFER_MAX_SIZE} \
+	-DCONFIG_CONNECTION_BUFFER_MAX_SIZE=${CONFIG_CONNECTION_BUFFER_MAX_SIZE}
 
 OBJECTS += $(KERNEL_OBJECTS)
 
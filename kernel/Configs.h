@@ -3,3 +3,12 @@
 #ifndef CONFIG_KEYBOARD_LAYOUT
 #    define CONFIG_KEYBOARD_LAYOUT "en_us"
 #endif
+
+// In kilobytes, pipes and connections start smaller and grow up to it.
+#ifndef CONFIG_PIPE_BUFFER_MAX_SIZE
+#    define CONFIG_PIPE_BUFFER_MAX_SIZE 256
+#endif
+
+#ifndef CONFIG_CONNECTION_BUFFER_MAX_SIZE
+#    define CONFIG_CONNECTION_BUFFER_MAX_SIZE 64
+#endif
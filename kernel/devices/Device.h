@@ -10,6 +10,7 @@
 
 #include "kernel/devices/DeviceAddress.h"
 #include "kernel/devices/DeviceClass.h"
+#include "kernel/scheduling/WaitQueue.h"
 
 class Device : public RefCounted<Device>
 {
@@ -20,6 +21,8 @@ private:
 
     Vector<RefPtr<Device>> _childs{};
 
+    WaitQueue _wait_queue{};
+
 public:
     DeviceClass klass()
     {
@@ -45,6 +48,12 @@ public:
         return _address;
     }
 
+    // Tasks blocked on this device, woken up after each of its interrupts.
+    WaitQueue &wait_queue()
+    {
+        return _wait_queue;
+    }
+
     void add(RefPtr<Device> child)
     {
         _childs.push_back(child);
@@ -68,8 +77,15 @@ public:
 
     virtual int interrupt() { return -1; }
 
+    // Level of the scheduler the task running handle_interrupt() is pinned
+    // at, see kernel/interrupts/Dispatcher.h. Devices returning -1 share a
+    // single task with every others.
+    virtual int interrupt_priority() { return -1; }
+
+    // Top half, runs in the interrupt handler.
     virtual void acknowledge_interrupt() {}
 
+    // Bottom half, runs in a task and may take locks.
     virtual void handle_interrupt() {}
 
     virtual bool did_fail()
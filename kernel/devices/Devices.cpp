@@ -10,6 +10,7 @@
 #include "kernel/bus/UNIX.h"
 #include "kernel/devices/Devices.h"
 #include "kernel/devices/Driver.h"
+#include "kernel/interrupts/Dispatcher.h"
 
 static Vector<RefPtr<Device>> *_devices = nullptr;
 
@@ -77,30 +78,6 @@ void device_iterate(IterationCallback<RefPtr<Device>> callback)
     }
 }
 
-void devices_acknowledge_interrupt(int interrupt)
-{
-    device_iterate([&](auto device) {
-        if (device->interrupt() == interrupt)
-        {
-            device->acknowledge_interrupt();
-        }
-
-        return Iteration::CONTINUE;
-    });
-}
-
-void devices_handle_interrupt(int interrupt)
-{
-    device_iterate([&](auto device) {
-        if (device->interrupt() == interrupt)
-        {
-            device->handle_interrupt();
-        }
-
-        return Iteration::CONTINUE;
-    });
-}
-
 void device_initialize()
 {
     pci_initialize();
@@ -131,4 +108,9 @@ void device_initialize()
 
         return Iteration::CONTINUE;
     });
+
+    device_iterate([&](auto device) {
+        dispatcher_register(device);
+        return Iteration::CONTINUE;
+    });
 }
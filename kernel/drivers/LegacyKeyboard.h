@@ -28,6 +28,9 @@ private:
 public:
     LegacyKeyboard(DeviceAddress address);
 
+    // Keystrokes must not wait behind slower devices.
+    int interrupt_priority() override { return 0; }
+
     void handle_interrupt() override;
 
     bool can_read() override;
@@ -29,6 +29,8 @@ private:
 public:
     LegacyMouse(DeviceAddress address);
 
+    int interrupt_priority() override { return 0; }
+
     void handle_interrupt() override;
 
     bool can_read() override;
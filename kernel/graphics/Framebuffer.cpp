@@ -7,6 +7,7 @@
 
 #include "kernel/graphics/Graphics.h"
 #include "kernel/interrupts/Interupts.h"
+#include "kernel/memory/Memory.h"
 #include "kernel/node/Node.h"
 #include "kernel/scheduling/Scheduler.h"
 
@@ -88,14 +89,19 @@ void framebuffer_initialize(Handover *handover)
     }
 
     _framebuffer_physical = handover->framebuffer_addr;
-    _framebuffer_virtual = arch_virtual_alloc(
-                               arch_kernel_address_space(),
-                               (MemoryRange){
-                                   _framebuffer_physical,
-                                   PAGE_ALIGN_UP(_framebuffer_width * _framebuffer_height * sizeof(uint32_t)),
-                               },
-                               MEMORY_NONE)
-                               .base();
+
+    {
+        SpinlockHolder holder(memory_lock);
+
+        _framebuffer_virtual = arch_virtual_alloc(
+                                   arch_kernel_address_space(),
+                                   (MemoryRange){
+                                       _framebuffer_physical,
+                                       PAGE_ALIGN_UP(_framebuffer_width * _framebuffer_height * sizeof(uint32_t)),
+                                   },
+                                   MEMORY_NONE)
+                                   .base();
+    }
 
     if (_framebuffer_virtual == 0)
     {
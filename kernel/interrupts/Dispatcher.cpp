@@ -1,78 +1,204 @@
+#include <abi/Process.h>
 #include <assert.h>
 #include <libsystem/Logger.h>
-#include <libutils/RingBuffer.h>
+#include <libsystem/math/MinMax.h>
+#include <stdio.h>
 
-#include "kernel/devices/Devices.h"
 #include "kernel/interrupts/Dispatcher.h"
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/scheduling/Blocker.h"
 #include "kernel/scheduling/Scheduler.h"
 
-static bool _pending_interrupts[256] = {};
+struct DispatcherLine
+{
+    Vector<RefPtr<Device>> *devices = nullptr;
 
-void dispatcher_initialize()
+    // Task running the bottom halves of this line,
+    // nullptr if they are run by the shared dispatcher task.
+    Task *task = nullptr;
+    int priority = -1;
+
+    WaitQueue wait_queue{};
+};
+
+static DispatcherLine _lines[DISPATCHER_LINE_COUNT] = {};
+
+// One bit per line, set by the top half and cleared by whoever runs the bottom halves.
+static uint32_t _pending = 0;
+
+// Lines with a task of their own, the shared dispatcher task leaves them alone.
+static uint32_t _threaded = 0;
+
+static WaitQueue _dispatcher_wait_queue{};
+
+class BlockerDispatcher : public Blocker
 {
-    Task *interrupts_dispatcher_task = task_spawn(nullptr, "interrupts-dispatcher", dispatcher_service, nullptr, false);
-    task_go(interrupts_dispatcher_task);
-}
+private:
+    WaitQueue &_queue;
+    uint32_t _mask;
 
-void dispatcher_dispatch(int interrupt)
+public:
+    BlockerDispatcher(WaitQueue &queue, uint32_t mask) : _queue(queue), _mask(mask) {}
+
+    bool can_unblock(Task &) override
+    {
+        return __atomic_load_n(&_pending, __ATOMIC_ACQUIRE) & _mask;
+    }
+
+    void enqueue(Task &task) override
+    {
+        wait_on(_queue, task);
+    }
+};
+
+static void dispatcher_handle(int interrupt)
 {
-    _pending_interrupts[interrupt] = true;
-    devices_acknowledge_interrupt(interrupt);
+    _lines[interrupt].devices->foreach ([&](auto &device) {
+        device->handle_interrupt();
+
+        // Waiters are woken up right away, not once every lines are serviced.
+        device->wait_queue().wake_up();
+
+        return Iteration::CONTINUE;
+    });
 }
 
-static bool dispatcher_has_interrupt()
+static void dispatcher_service_line(int interrupt)
 {
-    InterruptsRetainer retainer;
+    auto &line = _lines[interrupt];
+    uint32_t bit = 1u << interrupt;
 
-    int result = 0;
+    while (true)
+    {
+        BlockerDispatcher blocker{line.wait_queue, bit};
+        assert(task_block(scheduler_running(), blocker, -1) == SUCCESS);
 
-    for (size_t i = 0; i < 256; i++)
+        while (__atomic_fetch_and(&_pending, ~bit, __ATOMIC_ACQ_REL) & bit)
+        {
+            dispatcher_handle(interrupt);
+        }
+    }
+}
+
+static void dispatcher_thread_entry()
+{
+    for (int i = 0; i < DISPATCHER_LINE_COUNT; i++)
     {
-        if (_pending_interrupts[i])
+        if (_lines[i].task == scheduler_running())
         {
-            result++;
+            dispatcher_service_line(i);
         }
     }
 
-    return result > 0;
+    ASSERT_NOT_REACHED();
+}
+
+void dispatcher_initialize()
+{
+    Task *interrupts_dispatcher_task = task_spawn(nullptr, "interrupts-dispatcher", dispatcher_service, nullptr, false);
+    task_go(interrupts_dispatcher_task);
 }
 
-static void dispatcher_snapshot(bool *destination)
+void dispatcher_register(RefPtr<Device> device)
 {
+    int interrupt = device->interrupt();
+
+    if (interrupt < 0)
+    {
+        return;
+    }
+
+    if (interrupt >= DISPATCHER_LINE_COUNT)
+    {
+        logger_warn("Interrupt %d of %s is out of range!", interrupt, device->name().cstring());
+        return;
+    }
+
     InterruptsRetainer retainer;
-    memcpy(destination, _pending_interrupts, sizeof(_pending_interrupts));
-    memset(_pending_interrupts, 0, sizeof(_pending_interrupts));
+
+    auto &line = _lines[interrupt];
+
+    if (!line.devices)
+    {
+        line.devices = new Vector<RefPtr<Device>>();
+    }
+
+    line.devices->push_back(device);
+
+    int priority = device->interrupt_priority();
+
+    if (priority < 0)
+    {
+        return;
+    }
+
+    if (line.task)
+    {
+        // Lines shared by multiple devices run at the priority of the most urgent one.
+        line.priority = MIN(line.priority, priority);
+        line.task->fixed_priority = line.priority;
+
+        return;
+    }
+
+    line.priority = priority;
+
+    char name[PROCESS_NAME_SIZE];
+    snprintf(name, PROCESS_NAME_SIZE, "irq%d", interrupt);
+
+    line.task = task_spawn(nullptr, name, dispatcher_thread_entry, nullptr, false);
+    line.task->priority = priority;
+    line.task->fixed_priority = priority;
+
+    __atomic_fetch_or(&_threaded, 1u << interrupt, __ATOMIC_ACQ_REL);
+
+    task_go(line.task);
 }
 
-class BlockerDispatcher : public Blocker
+void dispatcher_dispatch(int interrupt)
 {
-public:
-    bool can_unblock(Task &) override
+    if (interrupt >= DISPATCHER_LINE_COUNT || !_lines[interrupt].devices)
     {
-        return dispatcher_has_interrupt();
+        return;
     }
-};
+
+    auto &line = _lines[interrupt];
+
+    line.devices->foreach ([&](auto &device) {
+        device->acknowledge_interrupt();
+        return Iteration::CONTINUE;
+    });
+
+    __atomic_fetch_or(&_pending, 1u << interrupt, __ATOMIC_ACQ_REL);
+
+    if (line.task)
+    {
+        line.wait_queue.wake_up();
+    }
+    else
+    {
+        _dispatcher_wait_queue.wake_up();
+    }
+}
 
 void dispatcher_service()
 {
     while (true)
     {
-        BlockerDispatcher blocker{};
+        BlockerDispatcher blocker{_dispatcher_wait_queue, ~__atomic_load_n(&_threaded, __ATOMIC_ACQUIRE)};
         assert(task_block(scheduler_running(), blocker, -1) == SUCCESS);
 
-        while (dispatcher_has_interrupt())
-        {
-            bool snapshot[256];
-            dispatcher_snapshot(snapshot);
+        uint32_t shared = ~__atomic_load_n(&_threaded, __ATOMIC_ACQUIRE);
+        uint32_t pending;
 
-            for (size_t i = 0; i < 256; i++)
+        while ((pending = __atomic_fetch_and(&_pending, ~shared, __ATOMIC_ACQ_REL) & shared))
+        {
+            while (pending)
             {
-                if (snapshot[i])
-                {
-                    devices_handle_interrupt(i);
-                }
+                int interrupt = __builtin_ctz(pending);
+                pending &= pending - 1;
+
+                dispatcher_handle(interrupt);
             }
         }
     }
@@ -1,11 +1,20 @@
 #pragma once
 
-#include "kernel/node/Node.h"
+#include "kernel/devices/Device.h"
+
+// Interrupt lines handled by the dispatcher, one bit each in the pending mask.
+#define DISPATCHER_LINE_COUNT 32
 
 typedef void (*DispatcherInteruptHandler)();
 
 void dispatcher_initialize();
 
+// Route the interrupts of `device` to it. Its handle_interrupt() runs in
+// a task of its line if it has an interrupt priority, in the shared
+// dispatcher task otherwise.
+void dispatcher_register(RefPtr<Device> device);
+
+// Top half, called from the interrupt handler.
 void dispatcher_dispatch(int interrupt);
 
 void dispatcher_service();
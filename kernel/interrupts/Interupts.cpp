@@ -1,10 +1,36 @@
+#include <assert.h>
+
 #include "archs/Architectures.h"
 
 #include "kernel/interrupts/Dispatcher.h"
 #include "kernel/interrupts/Interupts.h"
+#include "kernel/system/CPU.h"
+
+// Interrupt handlers and retained sections are serialized between processors
+// by the big kernel lock, a processor holds it as long as it is inside an
+// interrupt handler (holding disabled) or its retained depth is not zero.
+// The boot processor owns it until interrupts are enabled.
+static constexpr int BIG_LOCK_FREE = -1;
 
-static bool _holded = false;
-static int _depth = 0;
+static int _big_lock_owner = 0;
+
+static void big_lock_acquire(CPU *cpu)
+{
+    int expected = BIG_LOCK_FREE;
+
+    while (!__atomic_compare_exchange_n(&_big_lock_owner, &expected, cpu->id, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        expected = BIG_LOCK_FREE;
+        asm("pause");
+    }
+}
+
+static void big_lock_release(CPU *cpu)
+{
+    assert(__atomic_load_n(&_big_lock_owner, __ATOMIC_RELAXED) == cpu->id);
+
+    __atomic_store_n(&_big_lock_owner, BIG_LOCK_FREE, __ATOMIC_RELEASE);
+}
 
 void interrupts_initialize()
 {
@@ -18,35 +44,83 @@ void interrupts_initialize()
 
 bool interrupts_retained()
 {
-    return !_holded || _depth > 0;
+    return !arch_interrupts_enabled();
 }
 
 void interrupts_enable_holding()
 {
-    _holded = true;
+    CPU *cpu = cpu_this();
+
+    cpu->interrupts_holded = true;
+
+    if (cpu->interrupts_depth == 0)
+    {
+        big_lock_release(cpu);
+    }
 }
 
 void interrupts_disable_holding()
 {
-    _holded = false;
+    CPU *cpu = cpu_this();
+
+    if (cpu->interrupts_holded && cpu->interrupts_depth == 0)
+    {
+        big_lock_acquire(cpu);
+    }
+
+    cpu->interrupts_holded = false;
 }
 
 void interrupts_retain()
 {
-    if (_holded)
+    arch_disable_interrupts();
+
+    CPU *cpu = cpu_this();
+
+    if (cpu->interrupts_holded)
     {
-        arch_disable_interrupts();
-        _depth++;
+        if (cpu->interrupts_depth == 0)
+        {
+            big_lock_acquire(cpu);
+        }
+
+        cpu->interrupts_depth++;
     }
 }
 
 void interrupts_release()
 {
-    if (_holded)
+    CPU *cpu = cpu_this();
+
+    if (cpu->interrupts_holded)
     {
-        _depth--;
+        cpu->interrupts_depth--;
 
-        if (_depth == 0)
+        if (cpu->interrupts_depth == 0)
+        {
+            big_lock_release(cpu);
             arch_enable_interrupts();
+        }
     }
 }
+
+int interrupts_get_depth()
+{
+    return cpu_this()->interrupts_depth;
+}
+
+void interrupts_set_depth(int depth)
+{
+    cpu_this()->interrupts_depth = depth;
+}
+
+void interrupts_panic()
+{
+    arch_disable_interrupts();
+    arch_cpu_stop_others();
+
+    // Whoever was holding the big kernel lock is not running anymore.
+    CPU *cpu = cpu_this();
+    __atomic_store_n(&_big_lock_owner, cpu->id, __ATOMIC_RELEASE);
+    cpu->interrupts_holded = false;
+}
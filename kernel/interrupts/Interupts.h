@@ -16,6 +16,16 @@ void interrupts_retain();
 
 void interrupts_release();
 
+// Each task has its own retained depth, the scheduler saves and restores
+// it when switching, see schedule().
+int interrupts_get_depth();
+
+void interrupts_set_depth(int depth);
+
+// Stop the other processors and take the big kernel lock for good,
+// only used by system_panic().
+void interrupts_panic();
+
 class InterruptsRetainer
 {
 private:
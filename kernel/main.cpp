@@ -8,14 +8,19 @@
 #include <assert.h>
 #include <libsystem/Logger.h>
 
+#include "archs/Architectures.h"
+
 #include "kernel/devices/Devices.h"
 #include "kernel/devices/Driver.h"
 #include "kernel/filesystem/DevicesFileSystem.h"
 #include "kernel/graphics/Graphics.h"
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/modules/Modules.h"
+#include "kernel/node/DentryInfo.h"
 #include "kernel/node/DevicesInfo.h"
 #include "kernel/node/ProcessInfo.h"
+#include "kernel/node/SlabInfo.h"
+#include "kernel/node/TraceInfo.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/storage/Partitions.h"
 #include "kernel/system/System.h"
@@ -44,12 +49,17 @@ void system_main(Handover *handover)
     scheduler_initialize();
     tasking_initialize();
     interrupts_initialize();
+    arch_timer_initialize();
+    arch_cpu_start_others();
     modules_initialize(handover);
     driver_initialize();
     device_initialize();
     partitions_initialize();
     process_info_initialize();
     device_info_initialize();
+    slab_info_initialize();
+    dentry_info_initialize();
+    trace_info_initialize();
     devices_filesystem_initialize();
     graphic_initialize(handover);
     userspace_initialize();
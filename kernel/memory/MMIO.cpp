@@ -2,8 +2,8 @@
 
 #include "archs/VirtualMemory.h"
 
-#include "kernel/interrupts/Interupts.h"
 #include "kernel/memory/MMIO.h"
+#include "kernel/memory/Memory.h"
 #include "kernel/memory/Physical.h"
 
 MMIORange::MMIORange()
@@ -14,7 +14,7 @@ MMIORange::MMIORange(size_t size)
 {
     size = PAGE_ALIGN_UP(size);
 
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
 
     _own_physical_range = true;
     _physical_range = {physical_alloc(size)};
@@ -23,7 +23,7 @@ MMIORange::MMIORange(size_t size)
 
 MMIORange::MMIORange(MemoryRange range)
 {
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
 
     _physical_range = {range};
     _virtual_range = {arch_virtual_alloc(arch_kernel_address_space(), _physical_range, MEMORY_NONE)};
@@ -37,7 +37,7 @@ MMIORange::~MMIORange()
     if (empty())
         return;
 
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
 
     arch_virtual_free(arch_kernel_address_space(), _virtual_range);
 
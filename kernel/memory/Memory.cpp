@@ -4,6 +4,7 @@
 #include <libsystem/io/Stream.h>
 #include <string.h>
 
+#include "archs/Architectures.h"
 #include "archs/VirtualMemory.h"
 
 #include "kernel/graphics/Graphics.h"
@@ -11,6 +12,13 @@
 #include "kernel/memory/Memory.h"
 #include "kernel/memory/MemoryObject.h"
 #include "kernel/memory/Physical.h"
+#include "kernel/memory/Slab.h"
+#include "kernel/system/CPU.h"
+
+Spinlock memory_lock{"memory"};
+
+// Pages of kernel virtual memory used to reach physical pages mapped nowhere else.
+static uintptr_t _memory_windows[CPU_MAX_COUNT][MEMORY_WINDOW_COUNT] = {};
 
 static bool _memory_initialized = false;
 
@@ -26,26 +34,10 @@ void memory_initialize(Handover *handover)
 {
     logger_info("Initializing memory management...");
 
-    for (size_t i = 0; i < 1024 * 1024 / 8; i++)
-    {
-        MEMORY[i] = 0xff;
-    }
-
-    for (size_t i = 0; i < handover->memory_map_size; i++)
-    {
-        MemoryMapEntry *entry = &handover->memory_map[i];
-
-        if (entry->type == MEMORY_MAP_ENTRY_AVAILABLE)
-        {
-            physical_set_free(entry->range);
-        }
-    }
+    physical_initialize(handover, kernel_memory_range());
 
     arch_virtual_initialize();
 
-    USED_MEMORY = 0;
-    TOTAL_MEMORY = handover->memory_usable;
-
     logger_info("Mapping kernel...");
     memory_map_identity(arch_kernel_address_space(), kernel_memory_range(), MEMORY_NONE);
 
@@ -55,6 +47,9 @@ void memory_initialize(Handover *handover)
         memory_map_identity(arch_kernel_address_space(), handover->modules[i].range, MEMORY_NONE);
     }
 
+    logger_info("Mapping physical pages descriptors...");
+    memory_map_identity(arch_kernel_address_space(), physical_pages_range(), MEMORY_NONE);
+
     // Unmap the 0 page
     MemoryRange page_zero{0, ARCH_PAGE_SIZE};
     arch_virtual_free(arch_kernel_address_space(), page_zero);
@@ -80,18 +75,27 @@ void memory_dump()
     stream_format(out_stream, "\n\tMemory status:");
     stream_format(out_stream, "\n\t - Used  physical Memory: %12dkib", USED_MEMORY / 1024);
     stream_format(out_stream, "\n\t - Total physical Memory: %12dkib", TOTAL_MEMORY / 1024);
+
+    // We might be panicking while another processor holds the lock.
+    if (memory_lock.try_acquire())
+    {
+        physical_dump();
+        memory_lock.release();
+    }
+
+    slab_dump();
 }
 
 size_t memory_get_used()
 {
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
 
     return USED_MEMORY;
 }
 
 size_t memory_get_total()
 {
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
 
     return TOTAL_MEMORY;
 }
@@ -100,7 +104,7 @@ Result memory_map(void *address_space, MemoryRange virtual_range, MemoryFlags fl
 {
     assert(virtual_range.is_page_aligned());
 
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
 
     for (size_t i = 0; i < virtual_range.size() / ARCH_PAGE_SIZE; i++)
     {
@@ -130,7 +134,7 @@ Result memory_map_identity(void *address_space, MemoryRange physical_range, Memo
 {
     assert(physical_range.is_page_aligned());
 
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
 
     physical_set_used(physical_range);
     assert(SUCCESS == arch_virtual_map(address_space, physical_range, physical_range.base(), flags));
@@ -148,7 +152,7 @@ Result memory_alloc(void *address_space, size_t size, MemoryFlags flags, uintptr
 {
     assert(IS_PAGE_ALIGN(size));
 
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
 
     if (!size)
     {
@@ -188,41 +192,61 @@ Result memory_alloc(void *address_space, size_t size, MemoryFlags flags, uintptr
 
 Result memory_alloc_identity(void *address_space, MemoryFlags flags, uintptr_t *out_address)
 {
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
+
+    // Pages whose identity address is already used by another mapping are put aside
+    // until we find a suitable one, so the allocator doesn't give them back to us.
+    static constexpr int MAX_REJECTED = 16;
+
+    MemoryRange rejected[MAX_REJECTED];
+    int rejected_count = 0;
 
-    for (size_t i = 1; i < 256 * 1024; i++)
+    *out_address = 0;
+
+    while (rejected_count < MAX_REJECTED)
     {
-        MemoryRange identity_range{i * ARCH_PAGE_SIZE, ARCH_PAGE_SIZE};
+        MemoryRange identity_range = physical_alloc_identity(ARCH_PAGE_SIZE);
 
-        if (!arch_virtual_present(address_space, identity_range.base()) &&
-            !physical_is_used(identity_range))
+        if (arch_virtual_present(address_space, identity_range.base()))
         {
-            physical_set_used(identity_range);
-            assert(SUCCESS == arch_virtual_map(address_space, identity_range, identity_range.base(), flags));
+            rejected[rejected_count] = identity_range;
+            rejected_count++;
 
-            if (flags & MEMORY_CLEAR)
-            {
-                memset((void *)identity_range.base(), 0, ARCH_PAGE_SIZE);
-            }
+            continue;
+        }
 
-            *out_address = identity_range.base();
+        assert(SUCCESS == arch_virtual_map(address_space, identity_range, identity_range.base(), flags));
 
-            return SUCCESS;
+        if (flags & MEMORY_CLEAR)
+        {
+            memset((void *)identity_range.base(), 0, ARCH_PAGE_SIZE);
         }
+
+        *out_address = identity_range.base();
+
+        break;
     }
 
-    logger_warn("Failed to allocate identity mapped page!");
+    for (int i = 0; i < rejected_count; i++)
+    {
+        physical_free(rejected[i]);
+    }
 
-    *out_address = 0;
+    if (*out_address == 0)
+    {
+        logger_warn("Failed to allocate identity mapped page!");
 
-    return ERR_OUT_OF_MEMORY;
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    return SUCCESS;
 }
 
 Result memory_free(void *address_space, MemoryRange virtual_range)
 {
     assert(virtual_range.is_page_aligned());
 
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(memory_lock);
 
     for (size_t i = 0; i < virtual_range.size() / ARCH_PAGE_SIZE; i++)
     {
@@ -231,12 +255,36 @@ Result memory_free(void *address_space, MemoryRange virtual_range)
         if (arch_virtual_present(address_space, virtual_address))
         {
             MemoryRange page_physical_range{arch_virtual_to_physical(address_space, virtual_address), ARCH_PAGE_SIZE};
-            MemoryRange page_virtual_range{virtual_address, ARCH_PAGE_SIZE};
 
             physical_free(page_physical_range);
-            arch_virtual_free(address_space, page_virtual_range);
         }
     }
 
+    // Unmapped in one go, so large pages are dropped whole instead of being split.
+    arch_virtual_free(address_space, virtual_range);
+
     return SUCCESS;
 }
+
+void *memory_window(int window, uintptr_t physical_page)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    SpinlockHolder holder(memory_lock);
+
+    MemoryRange physical_range{physical_page, ARCH_PAGE_SIZE};
+    uintptr_t &virtual_address = _memory_windows[arch_cpu_current()][window];
+
+    // Other processors never touch our windows, so there's
+    // no need to flush their TLB when moving them around.
+    if (!virtual_address)
+    {
+        virtual_address = arch_virtual_alloc(arch_kernel_address_space(), physical_range, MEMORY_NONE).base();
+    }
+    else
+    {
+        assert(SUCCESS == arch_virtual_map(arch_kernel_address_space(), physical_range, virtual_address, MEMORY_NONE));
+    }
+
+    return (void *)virtual_address;
+}
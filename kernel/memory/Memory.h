@@ -5,6 +5,10 @@
 
 #include "kernel/handover/Handover.h"
 #include "kernel/memory/MemoryRange.h"
+#include "kernel/system/Spinlock.h"
+
+// Protects the physical allocator and the page tables.
+extern Spinlock memory_lock;
 
 void memory_initialize(Handover *handover);
 
@@ -23,3 +27,13 @@ Result memory_alloc(void *address_space, size_t size, MemoryFlags flags, uintptr
 Result memory_alloc_identity(void *address_space, MemoryFlags flags, uintptr_t *out_address);
 
 Result memory_free(void *address_space, MemoryRange range);
+
+#define MEMORY_WINDOW_COUNT 3
+
+// Copies to or from user memory can fault, and bringing the page in uses
+// the other windows, so they go through this one.
+#define MEMORY_WINDOW_USER_COPY 2
+
+// Map `physical_page` at one of the kernel windows of the processor running
+// this code, valid until the window is reused. Interrupts must be retained.
+void *memory_window(int window, uintptr_t physical_page);
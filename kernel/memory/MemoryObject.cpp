@@ -1,41 +1,164 @@
 #include <libsystem/Logger.h>
-#include <libsystem/utils/List.h>
+#include <libsystem/math/MinMax.h>
+#include <string.h>
+
+#include "archs/VirtualMemory.h"
 
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/memory/Memory.h"
 #include "kernel/memory/MemoryObject.h"
 #include "kernel/memory/Physical.h"
 
+// Taken before the heap and the memory lock, never the other way around.
+static Spinlock _memory_objects_lock{"memory-objects"};
+
 static int _memory_object_id = 0;
-static List *_memory_objects;
+
+// Objects are looked up by id each time a task includes one, they are kept
+// in a hash table which doubles its bucket count when it gets too crowded.
+#define MEMORY_OBJECTS_INITIAL_BUCKETS 64
+
+static MemoryObject **_memory_objects = nullptr;
+static size_t _memory_objects_buckets = 0;
+static size_t _memory_objects_count = 0;
+
+static MemoryObject **memory_object_bucket(MemoryObject **buckets, size_t count, int id)
+{
+    return &buckets[(unsigned int)id % count];
+}
+
+static void memory_object_rehash(size_t new_count)
+{
+    auto new_buckets = (MemoryObject **)calloc(new_count, sizeof(MemoryObject *));
+
+    for (size_t i = 0; i < _memory_objects_buckets; i++)
+    {
+        MemoryObject *memory_object = _memory_objects[i];
+
+        while (memory_object)
+        {
+            MemoryObject *next = memory_object->next;
+            MemoryObject **bucket = memory_object_bucket(new_buckets, new_count, memory_object->id);
+
+            memory_object->next = *bucket;
+            *bucket = memory_object;
+
+            memory_object = next;
+        }
+    }
+
+    free(_memory_objects);
+
+    _memory_objects = new_buckets;
+    _memory_objects_buckets = new_count;
+}
 
 void memory_object_initialize()
 {
-    _memory_objects = list_create();
+    memory_object_rehash(MEMORY_OBJECTS_INITIAL_BUCKETS);
 }
 
 MemoryObject *memory_object_create(size_t size)
 {
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(_memory_objects_lock);
 
     size = PAGE_ALIGN_UP(size);
 
     MemoryObject *memory_object = __create(MemoryObject);
 
     memory_object->id = _memory_object_id++;
+    memory_object->size = size;
     memory_object->refcount = 1;
-    memory_object->_range = physical_alloc(size);
 
-    list_pushback(_memory_objects, memory_object);
+    // Pages are only backed once they are touched, see memory_object_page().
+    memory_object->pages = (uintptr_t *)calloc(memory_object->page_count(), sizeof(uintptr_t));
+
+    if (_memory_objects_count >= _memory_objects_buckets * 2)
+    {
+        memory_object_rehash(_memory_objects_buckets * 2);
+    }
+
+    MemoryObject **bucket = memory_object_bucket(_memory_objects, _memory_objects_buckets, memory_object->id);
+    memory_object->next = *bucket;
+    *bucket = memory_object;
+
+    _memory_objects_count++;
+
+    return memory_object;
+}
+
+MemoryObject *memory_object_create_borrowed(MemoryRange range)
+{
+    assert(range.is_page_aligned());
+
+    auto memory_object = memory_object_create(range.size());
+
+    SpinlockHolder holder(memory_lock);
+
+    for (size_t i = 0; i < range.page_count(); i++)
+    {
+        memory_object->pages[i] = range.base() + i * ARCH_PAGE_SIZE;
+    }
+
+    memory_object->resident = range.page_count();
+    memory_object->borrowed = range.page_count();
 
     return memory_object;
 }
 
+MemoryObject *memory_object_copy(MemoryObject *memory_object, size_t offset, size_t size)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    auto copy = memory_object_create(size);
+    size_t first = offset / ARCH_PAGE_SIZE;
+
+    for (size_t i = 0; i < copy->page_count(); i++)
+    {
+        SpinlockHolder holder(memory_lock);
+
+        if (first + i >= memory_object->page_count() || !memory_object->pages[first + i])
+        {
+            continue;
+        }
+
+        auto page = physical_alloc(ARCH_PAGE_SIZE);
+        assert(!page.empty());
+
+        copy->pages[i] = page.base();
+        copy->resident++;
+
+        memcpy(memory_window(1, copy->pages[i]), memory_window(0, memory_object->pages[first + i]), ARCH_PAGE_SIZE);
+    }
+
+    return copy;
+}
+
 void memory_object_destroy(MemoryObject *memory_object)
 {
-    list_remove(_memory_objects, memory_object);
+    MemoryObject **link = memory_object_bucket(_memory_objects, _memory_objects_buckets, memory_object->id);
+
+    while (*link != memory_object)
+    {
+        link = &(*link)->next;
+    }
+
+    *link = memory_object->next;
+    _memory_objects_count--;
+
+    {
+        SpinlockHolder memory_holder(memory_lock);
+
+        for (size_t i = memory_object->borrowed; i < memory_object->page_count(); i++)
+        {
+            if (memory_object->pages[i])
+            {
+                physical_free({memory_object->pages[i], ARCH_PAGE_SIZE});
+            }
+        }
+    }
 
-    physical_free(memory_object->range());
+    free(memory_object->pages);
     free(memory_object);
 }
 
@@ -48,7 +171,7 @@ MemoryObject *memory_object_ref(MemoryObject *memory_object)
 
 void memory_object_deref(MemoryObject *memory_object)
 {
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(_memory_objects_lock);
 
     if (__atomic_sub_fetch(&memory_object->refcount, 1, __ATOMIC_SEQ_CST) == 0)
     {
@@ -58,16 +181,266 @@ void memory_object_deref(MemoryObject *memory_object)
 
 MemoryObject *memory_object_by_id(int id)
 {
-    InterruptsRetainer retainer;
+    SpinlockHolder holder(_memory_objects_lock);
 
-    list_foreach(MemoryObject, memory_object, _memory_objects)
+    MemoryObject *memory_object = *memory_object_bucket(_memory_objects, _memory_objects_buckets, id);
+
+    while (memory_object)
     {
         if (memory_object->id == id)
         {
-            memory_object_ref(memory_object);
-            return memory_object;
+            return memory_object_ref(memory_object);
         }
+
+        memory_object = memory_object->next;
     }
 
     return nullptr;
 }
+
+// Back the whole large page around `index` with one aligned physical run, if nothing
+// in there is backed yet. Returns false if the object is too small or memory too fragmented.
+static bool memory_object_back_large_page(MemoryObject *memory_object, size_t index)
+{
+    size_t large_page_size = arch_large_page_size();
+
+    if (large_page_size == 0)
+    {
+        return false;
+    }
+
+    size_t count = large_page_size / ARCH_PAGE_SIZE;
+    size_t first = __align_down(index, count);
+
+    if (first + count > memory_object->page_count())
+    {
+        return false;
+    }
+
+    for (size_t i = first; i < first + count; i++)
+    {
+        if (memory_object->pages[i])
+        {
+            return false;
+        }
+    }
+
+    auto run = physical_try_alloc(large_page_size);
+
+    if (run.empty())
+    {
+        return false;
+    }
+
+    auto cleared = arch_virtual_alloc(arch_kernel_address_space(), run, MEMORY_NONE);
+    memset((void *)cleared.base(), 0, cleared.size());
+    arch_virtual_free(arch_kernel_address_space(), cleared);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        memory_object->pages[first + i] = run.base() + i * ARCH_PAGE_SIZE;
+    }
+
+    memory_object->resident += count;
+
+    return true;
+}
+
+uintptr_t memory_object_page(MemoryObject *memory_object, size_t index)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    SpinlockHolder holder(memory_lock);
+
+    assert(index < memory_object->page_count());
+
+    if (!memory_object->pages[index])
+    {
+        if (memory_object_back_large_page(memory_object, index))
+        {
+            return memory_object->pages[index];
+        }
+
+        auto page = physical_alloc(ARCH_PAGE_SIZE);
+
+        if (page.empty())
+        {
+            logger_error("Failed to back memory object %d: Not enough physical memory!", memory_object->id);
+            return 0;
+        }
+
+        memset(memory_window(0, page.base()), 0, ARCH_PAGE_SIZE);
+
+        memory_object->pages[index] = page.base();
+        memory_object->resident++;
+    }
+
+    return memory_object->pages[index];
+}
+
+void memory_object_grow(MemoryObject *memory_object, size_t size)
+{
+    size = PAGE_ALIGN_UP(size);
+
+    if (size <= memory_object->size)
+    {
+        return;
+    }
+
+    // The new array can't be allocated with the memory lock held.
+    auto pages = (uintptr_t *)calloc(size / ARCH_PAGE_SIZE, sizeof(uintptr_t));
+    uintptr_t *old_pages = nullptr;
+
+    {
+        SpinlockHolder holder(memory_lock);
+
+        memcpy(pages, memory_object->pages, memory_object->page_count() * sizeof(uintptr_t));
+
+        old_pages = memory_object->pages;
+        memory_object->pages = pages;
+        memory_object->size = size;
+    }
+
+    free(old_pages);
+}
+
+void memory_object_clear(MemoryObject *memory_object, size_t offset, size_t size)
+{
+    InterruptsRetainer retainer;
+
+    SpinlockHolder holder(memory_lock);
+
+    bool shared = __atomic_load_n(&memory_object->refcount, __ATOMIC_SEQ_CST) > 1;
+
+    while (size > 0)
+    {
+        size_t index = offset / ARCH_PAGE_SIZE;
+        size_t page_offset = offset % ARCH_PAGE_SIZE;
+        size_t chunk = MIN(size, ARCH_PAGE_SIZE - page_offset);
+
+        assert(index >= memory_object->borrowed);
+
+        uintptr_t page = memory_object->pages[index];
+
+        // Pages of a large page are given back in one go when the object is destroyed.
+        size_t first = 0;
+        bool whole_page = chunk == ARCH_PAGE_SIZE &&
+                          !shared &&
+                          memory_object_large_page(memory_object, index, &first).empty();
+
+        if (page && whole_page)
+        {
+            physical_free({page, ARCH_PAGE_SIZE});
+
+            memory_object->pages[index] = 0;
+            memory_object->resident--;
+        }
+        else if (page)
+        {
+            memset((char *)memory_window(0, page) + page_offset, 0, chunk);
+        }
+
+        offset += chunk;
+        size -= chunk;
+    }
+}
+
+void memory_object_read(MemoryObject *memory_object, size_t offset, void *buffer, size_t size)
+{
+    auto destination = reinterpret_cast<char *>(buffer);
+
+    while (size > 0)
+    {
+        size_t index = offset / ARCH_PAGE_SIZE;
+        size_t page_offset = offset % ARCH_PAGE_SIZE;
+        size_t chunk = MIN(size, ARCH_PAGE_SIZE - page_offset);
+
+        InterruptsRetainer retainer;
+
+        uintptr_t page = 0;
+
+        {
+            SpinlockHolder holder(memory_lock);
+            page = memory_object->pages[index];
+        }
+
+        if (page)
+        {
+            memcpy(destination, (char *)memory_window(MEMORY_WINDOW_USER_COPY, page) + page_offset, chunk);
+        }
+        else
+        {
+            memset(destination, 0, chunk);
+        }
+
+        destination += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+}
+
+size_t memory_object_write(MemoryObject *memory_object, size_t offset, const void *buffer, size_t size)
+{
+    auto source = reinterpret_cast<const char *>(buffer);
+    size_t written = 0;
+
+    while (written < size)
+    {
+        size_t index = offset / ARCH_PAGE_SIZE;
+        size_t page_offset = offset % ARCH_PAGE_SIZE;
+        size_t chunk = MIN(size - written, ARCH_PAGE_SIZE - page_offset);
+
+        assert(index >= memory_object->borrowed);
+
+        InterruptsRetainer retainer;
+
+        uintptr_t page = memory_object_page(memory_object, index);
+
+        if (!page)
+        {
+            break;
+        }
+
+        memcpy((char *)memory_window(MEMORY_WINDOW_USER_COPY, page) + page_offset, source + written, chunk);
+
+        offset += chunk;
+        written += chunk;
+    }
+
+    return written;
+}
+
+MemoryRange memory_object_large_page(MemoryObject *memory_object, size_t index, size_t *first)
+{
+    size_t large_page_size = arch_large_page_size();
+
+    if (large_page_size == 0)
+    {
+        return {};
+    }
+
+    size_t count = large_page_size / ARCH_PAGE_SIZE;
+    *first = __align_down(index, count);
+
+    if (*first + count > memory_object->page_count())
+    {
+        return {};
+    }
+
+    uintptr_t base = memory_object->pages[*first];
+
+    if (!base || base % large_page_size != 0)
+    {
+        return {};
+    }
+
+    for (size_t i = 1; i < count; i++)
+    {
+        if (memory_object->pages[*first + i] != base + i * ARCH_PAGE_SIZE)
+        {
+            return {};
+        }
+    }
+
+    return {base, large_page_size};
+}
@@ -2,20 +2,46 @@
 
 #include <libsystem/Common.h>
 
+#include "archs/Memory.h"
+
+#include "kernel/memory/MemoryRange.h"
+
 struct MemoryObject
 {
     int id;
-    MemoryRange _range;
+    size_t size;
 
     int refcount;
 
-    auto range() { return _range; }
+    // Handed out to other tasks, writes must stay visible
+    // to everyone so it's never shared copy-on-write.
+    bool shared;
+
+    // Physical address of each page, zero until it's touched for the first time.
+    // Objects can grow, the array is only read with the memory lock held.
+    uintptr_t *pages;
+    size_t resident;
+
+    // Leading pages which belong to someone else, like the boot modules.
+    // They are never written to nor given back to the physical allocator.
+    size_t borrowed;
+
+    // Next object in the same bucket of the table of objects by id.
+    MemoryObject *next;
+
+    size_t page_count() { return size / ARCH_PAGE_SIZE; }
 };
 
 void memory_object_initialize();
 
 MemoryObject *memory_object_create(size_t size);
 
+// Create an object over physical pages which are already in use, see MemoryObject::borrowed.
+MemoryObject *memory_object_create_borrowed(MemoryRange range);
+
+// Create a new object with a private copy of the `size` bytes of `memory_object` at `offset`.
+MemoryObject *memory_object_copy(MemoryObject *memory_object, size_t offset, size_t size);
+
 void memory_object_destroy(MemoryObject *memory_object);
 
 MemoryObject *memory_object_ref(MemoryObject *memory_object);
@@ -23,3 +49,26 @@ MemoryObject *memory_object_ref(MemoryObject *memory_object);
 void memory_object_deref(MemoryObject *memory_object);
 
 MemoryObject *memory_object_by_id(int id);
+
+// Make room for `size` bytes, the pages already backed stay where they are.
+void memory_object_grow(MemoryObject *memory_object, size_t size);
+
+// Zero `size` bytes at `offset`, whole pages are given back to the physical
+// allocator unless the object is shared, they might be mapped somewhere.
+void memory_object_clear(MemoryObject *memory_object, size_t offset, size_t size);
+
+// Copy from the object to kernel or user memory, pages which were never
+// touched read as zeros and are not backed.
+void memory_object_read(MemoryObject *memory_object, size_t offset, void *buffer, size_t size);
+
+// Copy to the object, returns how much was written before running out of memory.
+size_t memory_object_write(MemoryObject *memory_object, size_t offset, const void *buffer, size_t size);
+
+// Physical address of the page at `index`, allocated and cleared on first use,
+// zero if there is no physical memory left. Big objects are backed a whole large
+// page at a time, so they can be mapped with large page entries.
+uintptr_t memory_object_page(MemoryObject *memory_object, size_t index);
+
+// Pages of the large page around `index` if they are backed by one physically
+// contiguous run, an empty range otherwise. `first` is the index of its first page.
+MemoryRange memory_object_large_page(MemoryObject *memory_object, size_t index, size_t *first);
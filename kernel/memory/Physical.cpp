@@ -1,3 +1,7 @@
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
+#include <string.h>
+
 #include "archs/Memory.h"
 
 #include "kernel/interrupts/Interupts.h"
@@ -7,59 +11,402 @@
 size_t TOTAL_MEMORY = 0;
 size_t USED_MEMORY = 0;
 
-size_t best_bet = 0;
-uint8_t MEMORY[1024 * 1024 / 8] = {};
+/* --- Pages ---------------------------------------------------------------- */
+
+#define PHYSICAL_NO_PAGE (0xffffffff)
+
+#define PHYSICAL_PAGE_USED (1 << 0)
+#define PHYSICAL_PAGE_FREE_HEAD (1 << 1)
+
+struct PhysicalPage
+{
+    // Links of the free list, only valid on the head of a free block.
+    uint32_t next;
+    uint32_t prev;
+
+    uint8_t order;
+    uint8_t flags;
+};
+
+static PhysicalPage *_pages = nullptr;
+static size_t _pages_count = 0;
+static MemoryRange _pages_range = {};
+
+static bool physical_page_is_used(size_t page)
+{
+    return page >= _pages_count || (_pages[page].flags & PHYSICAL_PAGE_USED);
+}
+
+static bool physical_page_is_free_head(size_t page, size_t order)
+{
+    return (_pages[page].flags & PHYSICAL_PAGE_FREE_HEAD) && _pages[page].order == order;
+}
+
+/* --- Zones ---------------------------------------------------------------- */
+
+enum PhysicalZoneType
+{
+    PHYSICAL_ZONE_IDENTITY,
+    PHYSICAL_ZONE_NORMAL,
+
+    __PHYSICAL_ZONE_COUNT
+};
+
+struct PhysicalZone
+{
+    const char *name;
+
+    size_t begin;
+    size_t end;
+
+    size_t free_pages;
+    size_t free_blocks[PHYSICAL_ORDER_COUNT];
+    uint32_t free_lists[PHYSICAL_ORDER_COUNT];
+};
+
+static PhysicalZone _zones[__PHYSICAL_ZONE_COUNT] = {};
+
+static PhysicalZone &physical_zone_for(size_t page)
+{
+    if (page < _zones[PHYSICAL_ZONE_IDENTITY].end)
+    {
+        return _zones[PHYSICAL_ZONE_IDENTITY];
+    }
+    else
+    {
+        return _zones[PHYSICAL_ZONE_NORMAL];
+    }
+}
 
-bool physical_page_is_used(uintptr_t address)
+static size_t physical_order_for(size_t page_count)
 {
-    uintptr_t page = address / ARCH_PAGE_SIZE;
+    size_t order = 0;
 
-    return MEMORY[page / 8] & (1 << (page % 8));
+    while (((size_t)1 << order) < page_count)
+    {
+        order++;
+    }
+
+    return order;
 }
 
-void physical_page_set_used(uintptr_t address)
+static void physical_zone_push(PhysicalZone &zone, size_t page, size_t order)
 {
-    uintptr_t page = address / ARCH_PAGE_SIZE;
+    PhysicalPage &head = _pages[page];
+
+    head.flags |= PHYSICAL_PAGE_FREE_HEAD;
+    head.order = order;
+    head.prev = PHYSICAL_NO_PAGE;
+    head.next = zone.free_lists[order];
 
-    if (page == best_bet)
+    if (head.next != PHYSICAL_NO_PAGE)
     {
-        best_bet++;
+        _pages[head.next].prev = page;
     }
 
-    MEMORY[page / 8] |= 1 << (page % 8);
+    zone.free_lists[order] = page;
+    zone.free_blocks[order]++;
+    zone.free_pages += (size_t)1 << order;
 }
 
-void physical_page_set_free(uintptr_t address)
+static void physical_zone_remove(PhysicalZone &zone, size_t page)
 {
-    uintptr_t page = address / ARCH_PAGE_SIZE;
+    PhysicalPage &head = _pages[page];
+
+    if (head.prev != PHYSICAL_NO_PAGE)
+    {
+        _pages[head.prev].next = head.next;
+    }
+    else
+    {
+        zone.free_lists[head.order] = head.next;
+    }
+
+    if (head.next != PHYSICAL_NO_PAGE)
+    {
+        _pages[head.next].prev = head.prev;
+    }
 
-    if (page < best_bet)
+    head.flags &= ~PHYSICAL_PAGE_FREE_HEAD;
+
+    zone.free_blocks[head.order]--;
+    zone.free_pages -= (size_t)1 << head.order;
+}
+
+// Give back a naturally aligned block to the zone, merging it with its buddies.
+static void physical_zone_release_block(PhysicalZone &zone, size_t page, size_t order)
+{
+    while (order + 1 < PHYSICAL_ORDER_COUNT)
     {
-        best_bet = page;
+        size_t buddy = page ^ ((size_t)1 << order);
+
+        if (buddy < zone.begin ||
+            buddy + ((size_t)1 << order) > zone.end ||
+            !physical_page_is_free_head(buddy, order))
+        {
+            break;
+        }
+
+        physical_zone_remove(zone, buddy);
+
+        page = MIN(page, buddy);
+        order++;
     }
 
-    MEMORY[page / 8] &= ~(1 << (page % 8));
+    physical_zone_push(zone, page, order);
 }
 
-MemoryRange physical_alloc(size_t size)
+// Give back an arbitrary run of pages by splitting it in naturally aligned blocks.
+static void physical_zone_release_run(PhysicalZone &zone, size_t page, size_t count)
+{
+    while (count > 0)
+    {
+        size_t order = PHYSICAL_ORDER_COUNT - 1;
+
+        if (page != 0)
+        {
+            order = MIN(order, (size_t)__builtin_ctzl(page));
+        }
+
+        while (((size_t)1 << order) > count)
+        {
+            order--;
+        }
+
+        physical_zone_release_block(zone, page, order);
+
+        page += (size_t)1 << order;
+        count -= (size_t)1 << order;
+    }
+}
+
+static bool physical_zone_find_block(size_t page, size_t *block, size_t *order)
+{
+    PhysicalZone &zone = physical_zone_for(page);
+
+    for (size_t o = 0; o < PHYSICAL_ORDER_COUNT; o++)
+    {
+        size_t head = page & ~(((size_t)1 << o) - 1);
+
+        if (head < zone.begin)
+        {
+            return false;
+        }
+
+        if (physical_page_is_free_head(head, o))
+        {
+            *block = head;
+            *order = o;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool physical_zone_alloc(PhysicalZone &zone, size_t count, size_t *page)
+{
+    size_t order = physical_order_for(count);
+
+    for (size_t o = order; o < PHYSICAL_ORDER_COUNT; o++)
+    {
+        if (zone.free_lists[o] == PHYSICAL_NO_PAGE)
+        {
+            continue;
+        }
+
+        size_t head = zone.free_lists[o];
+        physical_zone_remove(zone, head);
+
+        // Give back what we don't need, this also split larger blocks.
+        physical_zone_release_run(zone, head + count, ((size_t)1 << o) - count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            _pages[head + i].flags |= PHYSICAL_PAGE_USED;
+        }
+
+        *page = head;
+
+        return true;
+    }
+
+    return false;
+}
+
+/* --- Initialization ------------------------------------------------------- */
+
+static bool physical_collide(MemoryRange a, MemoryRange b)
+{
+    return a.base() <= b.end() && b.base() <= a.end();
+}
+
+static MemoryRange physical_find_room_for_pages(Handover *handover, MemoryRange kernel_range, size_t size)
+{
+    for (size_t i = 0; i < handover->memory_map_size; i++)
+    {
+        MemoryMapEntry *entry = &handover->memory_map[i];
+
+        if (entry->type != MEMORY_MAP_ENTRY_AVAILABLE)
+        {
+            continue;
+        }
+
+        // Stay away from the first megabyte, the zero page is unmapped later.
+        uintptr_t base = PAGE_ALIGN_UP(MAX(entry->range.base(), (uintptr_t)1024 * 1024));
+
+        bool moved = true;
+
+        while (moved)
+        {
+            moved = false;
+
+            MemoryRange candidate{base, size};
+
+            if (physical_collide(candidate, kernel_range))
+            {
+                base = kernel_range.end() + 1;
+                moved = true;
+            }
+
+            for (size_t j = 0; j < handover->modules_size; j++)
+            {
+                MemoryRange module_range = MemoryRange::around_non_aligned_address(
+                    handover->modules[j].range.base(),
+                    handover->modules[j].range.size());
+
+                if (physical_collide(candidate, module_range))
+                {
+                    base = module_range.end() + 1;
+                    moved = true;
+                }
+            }
+        }
+
+        if (base + size - 1 <= entry->range.end() &&
+            base + size <= PHYSICAL_IDENTITY_LIMIT)
+        {
+            return {base, size};
+        }
+    }
+
+    system_panic("No room for the physical pages descriptors (%dkio)!", size / 1024);
+}
+
+void physical_initialize(Handover *handover, MemoryRange kernel_range)
+{
+    size_t highest_address = 0;
+
+    for (size_t i = 0; i < handover->memory_map_size; i++)
+    {
+        MemoryMapEntry *entry = &handover->memory_map[i];
+
+        if (entry->type == MEMORY_MAP_ENTRY_AVAILABLE)
+        {
+            highest_address = MAX(highest_address, entry->range.base() + entry->range.size());
+        }
+    }
+
+    _pages_count = highest_address / ARCH_PAGE_SIZE;
+
+    size_t pages_size = PAGE_ALIGN_UP(_pages_count * sizeof(PhysicalPage));
+    _pages_range = physical_find_room_for_pages(handover, kernel_range, pages_size);
+    _pages = reinterpret_cast<PhysicalPage *>(_pages_range.base());
+
+    // Paging is not enabled yet, so we can write to physical memory directly.
+    for (size_t i = 0; i < _pages_count; i++)
+    {
+        _pages[i] = {PHYSICAL_NO_PAGE, PHYSICAL_NO_PAGE, 0, PHYSICAL_PAGE_USED};
+    }
+
+    size_t identity_end = MIN(_pages_count, (size_t)PHYSICAL_IDENTITY_LIMIT / ARCH_PAGE_SIZE);
+
+    _zones[PHYSICAL_ZONE_IDENTITY].name = "identity";
+    _zones[PHYSICAL_ZONE_IDENTITY].begin = 0;
+    _zones[PHYSICAL_ZONE_IDENTITY].end = identity_end;
+
+    _zones[PHYSICAL_ZONE_NORMAL].name = "normal";
+    _zones[PHYSICAL_ZONE_NORMAL].begin = identity_end;
+    _zones[PHYSICAL_ZONE_NORMAL].end = _pages_count;
+
+    for (size_t i = 0; i < __PHYSICAL_ZONE_COUNT; i++)
+    {
+        for (size_t order = 0; order < PHYSICAL_ORDER_COUNT; order++)
+        {
+            _zones[i].free_lists[order] = PHYSICAL_NO_PAGE;
+        }
+    }
+
+    for (size_t i = 0; i < handover->memory_map_size; i++)
+    {
+        MemoryMapEntry *entry = &handover->memory_map[i];
+
+        if (entry->type == MEMORY_MAP_ENTRY_AVAILABLE)
+        {
+            physical_set_free(MemoryRange::from_non_aligned_address(entry->range.base(), entry->range.size()));
+        }
+    }
+
+    USED_MEMORY = 0;
+    TOTAL_MEMORY = handover->memory_usable;
+
+    physical_set_used(_pages_range);
+}
+
+MemoryRange physical_pages_range()
+{
+    return _pages_range;
+}
+
+/* --- Allocation ----------------------------------------------------------- */
+
+static MemoryRange physical_alloc_from(PhysicalZoneType first_zone, PhysicalZoneType last_zone, size_t size, bool may_fail)
 {
     ASSERT_INTERRUPTS_RETAINED();
 
     assert(IS_PAGE_ALIGN(size));
 
-    for (size_t i = best_bet; i < ((TOTAL_MEMORY - size) / ARCH_PAGE_SIZE); i++)
+    size_t count = size / ARCH_PAGE_SIZE;
+
+    if (physical_order_for(count) >= PHYSICAL_ORDER_COUNT)
+    {
+        system_panic("Trying to allocat %dkio, which is larger than the largest physical block!", size / 1024);
+    }
+
+    // Zones are tried from the last to the first, so the identity zone is used as a last resort.
+    for (int zone = last_zone; zone >= first_zone; zone--)
     {
-        MemoryRange range(i * ARCH_PAGE_SIZE, size);
+        size_t page = 0;
 
-        if (!physical_is_used(range))
+        if (physical_zone_alloc(_zones[zone], count, &page))
         {
-            physical_set_used(range);
-            return range;
+            USED_MEMORY += size;
+            return {page * ARCH_PAGE_SIZE, size};
         }
     }
 
+    if (may_fail)
+    {
+        return {};
+    }
+
     system_panic("Out of physical memory!\tTrying to allocat %dkio but free memory is %dkio !", size / 1024, (TOTAL_MEMORY - USED_MEMORY) / 1024);
-    return MemoryRange();
+}
+
+MemoryRange physical_alloc(size_t size)
+{
+    return physical_alloc_from(PHYSICAL_ZONE_IDENTITY, PHYSICAL_ZONE_NORMAL, size, false);
+}
+
+MemoryRange physical_try_alloc(size_t size)
+{
+    return physical_alloc_from(PHYSICAL_ZONE_IDENTITY, PHYSICAL_ZONE_NORMAL, size, true);
+}
+
+MemoryRange physical_alloc_identity(size_t size)
+{
+    return physical_alloc_from(PHYSICAL_ZONE_IDENTITY, PHYSICAL_ZONE_IDENTITY, size, false);
 }
 
 void physical_free(MemoryRange range)
@@ -77,11 +424,11 @@ bool physical_is_used(MemoryRange range)
 
     assert(range.is_page_aligned());
 
+    size_t first_page = range.base() / ARCH_PAGE_SIZE;
+
     for (size_t i = 0; i < range.page_count(); i++)
     {
-        uintptr_t address = range.base() + i * ARCH_PAGE_SIZE;
-
-        if (physical_page_is_used(address))
+        if (physical_page_is_used(first_page + i))
         {
             return true;
         }
@@ -96,15 +443,36 @@ void physical_set_used(MemoryRange range)
 
     assert(range.is_page_aligned());
 
-    for (size_t i = 0; i < range.page_count(); i++)
+    size_t page = range.base() / ARCH_PAGE_SIZE;
+    size_t end = MIN(page + range.page_count(), _pages_count);
+
+    while (page < end)
     {
-        uintptr_t address = range.base() + i * ARCH_PAGE_SIZE;
+        size_t block = 0;
+        size_t order = 0;
 
-        if (!physical_page_is_used(address))
+        if (physical_page_is_used(page) || !physical_zone_find_block(page, &block, &order))
         {
-            USED_MEMORY += ARCH_PAGE_SIZE;
-            physical_page_set_used(address);
+            page++;
+            continue;
         }
+
+        PhysicalZone &zone = physical_zone_for(block);
+
+        size_t block_end = block + ((size_t)1 << order);
+        size_t used_end = MIN(block_end, end);
+
+        physical_zone_remove(zone, block);
+        physical_zone_release_run(zone, block, page - block);
+        physical_zone_release_run(zone, used_end, block_end - used_end);
+
+        for (size_t i = page; i < used_end; i++)
+        {
+            _pages[i].flags |= PHYSICAL_PAGE_USED;
+        }
+
+        USED_MEMORY += (used_end - page) * ARCH_PAGE_SIZE;
+        page = used_end;
     }
 }
 
@@ -114,14 +482,73 @@ void physical_set_free(MemoryRange range)
 
     assert(range.is_page_aligned());
 
-    for (size_t i = 0; i < range.page_count(); i++)
+    size_t page = range.base() / ARCH_PAGE_SIZE;
+    size_t end = MIN(page + range.page_count(), _pages_count);
+
+    while (page < end)
     {
-        uintptr_t address = range.base() + i * ARCH_PAGE_SIZE;
+        if (!physical_page_is_used(page))
+        {
+            page++;
+            continue;
+        }
+
+        // Collect a run of used pages which doesn't cross a zone boundary.
+        PhysicalZone &zone = physical_zone_for(page);
+        size_t run_end = page;
+
+        while (run_end < MIN(end, zone.end) && physical_page_is_used(run_end))
+        {
+            _pages[run_end].flags &= ~PHYSICAL_PAGE_USED;
+            run_end++;
+        }
+
+        physical_zone_release_run(zone, page, run_end - page);
+
+        USED_MEMORY -= (run_end - page) * ARCH_PAGE_SIZE;
+        page = run_end;
+    }
+}
+
+/* --- Statistics ----------------------------------------------------------- */
+
+void physical_dump()
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    for (size_t i = 0; i < __PHYSICAL_ZONE_COUNT; i++)
+    {
+        PhysicalZone &zone = _zones[i];
 
-        if (physical_page_is_used(address))
+        if (zone.begin == zone.end)
         {
-            USED_MEMORY -= ARCH_PAGE_SIZE;
-            physical_page_set_free(address);
+            continue;
+        }
+
+        size_t largest_order = 0;
+        bool has_free_block = false;
+
+        stream_format(out_stream, "\n\t - Zone %s: %dkib free, blocks per order:", zone.name, zone.free_pages * ARCH_PAGE_SIZE / 1024);
+        stream_format(out_stream, "\n\t   ");
+
+        for (size_t order = 0; order < PHYSICAL_ORDER_COUNT; order++)
+        {
+            stream_format(out_stream, " %d", zone.free_blocks[order]);
+
+            if (zone.free_blocks[order])
+            {
+                largest_order = order;
+                has_free_block = true;
+            }
+        }
+
+        if (has_free_block)
+        {
+            size_t largest_pages = (size_t)1 << largest_order;
+
+            stream_format(out_stream, "\n\t   Largest free block: %dkib, fragmentation: %d%%",
+                          largest_pages * ARCH_PAGE_SIZE / 1024,
+                          100 - (largest_pages * 100) / zone.free_pages);
         }
     }
 }
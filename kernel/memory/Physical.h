@@ -2,14 +2,29 @@
 
 #include <libsystem/Common.h>
 
+#include "kernel/handover/Handover.h"
 #include "kernel/memory/MemoryRange.h"
 
+// Physical memory is managed by a buddy allocator split in two zones:
+//  - IDENTITY: pages below 1Gio which can be identity mapped in the kernel address space.
+//  - NORMAL: everything else.
+#define PHYSICAL_ORDER_COUNT 20
+#define PHYSICAL_IDENTITY_LIMIT (1024 * 1024 * 1024)
+
 extern size_t TOTAL_MEMORY;
 extern size_t USED_MEMORY;
-extern uint8_t MEMORY[1024 * 1024 / 8];
+
+void physical_initialize(Handover *handover, MemoryRange kernel_range);
+
+MemoryRange physical_pages_range();
 
 MemoryRange physical_alloc(size_t size);
 
+// Same as physical_alloc() but returns an empty range instead of panicking.
+MemoryRange physical_try_alloc(size_t size);
+
+MemoryRange physical_alloc_identity(size_t size);
+
 void physical_free(MemoryRange range);
 
 bool physical_is_used(MemoryRange range);
@@ -17,3 +32,5 @@ bool physical_is_used(MemoryRange range);
 void physical_set_used(MemoryRange range);
 
 void physical_set_free(MemoryRange range);
+
+void physical_dump();
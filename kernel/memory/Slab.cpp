@@ -0,0 +1,187 @@
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archs/VirtualMemory.h"
+
+#include "kernel/memory/Memory.h"
+#include "kernel/memory/Slab.h"
+
+struct SlabObject
+{
+    SlabObject *next;
+};
+
+#define SLAB_ALIGN 16
+#define SLAB_MIN_OBJECTS 16
+
+/* --- Caches --------------------------------------------------------------- */
+
+// Caches register themselves the first time they grow, the list is
+// only ever appended to so it can be walked without taking the lock.
+static Spinlock _slab_caches_lock{"slab-caches"};
+static SlabCache *_slab_caches = nullptr;
+
+static size_t slab_object_size(SlabCache *cache)
+{
+    return __align_up(MAX(cache->object_size, sizeof(SlabObject)), SLAB_ALIGN);
+}
+
+static void slab_register(SlabCache *cache)
+{
+    SpinlockHolder holder(_slab_caches_lock);
+
+    cache->next = _slab_caches;
+    __atomic_store_n(&_slab_caches, cache, __ATOMIC_RELEASE);
+}
+
+static bool slab_grow(SlabCache *cache)
+{
+    size_t object_size = slab_object_size(cache);
+    size_t size = PAGE_ALIGN_UP(object_size * SLAB_MIN_OBJECTS);
+
+    uintptr_t address = 0;
+
+    if (memory_alloc(arch_kernel_address_space(), size, MEMORY_NONE, &address) != SUCCESS)
+    {
+        return false;
+    }
+
+    if (cache->pages == 0)
+    {
+        slab_register(cache);
+    }
+
+    cache->pages += size / ARCH_PAGE_SIZE;
+
+    for (size_t offset = 0; offset + object_size <= size; offset += object_size)
+    {
+        auto object = reinterpret_cast<SlabObject *>(address + offset);
+
+        object->next = cache->free_objects;
+        cache->free_objects = object;
+    }
+
+    return true;
+}
+
+void *slab_alloc(SlabCache *cache)
+{
+    SpinlockHolder holder(cache->lock);
+
+    if (cache->free_objects)
+    {
+        cache->hits++;
+    }
+    else
+    {
+        cache->misses++;
+
+        if (!slab_grow(cache))
+        {
+            return nullptr;
+        }
+    }
+
+    SlabObject *object = cache->free_objects;
+    cache->free_objects = object->next;
+    cache->used++;
+
+    memset(object, 0, cache->object_size);
+
+    return object;
+}
+
+void slab_free(SlabCache *cache, void *object)
+{
+    if (object == nullptr)
+    {
+        return;
+    }
+
+    SpinlockHolder holder(cache->lock);
+
+    auto slab_object = reinterpret_cast<SlabObject *>(object);
+
+    slab_object->next = cache->free_objects;
+    cache->free_objects = slab_object;
+    cache->used--;
+}
+
+/* --- Size classes --------------------------------------------------------- */
+
+static SlabCache _slab_sized_caches[] = {
+    {"size-32", 32},
+    {"size-64", 64},
+    {"size-128", 128},
+    {"size-256", 256},
+    {"size-512", 512},
+};
+
+static SlabCache *slab_sized_cache(size_t size)
+{
+    for (size_t i = 0; i < __array_length(_slab_sized_caches); i++)
+    {
+        if (size <= _slab_sized_caches[i].object_size)
+        {
+            return &_slab_sized_caches[i];
+        }
+    }
+
+    return nullptr;
+}
+
+void *slab_alloc_sized(size_t size)
+{
+    SlabCache *cache = slab_sized_cache(size);
+
+    if (!cache)
+    {
+        return calloc(1, size);
+    }
+
+    return slab_alloc(cache);
+}
+
+void slab_free_sized(void *object, size_t size)
+{
+    SlabCache *cache = slab_sized_cache(size);
+
+    if (!cache)
+    {
+        free(object);
+        return;
+    }
+
+    slab_free(cache, object);
+}
+
+/* --- Statistics ----------------------------------------------------------- */
+
+void slab_iterate(void *target, SlabCacheIterateCallback callback)
+{
+    SlabCache *cache = __atomic_load_n(&_slab_caches, __ATOMIC_ACQUIRE);
+
+    while (cache)
+    {
+        if (callback(target, cache) == Iteration::STOP)
+        {
+            return;
+        }
+
+        cache = cache->next;
+    }
+}
+
+void slab_dump()
+{
+    stream_format(out_stream, "\n\tSlab caches:");
+
+    slab_iterate(nullptr, [](void *, SlabCache *cache) {
+        stream_format(out_stream, "\n\t - %-16s %6d used %4d pages %8d hits %6d misses",
+                      cache->name, cache->used, cache->pages, cache->hits, cache->misses);
+
+        return Iteration::CONTINUE;
+    });
+}
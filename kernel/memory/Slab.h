@@ -0,0 +1,74 @@
+#pragma once
+
+#include <libsystem/Common.h>
+#include <libutils/Iteration.h>
+
+#include "kernel/system/Spinlock.h"
+
+struct SlabObject;
+
+// Fixed-size kernel objects created and destroyed all the time (handles,
+// list items, memory mappings...) are recycled through per-type free lists
+// instead of going through the heap and its global lock every time.
+// Slabs are carved out of whole pages which are kept by their cache
+// once allocated. Taken before the memory lock, like the heap lock.
+struct SlabCache
+{
+    const char *name;
+    size_t object_size;
+
+    Spinlock lock{"slab"};
+
+    SlabObject *free_objects = nullptr;
+
+    // Allocations served from the free list and ones which had to grow the cache.
+    size_t hits = 0;
+    size_t misses = 0;
+
+    size_t used = 0;
+    size_t pages = 0;
+
+    SlabCache *next = nullptr;
+
+    constexpr SlabCache(const char *name, size_t object_size)
+        : name{name}, object_size{object_size}
+    {
+    }
+};
+
+// Objects are returned cleared, nullptr if there is no memory left.
+void *slab_alloc(SlabCache *cache);
+
+void slab_free(SlabCache *cache, void *object);
+
+// Pick a cache shared by every objects of about `size` bytes, for
+// polymorphic types, larger objects are forwarded to the heap.
+void *slab_alloc_sized(size_t size);
+
+void slab_free_sized(void *object, size_t size);
+
+typedef Iteration (*SlabCacheIterateCallback)(void *target, SlabCache *cache);
+
+void slab_iterate(void *target, SlabCacheIterateCallback callback);
+
+void slab_dump();
+
+// Route `new` and `delete` of a class to its own slab cache,
+// the cache is defined next to the class with SLAB_CACHE().
+#define SLAB_ALLOCATED                     \
+    static void *operator new(size_t size); \
+    static void operator delete(void *object)
+
+#define SLAB_CACHE(__type)                                      \
+    static SlabCache __type##_slab_cache{#__type, sizeof(__type)}; \
+                                                                \
+    void *__type::operator new(size_t size)                     \
+    {                                                           \
+        assert(size == sizeof(__type));                         \
+        return slab_alloc(&__type##_slab_cache);                \
+    }                                                           \
+                                                                \
+    void __type::operator delete(void *object)                  \
+    {                                                           \
+        slab_free(&__type##_slab_cache, object);                \
+    }
@@ -0,0 +1,418 @@
+#include <libsystem/math/MinMax.h>
+
+#include "archs/VirtualMemory.h"
+
+#include "kernel/memory/Memory.h"
+#include "kernel/memory/VirtualRanges.h"
+
+struct VirtualRangeNode
+{
+    uintptr_t base;
+    size_t size;
+
+    // Size of the largest free range in this subtree.
+    size_t largest;
+    int height;
+
+    VirtualRangeNode *left;
+    VirtualRangeNode *right;
+};
+
+/* --- Nodes ---------------------------------------------------------------- */
+
+// Nodes can't come from the kernel heap: it allocates its virtual memory
+// through us while holding its own lock. They are carved out of identity
+// mapped pages instead, which never need a free virtual range to be mapped.
+#define VIRTUAL_RANGES_BOOTSTRAP_NODES 64
+#define VIRTUAL_RANGES_LOW_NODES 8
+
+static VirtualRangeNode _bootstrap_nodes[VIRTUAL_RANGES_BOOTSTRAP_NODES] = {};
+static bool _bootstrapped = false;
+
+static VirtualRangeNode *_free_nodes = nullptr;
+static size_t _free_nodes_count = 0;
+
+// Growing the pool maps a page in the kernel address space which reserves it
+// in the kernel ranges, that nested operation lives on the remaining nodes.
+static bool _refilling = false;
+
+static void virtual_ranges_node_release(VirtualRangeNode *node)
+{
+    node->right = _free_nodes;
+    _free_nodes = node;
+    _free_nodes_count++;
+}
+
+static void virtual_ranges_refill()
+{
+    if (!_bootstrapped)
+    {
+        for (size_t i = 0; i < VIRTUAL_RANGES_BOOTSTRAP_NODES; i++)
+        {
+            virtual_ranges_node_release(&_bootstrap_nodes[i]);
+        }
+
+        _bootstrapped = true;
+    }
+
+    if (_free_nodes_count >= VIRTUAL_RANGES_LOW_NODES || _refilling)
+    {
+        return;
+    }
+
+    _refilling = true;
+
+    uintptr_t page = 0;
+
+    if (memory_alloc_identity(arch_kernel_address_space(), MEMORY_NONE, &page) == SUCCESS)
+    {
+        auto nodes = reinterpret_cast<VirtualRangeNode *>(page);
+
+        for (size_t i = 0; i < ARCH_PAGE_SIZE / sizeof(VirtualRangeNode); i++)
+        {
+            virtual_ranges_node_release(&nodes[i]);
+        }
+    }
+
+    _refilling = false;
+}
+
+static VirtualRangeNode *virtual_ranges_node_alloc(uintptr_t base, size_t size)
+{
+    assert(_free_nodes);
+
+    VirtualRangeNode *node = _free_nodes;
+    _free_nodes = node->right;
+    _free_nodes_count--;
+
+    *node = {base, size, size, 1, nullptr, nullptr};
+
+    return node;
+}
+
+static uintptr_t virtual_ranges_node_last(VirtualRangeNode *node)
+{
+    return node->base + node->size - 1;
+}
+
+/* --- Tree ----------------------------------------------------------------- */
+
+static int virtual_ranges_height(VirtualRangeNode *node)
+{
+    return node ? node->height : 0;
+}
+
+static size_t virtual_ranges_largest(VirtualRangeNode *node)
+{
+    return node ? node->largest : 0;
+}
+
+static void virtual_ranges_update(VirtualRangeNode *node)
+{
+    node->height = 1 + MAX(virtual_ranges_height(node->left), virtual_ranges_height(node->right));
+    node->largest = MAX(node->size, MAX(virtual_ranges_largest(node->left), virtual_ranges_largest(node->right)));
+}
+
+static VirtualRangeNode *virtual_ranges_rotate_right(VirtualRangeNode *node)
+{
+    VirtualRangeNode *left = node->left;
+
+    node->left = left->right;
+    left->right = node;
+
+    virtual_ranges_update(node);
+    virtual_ranges_update(left);
+
+    return left;
+}
+
+static VirtualRangeNode *virtual_ranges_rotate_left(VirtualRangeNode *node)
+{
+    VirtualRangeNode *right = node->right;
+
+    node->right = right->left;
+    right->left = node;
+
+    virtual_ranges_update(node);
+    virtual_ranges_update(right);
+
+    return right;
+}
+
+static VirtualRangeNode *virtual_ranges_balance(VirtualRangeNode *node)
+{
+    virtual_ranges_update(node);
+
+    int balance = virtual_ranges_height(node->left) - virtual_ranges_height(node->right);
+
+    if (balance > 1)
+    {
+        if (virtual_ranges_height(node->left->left) < virtual_ranges_height(node->left->right))
+        {
+            node->left = virtual_ranges_rotate_left(node->left);
+        }
+
+        return virtual_ranges_rotate_right(node);
+    }
+
+    if (balance < -1)
+    {
+        if (virtual_ranges_height(node->right->right) < virtual_ranges_height(node->right->left))
+        {
+            node->right = virtual_ranges_rotate_right(node->right);
+        }
+
+        return virtual_ranges_rotate_left(node);
+    }
+
+    return node;
+}
+
+static VirtualRangeNode *virtual_ranges_insert(VirtualRangeNode *root, VirtualRangeNode *node)
+{
+    if (!root)
+    {
+        return node;
+    }
+
+    if (node->base < root->base)
+    {
+        root->left = virtual_ranges_insert(root->left, node);
+    }
+    else
+    {
+        root->right = virtual_ranges_insert(root->right, node);
+    }
+
+    return virtual_ranges_balance(root);
+}
+
+static VirtualRangeNode *virtual_ranges_remove_min(VirtualRangeNode *root, VirtualRangeNode **min)
+{
+    if (!root->left)
+    {
+        *min = root;
+        return root->right;
+    }
+
+    root->left = virtual_ranges_remove_min(root->left, min);
+
+    return virtual_ranges_balance(root);
+}
+
+static VirtualRangeNode *virtual_ranges_remove(VirtualRangeNode *root, VirtualRangeNode *node)
+{
+    if (node->base < root->base)
+    {
+        root->left = virtual_ranges_remove(root->left, node);
+    }
+    else if (node->base > root->base)
+    {
+        root->right = virtual_ranges_remove(root->right, node);
+    }
+    else
+    {
+        VirtualRangeNode *left = root->left;
+        VirtualRangeNode *right = root->right;
+
+        virtual_ranges_node_release(root);
+
+        if (!right)
+        {
+            return left;
+        }
+
+        VirtualRangeNode *min = nullptr;
+        right = virtual_ranges_remove_min(right, &min);
+
+        min->left = left;
+        min->right = right;
+
+        return virtual_ranges_balance(min);
+    }
+
+    return virtual_ranges_balance(root);
+}
+
+// Find a free range overlapping [base, last], or only touching it if `adjacent` is set.
+static VirtualRangeNode *virtual_ranges_find(VirtualRangeNode *node, uintptr_t base, uintptr_t last, bool adjacent)
+{
+    while (node)
+    {
+        uintptr_t node_last = virtual_ranges_node_last(node);
+
+        bool after = node->base > last && !(adjacent && node->base - last == 1);
+        bool before = node_last < base && !(adjacent && base - node_last == 1);
+
+        if (after)
+        {
+            node = node->left;
+        }
+        else if (before)
+        {
+            node = node->right;
+        }
+        else
+        {
+            return node;
+        }
+    }
+
+    return nullptr;
+}
+
+static void virtual_ranges_release_all(VirtualRangeNode *node)
+{
+    if (!node)
+    {
+        return;
+    }
+
+    virtual_ranges_release_all(node->left);
+    virtual_ranges_release_all(node->right);
+    virtual_ranges_node_release(node);
+}
+
+/* --- Ranges --------------------------------------------------------------- */
+
+static bool virtual_ranges_clip(VirtualRanges *ranges, MemoryRange range, uintptr_t *base, uintptr_t *last)
+{
+    if (range.empty())
+    {
+        return false;
+    }
+
+    *base = MAX(range.base(), ranges->bounds.base());
+    *last = MIN(range.end(), ranges->bounds.end());
+
+    return *base <= *last;
+}
+
+void virtual_ranges_initialize(VirtualRanges *ranges, MemoryRange bounds)
+{
+    virtual_ranges_refill();
+
+    ranges->bounds = bounds;
+    ranges->root = virtual_ranges_node_alloc(bounds.base(), bounds.size());
+}
+
+void virtual_ranges_destroy(VirtualRanges *ranges)
+{
+    virtual_ranges_release_all(ranges->root);
+    ranges->root = nullptr;
+}
+
+MemoryRange virtual_ranges_alloc(VirtualRanges *ranges, size_t size)
+{
+    VirtualRangeNode *node = ranges->root;
+
+    if (size == 0 || virtual_ranges_largest(node) < size)
+    {
+        return {};
+    }
+
+    // Lowest address first fit, the largest field tells which side has room.
+    while (true)
+    {
+        if (virtual_ranges_largest(node->left) >= size)
+        {
+            node = node->left;
+        }
+        else if (node->size >= size)
+        {
+            break;
+        }
+        else
+        {
+            node = node->right;
+        }
+    }
+
+    MemoryRange result{node->base, size};
+
+    virtual_ranges_reserve(ranges, result);
+
+    return result;
+}
+
+MemoryRange virtual_ranges_alloc_aligned(VirtualRanges *ranges, size_t size, size_t align)
+{
+    if (align <= ARCH_PAGE_SIZE)
+    {
+        return virtual_ranges_alloc(ranges, size);
+    }
+
+    // Take enough room to fit an aligned range anywhere inside, and give back the slack around it.
+    MemoryRange padded = virtual_ranges_alloc(ranges, size + align - ARCH_PAGE_SIZE);
+
+    if (padded.empty())
+    {
+        return {};
+    }
+
+    MemoryRange result{__align_up(padded.base(), align), size};
+
+    virtual_ranges_free(ranges, {padded.base(), result.base() - padded.base()});
+    virtual_ranges_free(ranges, {result.base() + size, padded.base() + padded.size() - (result.base() + size)});
+
+    return result;
+}
+
+void virtual_ranges_reserve(VirtualRanges *ranges, MemoryRange range)
+{
+    uintptr_t base;
+    uintptr_t last;
+
+    if (!virtual_ranges_clip(ranges, range, &base, &last))
+    {
+        return;
+    }
+
+    virtual_ranges_refill();
+
+    VirtualRangeNode *node = nullptr;
+
+    while ((node = virtual_ranges_find(ranges->root, base, last, false)))
+    {
+        uintptr_t node_base = node->base;
+        uintptr_t node_last = virtual_ranges_node_last(node);
+
+        ranges->root = virtual_ranges_remove(ranges->root, node);
+
+        if (node_base < base)
+        {
+            ranges->root = virtual_ranges_insert(ranges->root, virtual_ranges_node_alloc(node_base, base - node_base));
+        }
+
+        if (node_last > last)
+        {
+            ranges->root = virtual_ranges_insert(ranges->root, virtual_ranges_node_alloc(last + 1, node_last - last));
+        }
+    }
+}
+
+void virtual_ranges_free(VirtualRanges *ranges, MemoryRange range)
+{
+    uintptr_t base;
+    uintptr_t last;
+
+    if (!virtual_ranges_clip(ranges, range, &base, &last))
+    {
+        return;
+    }
+
+    virtual_ranges_refill();
+
+    // Merge with the free ranges around, so the tree stays as small as possible.
+    VirtualRangeNode *node = nullptr;
+
+    while ((node = virtual_ranges_find(ranges->root, base, last, true)))
+    {
+        base = MIN(base, node->base);
+        last = MAX(last, virtual_ranges_node_last(node));
+
+        ranges->root = virtual_ranges_remove(ranges->root, node);
+    }
+
+    ranges->root = virtual_ranges_insert(ranges->root, virtual_ranges_node_alloc(base, last - base + 1));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+#include "kernel/memory/MemoryRange.h"
+
+struct VirtualRangeNode;
+
+// Free virtual memory of an address space, kept in a balanced tree of
+// free ranges sorted by address and augmented with the size of the largest
+// range of each subtree. Every operations are O(log n) in the number of ranges.
+// Callers must hold the memory lock.
+struct VirtualRanges
+{
+    MemoryRange bounds;
+    VirtualRangeNode *root;
+};
+
+void virtual_ranges_initialize(VirtualRanges *ranges, MemoryRange bounds);
+
+void virtual_ranges_destroy(VirtualRanges *ranges);
+
+// Take the lowest free range of `size` bytes, returns an empty range if there is none.
+MemoryRange virtual_ranges_alloc(VirtualRanges *ranges, size_t size);
+
+// Same as virtual_ranges_alloc() but the range starts on a multiple of `align`, a power of two.
+MemoryRange virtual_ranges_alloc_aligned(VirtualRanges *ranges, size_t size, size_t align);
+
+// Mark `range` as used, parts of it may already be used.
+void virtual_ranges_reserve(VirtualRanges *ranges, MemoryRange range);
+
+// Mark `range` as free, parts of it may already be free.
+void virtual_ranges_free(VirtualRanges *ranges, MemoryRange range);
@@ -3,16 +3,19 @@
 #include <libsystem/Logger.h>
 #include <libsystem/Result.h>
 
-#include "archs/VirtualMemory.h"
-
-#include "kernel/memory/Memory.h"
 #include "kernel/modules/Modules.h"
+#include "kernel/node/File.h"
 #include "kernel/scheduling/Scheduler.h"
 
+// The module is kept around: files read their content straight from
+// it, and only copy it to memory of their own once written to.
 void ramdisk_load(Module *module)
 {
+    void *cursor = (void *)module->range.base();
+    size_t files_count = 0;
+
     TARBlock block;
-    for (size_t i = 0; tar_read((void *)module->range.base(), &block, i); i++)
+    while (tar_next(&cursor, &block))
     {
         auto file_path = Path::parse(block.name);
 
@@ -27,26 +30,17 @@ void ramdisk_load(Module *module)
         }
         else if ((block.typeflag & 8) == 0 || (block.typeflag & 8) == 5)
         {
-            auto result_or_handle = scheduler_running()->domain().open(file_path, OPEN_WRITE | OPEN_CREATE);
+            Result result = scheduler_running()->domain().link(file_path, make<FsFile>(block.data, block.size));
 
-            if (!result_or_handle.success())
+            if (result != SUCCESS)
             {
-                logger_warn("Failed to open file %s! %s", block.name, result_to_string(result_or_handle.result()));
+                logger_warn("Failed to create file %s: %s", block.name, result_to_string(result));
                 continue;
             }
 
-            auto handle = result_or_handle.take_value();
-
-            auto result_or_written = handle->write(block.data, block.size);
-
-            if (!result_or_written.success())
-            {
-                logger_error("Failed to write file: %s", result_to_string(result_or_written.result()));
-            }
+            files_count++;
         }
     }
 
-    memory_free(arch_kernel_address_space(), module->range);
-
-    logger_info("Loading ramdisk succeeded.");
+    logger_info("Loading ramdisk succeeded, %d files.", files_count);
 }
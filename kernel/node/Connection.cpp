@@ -1,16 +1,25 @@
-
+#include <libsystem/math/MinMax.h>
 #include <string.h>
 
 #include "kernel/node/Connection.h"
 #include "kernel/node/Handle.h"
+#include "kernel/scheduling/Scheduler.h"
 
-#define CONNECTION_BUFFER_SIZE 4096
+FsConnection::FsConnection(bool packets) : FsNode(FILE_TYPE_CONNECTION), _packets(packets)
+{
+    _client_task = scheduler_running_id();
+}
 
-FsConnection::FsConnection() : FsNode(FILE_TYPE_CONNECTION) {}
+int FsConnection::peer_task(FsHandle &handle)
+{
+    return handle.has_flag(OPEN_CLIENT) ? _server_task : _client_task;
+}
 
 void FsConnection::accepted()
 {
     _accepted = true;
+    _server_task = scheduler_running_id();
+    wait_queue().wake_up();
 }
 
 bool FsConnection::is_accepted()
@@ -18,8 +27,34 @@ bool FsConnection::is_accepted()
     return _accepted;
 }
 
+bool FsConnection::peer_closed(FsHandle &handle)
+{
+    return handle.has_flag(OPEN_CLIENT) ? !server() : !clients();
+}
+
+FsConnection::PacketQueue &FsConnection::incoming(FsHandle &handle)
+{
+    return handle.has_flag(OPEN_CLIENT) ? _packets_to_client : _packets_to_server;
+}
+
+FsConnection::PacketQueue &FsConnection::outgoing(FsHandle &handle)
+{
+    return handle.has_flag(OPEN_CLIENT) ? _packets_to_server : _packets_to_client;
+}
+
+bool FsConnection::has_room(PacketQueue &queue)
+{
+    return queue.packets.count() < PACKETS_MAX_COUNT &&
+           queue.size + HANDLE_MESSAGE_MAX_SIZE <= BUFFER_MAX_SIZE;
+}
+
 bool FsConnection::can_read(FsHandle &handle)
 {
+    if (_packets)
+    {
+        return incoming(handle).packets.any() || peer_closed(handle);
+    }
+
     if (handle.has_flag(OPEN_CLIENT))
     {
         return !_data_to_client.empty() || !server();
@@ -32,6 +67,11 @@ bool FsConnection::can_read(FsHandle &handle)
 
 bool FsConnection::can_write(FsHandle &handle)
 {
+    if (_packets)
+    {
+        return has_room(outgoing(handle)) || peer_closed(handle);
+    }
+
     if (handle.has_flag(OPEN_CLIENT))
     {
         return !_data_to_server.full() || !server();
@@ -44,6 +84,16 @@ bool FsConnection::can_write(FsHandle &handle)
 
 ResultOr<size_t> FsConnection::read(FsHandle &handle, void *buffer, size_t size)
 {
+    if (_packets)
+    {
+        auto packet = TRY(receive(handle));
+
+        size = MIN(size, packet->size);
+        memcpy(buffer, packet->data, size);
+
+        return size;
+    }
+
     if (handle.has_flag(OPEN_CLIENT))
     {
         if (server())
@@ -68,13 +118,35 @@ ResultOr<size_t> FsConnection::read(FsHandle &handle, void *buffer, size_t size)
     }
 }
 
+size_t FsConnection::write_to(RingBuffer &buffer, const void *data, size_t size)
+{
+    if (size > buffer.available() && buffer.size() < BUFFER_MAX_SIZE)
+    {
+        buffer.grow(MIN(buffer.size() * 2, BUFFER_MAX_SIZE));
+    }
+
+    return buffer.write((const char *)data, size);
+}
+
 ResultOr<size_t> FsConnection::write(FsHandle &handle, const void *buffer, size_t size)
 {
+    if (_packets)
+    {
+        if (size > HANDLE_MESSAGE_MAX_SIZE)
+        {
+            return ERR_INVALID_ARGUMENT;
+        }
+
+        TRY(send(handle, own<FsPacket>(buffer, size)));
+
+        return size;
+    }
+
     if (handle.has_flag(OPEN_CLIENT))
     {
         if (server())
         {
-            return _data_to_server.write((const char *)buffer, size);
+            return write_to(_data_to_server, buffer, size);
         }
         else
         {
@@ -85,7 +157,7 @@ ResultOr<size_t> FsConnection::write(FsHandle &handle, const void *buffer, size_
     {
         if (clients())
         {
-            return _data_to_client.write((const char *)buffer, size);
+            return write_to(_data_to_client, buffer, size);
         }
         else
         {
@@ -93,3 +165,55 @@ ResultOr<size_t> FsConnection::write(FsHandle &handle, const void *buffer, size_
         }
     }
 }
+
+Result FsConnection::send(FsHandle &handle, OwnPtr<FsPacket> packet)
+{
+    if (!_packets)
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    if (peer_closed(handle))
+    {
+        return ERR_STREAM_CLOSED;
+    }
+
+    // The writer waited for room for a packet of the maximum size.
+    auto &queue = outgoing(handle);
+    assert(has_room(queue));
+
+    queue.size += packet->size;
+    queue.packets.push_back(move(packet));
+
+    return SUCCESS;
+}
+
+ResultOr<OwnPtr<FsPacket>> FsConnection::receive(FsHandle &handle)
+{
+    if (!_packets)
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    auto &queue = incoming(handle);
+
+    // What was sent before the other side went away can still be received.
+    if (queue.packets.empty())
+    {
+        return ERR_STREAM_CLOSED;
+    }
+
+    if (handle.has_flag(OPEN_CLIENT))
+    {
+        _client_task = scheduler_running_id();
+    }
+    else
+    {
+        _server_task = scheduler_running_id();
+    }
+
+    auto packet = queue.packets.take_at(0);
+    queue.size -= packet->size;
+
+    return packet;
+}
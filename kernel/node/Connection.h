@@ -1,22 +1,92 @@
 #pragma once
 
+#include <libutils/OwnPtr.h>
 #include <libutils/RingBuffer.h>
+#include <libutils/Vector.h>
 
-#include "kernel/node/Node.h"
+#include "kernel/Configs.h"
+#include "kernel/memory/MemoryObject.h"
+#include "kernel/node/Handle.h"
+
+// A message of a packet connection, its data is delivered at once,
+// with the handles and memory objects attached to it.
+struct FsPacket
+{
+    char *data = nullptr;
+    size_t size = 0;
+
+    RefPtr<FsHandle> handles[HANDLE_MESSAGE_MAX_HANDLES];
+    size_t handles_count = 0;
+
+    MemoryObject *memories[HANDLE_MESSAGE_MAX_MEMORIES] = {};
+    size_t memories_count = 0;
+
+    FsPacket(const void *buffer, size_t size) : size(size)
+    {
+        data = new char[size];
+        memcpy(data, buffer, size);
+    }
+
+    ~FsPacket()
+    {
+        delete[] data;
+
+        for (size_t i = 0; i < memories_count; i++)
+        {
+            memory_object_deref(memories[i]);
+        }
+    }
+};
 
 class FsConnection : public FsNode
 {
 private:
-    static constexpr int BUFFER_SIZE = 4096;
+    static constexpr size_t BUFFER_SIZE = 4096;
+
+    // Like pipes, each direction grows when writes don't fit anymore,
+    // see CONFIG_CONNECTION_BUFFER_MAX_SIZE.
+    static constexpr size_t BUFFER_MAX_SIZE = CONFIG_CONNECTION_BUFFER_MAX_SIZE * 1024;
+
+    // Packets waiting in one direction, their data is bounded like the buffers.
+    static constexpr size_t PACKETS_MAX_COUNT = 64;
+
+    struct PacketQueue
+    {
+        Vector<OwnPtr<FsPacket>> packets{PACKETS_MAX_COUNT};
+        size_t size = 0;
+    };
 
     bool _accepted = false;
+    bool _packets;
 
     RingBuffer _data_to_server{BUFFER_SIZE};
 
     RingBuffer _data_to_client{BUFFER_SIZE};
 
+    PacketQueue _packets_to_server;
+
+    PacketQueue _packets_to_client;
+
+    // Last tasks to receive on each side, where exchange() hands off the cpu.
+    int _server_task = -1;
+    int _client_task = -1;
+
+    static size_t write_to(RingBuffer &buffer, const void *data, size_t size);
+
+    static bool has_room(PacketQueue &queue);
+
+    bool peer_closed(FsHandle &handle);
+
+    PacketQueue &incoming(FsHandle &handle);
+
+    PacketQueue &outgoing(FsHandle &handle);
+
 public:
-    FsConnection();
+    FsConnection(bool packets);
+
+    bool is_packets() { return _packets; }
+
+    int peer_task(FsHandle &handle);
 
     void accepted() override;
 
@@ -26,7 +96,12 @@ public:
 
     bool can_write(FsHandle &handle) override;
 
+    // Packets read this way lose their attachments.
     ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size) override;
 
     ResultOr<size_t> write(FsHandle &handle, const void *buffer, size_t size) override;
+
+    Result send(FsHandle &handle, OwnPtr<FsPacket> packet);
+
+    ResultOr<OwnPtr<FsPacket>> receive(FsHandle &handle);
 };
@@ -0,0 +1,235 @@
+#include <assert.h>
+#include <skift/Lock.h>
+
+#include "kernel/memory/Slab.h"
+#include "kernel/node/DentryCache.h"
+
+#define DENTRY_CACHE_BUCKETS 1024
+#define DENTRY_CACHE_SIZE 4096
+
+struct Dentry
+{
+    RefPtr<FsNode> parent;
+    String name;
+    uint32_t hash;
+
+    // Null for a negative entry.
+    RefPtr<FsNode> node;
+
+    Dentry *next_in_bucket;
+
+    Dentry *prev_used;
+    Dentry *next_used;
+
+    SLAB_ALLOCATED;
+};
+
+SLAB_CACHE(Dentry)
+
+// Entries keep their directory alive, so a directory can't be freed
+// and its address reused by another one while it's still in the cache.
+static Lock _dentry_cache_lock{"dentry-cache"};
+
+static Dentry *_dentry_buckets[DENTRY_CACHE_BUCKETS] = {};
+
+// Most recently used first, the least recently used is evicted when full.
+static Dentry *_dentry_most_used = nullptr;
+static Dentry *_dentry_least_used = nullptr;
+
+static DentryCacheStatistics _dentry_statistics = {};
+
+static uint32_t dentry_hash(FsNode *parent, String &name)
+{
+    return hash<String>(name) ^ (uint32_t)((uintptr_t)parent * 2654435761u);
+}
+
+static Dentry **dentry_bucket(uint32_t hash)
+{
+    return &_dentry_buckets[hash % DENTRY_CACHE_BUCKETS];
+}
+
+static Dentry *dentry_find(FsNode *parent, String &name, uint32_t hash)
+{
+    Dentry *dentry = *dentry_bucket(hash);
+
+    while (dentry)
+    {
+        if (dentry->hash == hash && dentry->parent.naked() == parent && dentry->name == name)
+        {
+            return dentry;
+        }
+
+        dentry = dentry->next_in_bucket;
+    }
+
+    return nullptr;
+}
+
+static void dentry_unlink_used(Dentry *dentry)
+{
+    if (dentry->prev_used)
+    {
+        dentry->prev_used->next_used = dentry->next_used;
+    }
+    else
+    {
+        _dentry_most_used = dentry->next_used;
+    }
+
+    if (dentry->next_used)
+    {
+        dentry->next_used->prev_used = dentry->prev_used;
+    }
+    else
+    {
+        _dentry_least_used = dentry->prev_used;
+    }
+}
+
+static void dentry_link_used(Dentry *dentry)
+{
+    dentry->prev_used = nullptr;
+    dentry->next_used = _dentry_most_used;
+
+    if (_dentry_most_used)
+    {
+        _dentry_most_used->prev_used = dentry;
+    }
+    else
+    {
+        _dentry_least_used = dentry;
+    }
+
+    _dentry_most_used = dentry;
+}
+
+// Entries are only deleted once the lock is released, dropping the last
+// reference to a node may have to take locks of its own.
+static void dentry_remove(Dentry *dentry)
+{
+    Dentry **link = dentry_bucket(dentry->hash);
+
+    while (*link != dentry)
+    {
+        link = &(*link)->next_in_bucket;
+    }
+
+    *link = dentry->next_in_bucket;
+
+    dentry_unlink_used(dentry);
+
+    _dentry_statistics.entries--;
+}
+
+bool dentry_cache_lookup(FsNode *parent, String &name, RefPtr<FsNode> &node)
+{
+    uint32_t hash = dentry_hash(parent, name);
+
+    LockHolder holder(_dentry_cache_lock);
+
+    Dentry *dentry = dentry_find(parent, name, hash);
+
+    if (!dentry)
+    {
+        _dentry_statistics.misses++;
+        return false;
+    }
+
+    if (dentry->node)
+    {
+        _dentry_statistics.hits++;
+    }
+    else
+    {
+        _dentry_statistics.negative_hits++;
+    }
+
+    dentry_unlink_used(dentry);
+    dentry_link_used(dentry);
+
+    node = dentry->node;
+
+    return true;
+}
+
+void dentry_cache_insert(RefPtr<FsNode> parent, String &name, RefPtr<FsNode> node)
+{
+    uint32_t hash = dentry_hash(parent.naked(), name);
+
+    Dentry *dentry = new Dentry{};
+
+    if (!dentry)
+    {
+        return;
+    }
+
+    dentry->parent = parent;
+    dentry->name = name;
+    dentry->hash = hash;
+    dentry->node = node;
+
+    Dentry *replaced = nullptr;
+    Dentry *evicted = nullptr;
+
+    {
+        LockHolder holder(_dentry_cache_lock);
+
+        // Two tasks may have missed the same name one after the other.
+        replaced = dentry_find(parent.naked(), name, hash);
+
+        if (replaced)
+        {
+            dentry_remove(replaced);
+        }
+
+        if (_dentry_statistics.entries >= DENTRY_CACHE_SIZE)
+        {
+            evicted = _dentry_least_used;
+            dentry_remove(evicted);
+
+            _dentry_statistics.evictions++;
+        }
+
+        Dentry **bucket = dentry_bucket(hash);
+        dentry->next_in_bucket = *bucket;
+        *bucket = dentry;
+
+        dentry_link_used(dentry);
+
+        _dentry_statistics.entries++;
+    }
+
+    delete replaced;
+    delete evicted;
+}
+
+void dentry_cache_invalidate(FsNode *parent, String &name)
+{
+    uint32_t hash = dentry_hash(parent, name);
+
+    Dentry *dentry = nullptr;
+
+    {
+        LockHolder holder(_dentry_cache_lock);
+
+        dentry = dentry_find(parent, name, hash);
+
+        if (!dentry)
+        {
+            return;
+        }
+
+        dentry_remove(dentry);
+
+        _dentry_statistics.invalidations++;
+    }
+
+    delete dentry;
+}
+
+DentryCacheStatistics dentry_cache_statistics()
+{
+    LockHolder holder(_dentry_cache_lock);
+
+    return _dentry_statistics;
+}
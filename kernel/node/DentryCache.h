@@ -0,0 +1,32 @@
+#pragma once
+
+#include <libutils/RefPtr.h>
+#include <libutils/String.h>
+
+#include "kernel/node/Node.h"
+
+// Path components resolved recently, by directory and name, so walking a
+// path doesn't have to lock and search every directory along the way.
+// Names which were not found are remembered too, as negative entries.
+// Directories invalidate the names they link or unlink.
+struct DentryCacheStatistics
+{
+    size_t entries;
+
+    size_t hits;
+    size_t negative_hits;
+    size_t misses;
+
+    size_t evictions;
+    size_t invalidations;
+};
+
+// True if `name` is cached for `parent`, then `node` is nullptr for a negative entry.
+bool dentry_cache_lookup(FsNode *parent, String &name, RefPtr<FsNode> &node);
+
+// The caller holds the parent, so the entry can't be invalidated before it's inserted.
+void dentry_cache_insert(RefPtr<FsNode> parent, String &name, RefPtr<FsNode> node);
+
+void dentry_cache_invalidate(FsNode *parent, String &name);
+
+DentryCacheStatistics dentry_cache_statistics();
@@ -0,0 +1,59 @@
+#include <libsystem/Logger.h>
+#include <libsystem/Result.h>
+#include <libsystem/math/MinMax.h>
+#include <libutils/json/Json.h>
+#include <string.h>
+
+#include "kernel/node/DentryCache.h"
+#include "kernel/node/DentryInfo.h"
+#include "kernel/node/Handle.h"
+#include "kernel/scheduling/Scheduler.h"
+
+FsDentryInfo::FsDentryInfo() : FsNode(FILE_TYPE_DEVICE)
+{
+}
+
+Result FsDentryInfo::open(FsHandle &handle)
+{
+    auto statistics = dentry_cache_statistics();
+
+    json::Value::Object object{};
+
+    object["entries"] = (int)statistics.entries;
+    object["hits"] = (int)statistics.hits;
+    object["negative-hits"] = (int)statistics.negative_hits;
+    object["misses"] = (int)statistics.misses;
+    object["evictions"] = (int)statistics.evictions;
+    object["invalidations"] = (int)statistics.invalidations;
+
+    Prettifier pretty{};
+    json::prettify(pretty, object);
+
+    handle.attached = pretty.finalize().storage().give_ref();
+    handle.attached_size = reinterpret_cast<StringStorage *>(handle.attached)->size();
+
+    return SUCCESS;
+}
+
+void FsDentryInfo::close(FsHandle &handle)
+{
+    deref_if_not_null(reinterpret_cast<StringStorage *>(handle.attached));
+}
+
+ResultOr<size_t> FsDentryInfo::read(FsHandle &handle, void *buffer, size_t size)
+{
+    size_t read = 0;
+
+    if (handle.offset() <= handle.attached_size)
+    {
+        read = MIN(handle.attached_size - handle.offset(), size);
+        memcpy(buffer, reinterpret_cast<StringStorage *>(handle.attached)->cstring() + handle.offset(), read);
+    }
+
+    return read;
+}
+
+void dentry_info_initialize()
+{
+    scheduler_running()->domain().link(Path::parse("/System/dentries"), make<FsDentryInfo>());
+}
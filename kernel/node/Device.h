@@ -20,6 +20,11 @@ public:
     {
     }
 
+    WaitQueue &wait_queue() override
+    {
+        return _device->wait_queue();
+    }
+
     size_t size() override
     {
         return _device->size();
@@ -1,24 +1,35 @@
 
 #include <libsystem/Logger.h>
 #include <libsystem/Result.h>
+#include <libsystem/math/MinMax.h>
 #include <string.h>
 
+#include "kernel/node/DentryCache.h"
 #include "kernel/node/Directory.h"
 #include "kernel/node/Handle.h"
 
+#define DIRECTORY_MIN_BUCKETS 8
+
 FsDirectory::FsDirectory() : FsNode(FILE_TYPE_DIRECTORY)
 {
 }
 
 Result FsDirectory::open(FsHandle &handle)
 {
-    DirectoryListing *listing = (DirectoryListing *)malloc(sizeof(DirectoryListing) + sizeof(DirectoryEntry) * _childs.count());
+    size_t count = _childs.count() - _unlinked;
+
+    DirectoryListing *listing = (DirectoryListing *)malloc(sizeof(DirectoryListing) + sizeof(DirectoryEntry) * count);
 
-    listing->count = _childs.count();
+    listing->count = count;
 
     int current_index = 0;
 
     _childs.foreach ([&](auto &entry) {
+        if (entry.node == nullptr)
+        {
+            return Iteration::CONTINUE;
+        }
+
         auto record = &listing->entries[current_index];
         auto node = entry.node;
 
@@ -67,50 +78,142 @@ ResultOr<size_t> FsDirectory::read(FsHandle &handle, void *buffer, size_t size)
     }
 }
 
-RefPtr<FsNode> FsDirectory::find(String name)
+void FsDirectory::rehash(size_t bucket_count)
 {
-    RefPtr<FsNode> result;
+    _buckets.resize(bucket_count);
 
-    _childs.foreach ([&](auto &entry) {
-        if (entry.name == name)
+    for (size_t i = 0; i < bucket_count; i++)
+    {
+        _buckets[i] = -1;
+    }
+
+    for (size_t i = 0; i < _childs.count(); i++)
+    {
+        int &bucket = _buckets[_childs[i].hash % bucket_count];
+
+        _childs[i].next = bucket;
+        bucket = i;
+    }
+}
+
+void FsDirectory::compact()
+{
+    if (_unlinked == 0)
+    {
+        return;
+    }
+
+    Vector<FsDirectoryEntry> childs(_childs.count() - _unlinked);
+
+    for (size_t i = 0; i < _childs.count(); i++)
+    {
+        if (_childs[i].node != nullptr)
         {
-            result = entry.node;
+            childs.push_back(move(_childs[i]));
+        }
+    }
+
+    _childs = move(childs);
+    _unlinked = 0;
+}
 
-            return Iteration::STOP;
+int FsDirectory::lookup(String &name, uint32_t hash)
+{
+    if (_buckets.count() == 0)
+    {
+        return -1;
+    }
+
+    int index = _buckets[hash % _buckets.count()];
+
+    while (index != -1)
+    {
+        auto &entry = _childs[index];
+
+        if (entry.hash == hash && entry.name == name)
+        {
+            return index;
         }
 
-        return Iteration::CONTINUE;
-    });
+        index = entry.next;
+    }
+
+    return -1;
+}
+
+RefPtr<FsNode> FsDirectory::find(String name)
+{
+    int index = lookup(name, hash<String>(name));
 
-    return result;
+    if (index == -1)
+    {
+        return nullptr;
+    }
+
+    return _childs[index].node;
 }
 
 Result FsDirectory::link(String name, RefPtr<FsNode> child)
 {
-    if (find(name))
+    uint32_t name_hash = hash<String>(name);
+
+    if (lookup(name, name_hash) != -1)
     {
         return ERR_FILE_EXISTS;
     }
 
-    _childs.push_back({name, child});
+    dentry_cache_invalidate(this, name);
+
+    _childs.push_back({name, child, name_hash, -1});
+
+    if (_childs.count() > _buckets.count() * 2)
+    {
+        compact();
+        rehash(MAX(_buckets.count() * 2, DIRECTORY_MIN_BUCKETS));
+    }
+    else
+    {
+        int &bucket = _buckets[name_hash % _buckets.count()];
+
+        _childs[_childs.count() - 1].next = bucket;
+        bucket = _childs.count() - 1;
+    }
 
     return SUCCESS;
 }
 
 Result FsDirectory::unlink(String name)
 {
+    uint32_t name_hash = hash<String>(name);
+    int index = lookup(name, name_hash);
+
+    if (index == -1)
+    {
+        return ERR_NO_SUCH_FILE_OR_DIRECTORY;
+    }
 
-    bool has_removed_an_entry = _childs.remove_all_match(
-        [&](auto &e) {
-            return e.name == name;
-        });
+    dentry_cache_invalidate(this, name);
 
-    if (has_removed_an_entry)
+    int *chain = &_buckets[name_hash % _buckets.count()];
+
+    while (*chain != index)
     {
-        return SUCCESS;
+        chain = &_childs[*chain].next;
     }
-    else
+
+    *chain = _childs[index].next;
+
+    // Removing the entry would move the ones after it, it stays until
+    // enough of them are unlinked to rebuild the chains only once.
+    _childs[index].node = nullptr;
+    _childs[index].next = -1;
+    _unlinked++;
+
+    if (_unlinked > _childs.count() / 2)
     {
-        return ERR_NO_SUCH_FILE_OR_DIRECTORY;
+        compact();
+        rehash(_buckets.count());
     }
+
+    return SUCCESS;
 }
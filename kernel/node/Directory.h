@@ -14,12 +14,28 @@ struct FsDirectoryEntry
 {
     String name;
     RefPtr<FsNode> node;
+
+    uint32_t hash;
+
+    // Next entry in the same bucket, as an index in the childs, -1 for none.
+    int next;
 };
 
 class FsDirectory : public FsNode
 {
 private:
+    // Childs are kept in the order they were linked, for listings,
+    // and chained in buckets by the hash of their name, for lookups.
+    // Unlinked childs are left behind without a node until the next compact().
     Vector<FsDirectoryEntry> _childs{};
+    Vector<int> _buckets{};
+    size_t _unlinked = 0;
+
+    void rehash(size_t bucket_count);
+
+    void compact();
+
+    int lookup(String &name, uint32_t hash);
 
 public:
     FsDirectory();
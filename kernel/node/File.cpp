@@ -1,4 +1,3 @@
-
 #include <libsystem/Logger.h>
 #include <libsystem/Result.h>
 #include <string.h>
@@ -9,24 +8,92 @@
 
 FsFile::FsFile() : FsNode(FILE_TYPE_REGULAR)
 {
-    _buffer = (char *)malloc(512);
-    _buffer_allocated = 512;
-    _buffer_size = 0;
+    _memory_object = memory_object_create(ARCH_PAGE_SIZE);
+    _size = 0;
+    _content = nullptr;
+}
+
+FsFile::FsFile(const char *content, size_t size) : FsNode(FILE_TYPE_REGULAR)
+{
+    _memory_object = nullptr;
+    _size = size;
+    _content = content;
 }
 
 FsFile::~FsFile()
 {
-    free(_buffer);
+    if (_memory_object)
+    {
+        memory_object_deref(_memory_object);
+    }
+}
+
+Result FsFile::copy_content()
+{
+    auto memory_object = memory_object_create(MAX(_size, ARCH_PAGE_SIZE));
+
+    if (memory_object_write(memory_object, 0, _content, _size) != _size)
+    {
+        memory_object_deref(memory_object);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    // Tasks which mapped the module pages keep them, and won't see later writes.
+    if (_memory_object)
+    {
+        memory_object_deref(_memory_object);
+    }
+
+    _memory_object = memory_object;
+    _content = nullptr;
+
+    return SUCCESS;
+}
+
+MemoryObject *FsFile::memory_object()
+{
+    if (!_content || _memory_object)
+    {
+        return _memory_object;
+    }
+
+    // Mapping needs the content to start on a page, then its whole pages are
+    // borrowed from the module and only the last partial one is copied.
+    if ((uintptr_t)_content % ARCH_PAGE_SIZE != 0 || _size < ARCH_PAGE_SIZE)
+    {
+        if (copy_content() != SUCCESS)
+        {
+            return nullptr;
+        }
+
+        return _memory_object;
+    }
+
+    size_t borrowed = PAGE_ALIGN_DOWN(_size);
+
+    auto memory_object = memory_object_create_borrowed({(uintptr_t)_content, borrowed});
+
+    if (borrowed < _size)
+    {
+        memory_object_grow(memory_object, _size);
+
+        if (memory_object_write(memory_object, borrowed, _content + borrowed, _size - borrowed) != _size - borrowed)
+        {
+            memory_object_deref(memory_object);
+            return nullptr;
+        }
+    }
+
+    _memory_object = memory_object;
+
+    return _memory_object;
 }
 
 Result FsFile::open(FsHandle &handle)
 {
     if (handle.has_flag(OPEN_TRUNC))
     {
-        free(_buffer);
-        _buffer = (char *)malloc(512);
-        _buffer_allocated = 512;
-        _buffer_size = 0;
+        return truncate(0);
     }
 
     return SUCCESS;
@@ -34,17 +101,46 @@ Result FsFile::open(FsHandle &handle)
 
 size_t FsFile::size()
 {
-    return _buffer_size;
+    return _size;
+}
+
+Result FsFile::truncate(size_t size)
+{
+    if (_content)
+    {
+        TRY(copy_content());
+    }
+
+    if (size < _size)
+    {
+        memory_object_clear(_memory_object, size, _size - size);
+    }
+    else
+    {
+        memory_object_grow(_memory_object, size);
+    }
+
+    _size = size;
+
+    return SUCCESS;
 }
 
 ResultOr<size_t> FsFile::read(FsHandle &handle, void *buffer, size_t size)
 {
     size_t read = 0;
 
-    if (handle.offset() <= _buffer_size)
+    if (handle.offset() <= _size)
     {
-        read = MIN(_buffer_size - handle.offset(), size);
-        memcpy(buffer, (char *)_buffer + handle.offset(), read);
+        read = MIN(_size - handle.offset(), size);
+
+        if (_content)
+        {
+            memcpy(buffer, _content + handle.offset(), read);
+        }
+        else
+        {
+            memory_object_read(_memory_object, handle.offset(), buffer, read);
+        }
     }
 
     return read;
@@ -52,14 +148,27 @@ ResultOr<size_t> FsFile::read(FsHandle &handle, void *buffer, size_t size)
 
 ResultOr<size_t> FsFile::write(FsHandle &handle, const void *buffer, size_t size)
 {
-    if ((handle.offset() + size) > _buffer_allocated)
+    if (_content)
+    {
+        TRY(copy_content());
+    }
+
+    size_t end = handle.offset() + size;
+
+    if (end > _memory_object->size)
+    {
+        // Only the page index is copied, but appending in small chunks should stay cheap.
+        memory_object_grow(_memory_object, MAX(end, _memory_object->size * 2));
+    }
+
+    size_t written = memory_object_write(_memory_object, handle.offset(), buffer, size);
+
+    if (written == 0 && size > 0)
     {
-        _buffer = (char *)realloc(_buffer, handle.offset() + size);
-        _buffer_allocated = handle.offset() + size;
+        return ERR_OUT_OF_MEMORY;
     }
 
-    _buffer_size = MAX(handle.offset() + size, _buffer_size);
-    memcpy((char *)(_buffer) + handle.offset(), buffer, size);
+    _size = MAX(handle.offset() + written, _size);
 
-    return size;
+    return written;
 }
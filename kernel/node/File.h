@@ -1,23 +1,41 @@
 #pragma once
 
+#include "kernel/memory/MemoryObject.h"
 #include "kernel/node/Node.h"
 
 class FsFile : public FsNode
 {
 private:
-    char *_buffer;
-    size_t _buffer_allocated;
-    size_t _buffer_size;
+    // The content lives in the pages of a memory object, so it can be mapped.
+    // Its capacity grows geometrically and pages never written to are holes.
+    MemoryObject *_memory_object;
+    size_t _size;
+
+    // Files of the ramdisk are read straight from the boot module, the content
+    // is only copied to a memory object of their own on the first write.
+    const char *_content;
+
+    // Fails without touching the file if there isn't enough memory for the copy.
+    Result copy_content();
 
 public:
+    // nullptr if the content of the file couldn't be copied to one.
+    MemoryObject *memory_object() override;
+
     FsFile();
 
+    // `content` must stay identity mapped for as long as the file exists.
+    FsFile(const char *content, size_t size);
+
     ~FsFile() override;
 
     Result open(FsHandle &handle) override;
 
     size_t size() override;
 
+    // Pages past the new end are given back, growing the file leaves a hole.
+    Result truncate(size_t size);
+
     ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size) override;
 
     ResultOr<size_t> write(FsHandle &handle, const void *buffer, size_t size) override;
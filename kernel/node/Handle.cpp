@@ -11,6 +11,8 @@
 #include "kernel/scheduling/Blocker.h"
 #include "kernel/scheduling/Scheduler.h"
 
+SLAB_CACHE(FsHandle)
+
 FsHandle::FsHandle(RefPtr<FsNode> node, OpenFlag flags)
 {
     _node = node;
@@ -248,3 +250,93 @@ ResultOr<RefPtr<FsHandle>> FsHandle::accept()
 
     return connection_handle;
 }
+
+#define FSHANDLE_SPLICE_CHUNK_SIZE (16 * 1024)
+
+ResultOr<size_t> FsHandle::splice(FsHandle &destination, size_t size)
+{
+    auto buffer = new char[FSHANDLE_SPLICE_CHUNK_SIZE];
+
+    size_t spliced = 0;
+    Result result = SUCCESS;
+
+    while (spliced < size)
+    {
+        auto result_or_read = read(buffer, MIN(size - spliced, FSHANDLE_SPLICE_CHUNK_SIZE));
+
+        if (!result_or_read.success())
+        {
+            result = result_or_read.result();
+            break;
+        }
+
+        size_t chunk = result_or_read.value();
+
+        if (chunk == 0)
+        {
+            break;
+        }
+
+        auto result_or_written = destination.write(buffer, chunk);
+
+        if (!result_or_written.success())
+        {
+            result = result_or_written.result();
+            break;
+        }
+
+        spliced += chunk;
+    }
+
+    delete[] buffer;
+
+    // Like a read, what was moved before an error is reported first.
+    if (spliced == 0 && result != SUCCESS)
+    {
+        return result;
+    }
+
+    return spliced;
+}
+
+static bool is_packet_connection(RefPtr<FsNode> node)
+{
+    return node->type() == FILE_TYPE_CONNECTION &&
+           static_cast<FsConnection *>(node.naked())->is_packets();
+}
+
+Result FsHandle::send(OwnPtr<FsPacket> packet)
+{
+    if (!is_packet_connection(_node))
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    BlockerWrite blocker{*this};
+    TRY(task_block(scheduler_running(), blocker, -1));
+
+    auto connection = static_cast<FsConnection *>(_node.naked());
+    Result result = connection->send(*this, move(packet));
+
+    _node->release(scheduler_running_id());
+
+    return result;
+}
+
+ResultOr<OwnPtr<FsPacket>> FsHandle::receive()
+{
+    if (!is_packet_connection(_node))
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    BlockerRead blocker{*this};
+    TRY(task_block(scheduler_running(), blocker, -1));
+
+    auto connection = static_cast<FsConnection *>(_node.naked());
+    auto result_or_packet = connection->receive(*this);
+
+    _node->release(scheduler_running_id());
+
+    return result_or_packet;
+}
@@ -2,9 +2,13 @@
 
 #include <abi/Handle.h>
 #include <libio/Seek.h>
+#include <libutils/OwnPtr.h>
 
+#include "kernel/memory/Slab.h"
 #include "kernel/node/Node.h"
 
+struct FsPacket;
+
 class FsHandle : public RefCounted<FsHandle>
 {
 private:
@@ -14,6 +18,8 @@ private:
     size_t _offset = 0;
 
 public:
+    SLAB_ALLOCATED;
+
     void *attached;
     size_t attached_size;
 
@@ -50,4 +56,13 @@ public:
     Result stat(FileState *stat);
 
     ResultOr<RefPtr<FsHandle>> accept();
+
+    // Move up to `size` bytes from this handle to `destination`, through a
+    // buffer of the kernel. Stops early at the end of the source.
+    ResultOr<size_t> splice(FsHandle &destination, size_t size);
+
+    // Messages of packet connections, see FsConnection.
+    Result send(OwnPtr<FsPacket> packet);
+
+    ResultOr<OwnPtr<FsPacket>> receive();
 };
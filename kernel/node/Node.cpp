@@ -53,6 +53,8 @@ void FsNode::deref_handle(FsHandle &handle)
     {
         __atomic_sub_fetch(&_server, 1, __ATOMIC_SEQ_CST);
     }
+
+    wait_queue().wake_up();
 }
 
 bool FsNode::is_acquire()
@@ -68,4 +70,6 @@ void FsNode::acquire(int who_acquire)
 void FsNode::release(int who_release)
 {
     _lock.release_for(who_release, SOURCE_LOCATION);
+
+    wait_queue().wake_up();
 }
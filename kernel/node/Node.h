@@ -9,13 +9,18 @@
 #include <libutils/String.h>
 #include <skift/Lock.h>
 
+#include "kernel/memory/Slab.h"
+#include "kernel/scheduling/WaitQueue.h"
+
 struct FsNode;
 struct FsHandle;
+struct MemoryObject;
 
 struct FsNode : public RefCounted<FsNode>
 {
 private:
     Lock _lock{"fsnode"};
+    WaitQueue _wait_queue{};
     FileType _type;
 
     unsigned int _readers = 0;
@@ -36,10 +41,20 @@ public:
 
     FsNode(FileType type);
 
+    // Pipes, connections and sockets come and go with their handles,
+    // nodes of every types share the slab caches of their size.
+    static void *operator new(size_t size) { return slab_alloc_sized(size); }
+
+    static void operator delete(void *object, size_t size) { slab_free_sized(object, size); }
+
     virtual ~FsNode()
     {
     }
 
+    // Tasks blocked until the state of this node changes, they are
+    // woken up each time the node is released or a handle is closed.
+    virtual WaitQueue &wait_queue() { return _wait_queue; }
+
     void ref_handle(FsHandle &handle);
 
     void deref_handle(FsHandle &handle);
@@ -81,6 +96,9 @@ public:
         return ERR_NOT_WRITABLE;
     }
 
+    // Pages holding the content of the node, for nodes which can be mapped.
+    virtual MemoryObject *memory_object() { return nullptr; }
+
     virtual RefPtr<FsNode> find(String name)
     {
         __unused(name);
@@ -1,5 +1,6 @@
 
 #include <libsystem/Result.h>
+#include <libsystem/math/MinMax.h>
 
 #include "kernel/node/Handle.h"
 #include "kernel/node/Pipe.h"
@@ -41,5 +42,10 @@ ResultOr<size_t> FsPipe::write(FsHandle &handle, const void *buffer, size_t size
         return ERR_STREAM_CLOSED;
     }
 
+    if (size > _buffer.available() && _buffer.size() < BUFFER_MAX_SIZE)
+    {
+        _buffer.grow(MIN(_buffer.size() * 2, BUFFER_MAX_SIZE));
+    }
+
     return _buffer.write((const char *)buffer, size);
 }
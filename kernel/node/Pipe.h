@@ -2,12 +2,17 @@
 
 #include <libutils/RingBuffer.h>
 
+#include "kernel/Configs.h"
 #include "kernel/node/Node.h"
 
 class FsPipe : public FsNode
 {
 private:
-    static constexpr int BUFFER_SIZE = 4096;
+    static constexpr size_t BUFFER_SIZE = 4096;
+
+    // Writes which don't fit make the buffer grow, so a reader that can't
+    // keep up gets more data each time it's woken up, see CONFIG_PIPE_BUFFER_MAX_SIZE.
+    static constexpr size_t BUFFER_MAX_SIZE = CONFIG_PIPE_BUFFER_MAX_SIZE * 1024;
 
     RingBuffer _buffer{BUFFER_SIZE};
 
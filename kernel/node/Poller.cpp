@@ -0,0 +1,295 @@
+#include <libsystem/Result.h>
+
+#include "kernel/interrupts/Interupts.h"
+#include "kernel/node/Handle.h"
+#include "kernel/node/Poller.h"
+#include "kernel/scheduling/Scheduler.h"
+
+struct PollerInterest
+{
+    FsPoller *poller;
+
+    int handle;
+    PollEvent events;
+    bool edge_triggered;
+
+    // Keeps the node and its wait queue alive, but not the handle, it would
+    // keep pipes and connections open after the task closed its end.
+    RefPtr<FsNode> node;
+    WaitQueueEntry entry;
+
+    bool ready;
+    PollerInterest *prev_ready;
+    PollerInterest *next_ready;
+};
+
+FsPoller::FsPoller() : FsNode(FILE_TYPE_POLLER)
+{
+}
+
+FsPoller::~FsPoller()
+{
+    for (size_t i = 0; i < _interests.count(); i++)
+    {
+        if (_interests[i])
+        {
+            destroy(_interests[i]);
+        }
+    }
+}
+
+PollerInterest *FsPoller::interest_by_handle(int handle)
+{
+    if (handle < 0 || (size_t)handle >= _interests.count())
+    {
+        return nullptr;
+    }
+
+    return _interests[handle];
+}
+
+void FsPoller::push_ready(PollerInterest *interest)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    if (interest->ready)
+    {
+        return;
+    }
+
+    interest->ready = true;
+    interest->prev_ready = _ready_tail;
+    interest->next_ready = nullptr;
+
+    if (_ready_tail)
+    {
+        _ready_tail->next_ready = interest;
+    }
+    else
+    {
+        _ready_head = interest;
+    }
+
+    _ready_tail = interest;
+}
+
+void FsPoller::remove_ready(PollerInterest *interest)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    if (!interest->ready)
+    {
+        return;
+    }
+
+    if (interest->prev_ready)
+    {
+        interest->prev_ready->next_ready = interest->next_ready;
+    }
+    else
+    {
+        _ready_head = interest->next_ready;
+    }
+
+    if (interest->next_ready)
+    {
+        interest->next_ready->prev_ready = interest->prev_ready;
+    }
+    else
+    {
+        _ready_tail = interest->prev_ready;
+    }
+
+    interest->ready = false;
+    interest->prev_ready = nullptr;
+    interest->next_ready = nullptr;
+}
+
+void FsPoller::wake_up(void *target)
+{
+    auto interest = reinterpret_cast<PollerInterest *>(target);
+    auto poller = interest->poller;
+
+    poller->push_ready(interest);
+    poller->wait_queue().wake_up();
+}
+
+Result FsPoller::add(IOCallPollerArgs &args)
+{
+    auto handle = scheduler_running()->handles().find(args.handle);
+
+    if (!handle)
+    {
+        return ERR_BAD_HANDLE;
+    }
+
+    // Pollers waking each others up could go around in circles.
+    if (handle->node()->type() == FILE_TYPE_POLLER)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    auto interest = interest_by_handle(args.handle);
+
+    // The handle was closed, and its index reused for another node.
+    if (interest && interest->node.naked() != handle->node().naked())
+    {
+        destroy(interest);
+        interest = nullptr;
+    }
+
+    if (!interest)
+    {
+        interest = new PollerInterest{};
+
+        interest->poller = this;
+        interest->handle = args.handle;
+        interest->node = handle->node();
+
+        while (_interests.count() <= (size_t)args.handle)
+        {
+            _interests.push_back(nullptr);
+        }
+
+        _interests[args.handle] = interest;
+
+        InterruptsRetainer retainer;
+        interest->node->wait_queue().add(interest->entry, wake_up, interest);
+    }
+
+    interest->events = args.events;
+    interest->edge_triggered = args.edge_triggered;
+
+    // The node might be ready already, the next read will tell.
+    InterruptsRetainer retainer;
+    push_ready(interest);
+    wait_queue().wake_up();
+
+    return SUCCESS;
+}
+
+Result FsPoller::remove(IOCallPollerArgs &args)
+{
+    auto interest = interest_by_handle(args.handle);
+
+    if (!interest)
+    {
+        return ERR_BAD_HANDLE;
+    }
+
+    destroy(interest);
+
+    return SUCCESS;
+}
+
+void FsPoller::destroy(PollerInterest *interest)
+{
+    {
+        InterruptsRetainer retainer;
+
+        remove_ready(interest);
+        interest->node->wait_queue().remove(interest->entry);
+    }
+
+    _interests[interest->handle] = nullptr;
+
+    delete interest;
+}
+
+Result FsPoller::call(FsHandle &handle, IOCall request, void *args)
+{
+    __unused(handle);
+
+    switch (request)
+    {
+    case IOCALL_POLLER_ADD:
+        return add(*(IOCallPollerArgs *)args);
+
+    case IOCALL_POLLER_REMOVE:
+        return remove(*(IOCallPollerArgs *)args);
+
+    default:
+        return ERR_INAPPROPRIATE_CALL_FOR_DEVICE;
+    }
+}
+
+bool FsPoller::can_read(FsHandle &)
+{
+    return __atomic_load_n(&_ready_head, __ATOMIC_SEQ_CST) != nullptr;
+}
+
+ResultOr<size_t> FsPoller::read(FsHandle &, void *buffer, size_t size)
+{
+    auto polls = reinterpret_cast<HandlePoll *>(buffer);
+    size_t count = size / sizeof(HandlePoll);
+    size_t reported = 0;
+
+    // Taken out of the list first, so nodes can push them back while they are looked at.
+    Vector<PollerInterest *> candidates;
+
+    {
+        InterruptsRetainer retainer;
+
+        while (_ready_head)
+        {
+            candidates.push_back(_ready_head);
+            remove_ready(_ready_head);
+        }
+    }
+
+    auto &handles = scheduler_running()->handles();
+
+    Vector<PollerInterest *> still_ready;
+    Vector<PollerInterest *> closed;
+
+    for (size_t i = 0; i < candidates.count(); i++)
+    {
+        auto interest = candidates[i];
+        auto handle = handles.find(interest->handle);
+
+        if (!handle || handle->node().naked() != interest->node.naked())
+        {
+            closed.push_back(interest);
+            continue;
+        }
+
+        if (reported == count)
+        {
+            still_ready.push_back(interest);
+            continue;
+        }
+
+        PollEvent result = handle->poll(interest->events);
+
+        if (result == 0)
+        {
+            continue;
+        }
+
+        polls[reported] = {interest->handle, interest->events, result};
+        reported++;
+
+        // Level triggered interests are looked at again until they are not ready anymore.
+        if (!interest->edge_triggered)
+        {
+            still_ready.push_back(interest);
+        }
+    }
+
+    {
+        InterruptsRetainer retainer;
+
+        for (size_t i = 0; i < still_ready.count(); i++)
+        {
+            push_ready(still_ready[i]);
+        }
+    }
+
+    // Interests go away with their handle.
+    for (size_t i = 0; i < closed.count(); i++)
+    {
+        destroy(closed[i]);
+    }
+
+    return reported * sizeof(HandlePoll);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <libutils/Vector.h>
+
+#include "kernel/node/Node.h"
+
+struct PollerInterest;
+
+// Set of handles of a task and the events it waits for on them. Nodes push
+// their interests to the ready list when their state changes, so reading
+// the poller only looks at those instead of every handle in the set.
+// Reads return a HandlePoll for each handle ready.
+class FsPoller : public FsNode
+{
+private:
+    // Indexed by handle, so changing the set doesn't depend on its size.
+    Vector<PollerInterest *> _interests;
+
+    // Interests whose node changed since they were last looked at,
+    // only touched with interrupts retained, nodes wake us from anywhere.
+    PollerInterest *_ready_head = nullptr;
+    PollerInterest *_ready_tail = nullptr;
+
+    PollerInterest *interest_by_handle(int handle);
+
+    void push_ready(PollerInterest *interest);
+
+    void remove_ready(PollerInterest *interest);
+
+    Result add(IOCallPollerArgs &args);
+
+    Result remove(IOCallPollerArgs &args);
+
+    void destroy(PollerInterest *interest);
+
+public:
+    FsPoller();
+
+    ~FsPoller() override;
+
+    // Called from the wait queue of the node of an interest.
+    static void wake_up(void *target);
+
+    Result call(FsHandle &handle, IOCall request, void *args) override;
+
+    // There might be nothing left to report once read, when
+    // handles were only woken up without becoming ready.
+    bool can_read(FsHandle &handle) override;
+
+    ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size) override;
+};
@@ -17,7 +17,8 @@ FsProcessInfo::FsProcessInfo() : FsNode(FILE_TYPE_DEVICE)
 
 static Iteration serialize_task(json::Value::Array *list, Task *task)
 {
-    if (task->id == 0)
+    // Skip the idle tasks.
+    if (task->state() == TASK_STATE_HANG)
         return Iteration::CONTINUE;
 
     json::Value::Object task_object{};
@@ -27,7 +28,11 @@ static Iteration serialize_task(json::Value::Array *list, Task *task)
     task_object["state"] = task_state_string(task->state());
     task_object["directory"] = "";
     task_object["cpu"] = scheduler_get_usage(task->id);
-    task_object["ram"] = (int)task_memory_usage(task);
+    task_object["runtime"] = (int)task->runtime_ticks;
+    task_object["priority"] = task->priority;
+    task_object["ram"] = (int)task_memory_resident(task);
+    task_object["demand-faults"] = (int)task->demand_faults;
+    task_object["cow-faults"] = (int)task->cow_faults;
     task_object["user"] = task->user;
 
     list->push_back(move(task_object));
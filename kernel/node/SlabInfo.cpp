@@ -0,0 +1,68 @@
+#include <libsystem/Logger.h>
+#include <libsystem/Result.h>
+#include <libsystem/math/MinMax.h>
+#include <libutils/json/Json.h>
+#include <string.h>
+
+#include "kernel/memory/Slab.h"
+#include "kernel/node/Handle.h"
+#include "kernel/node/SlabInfo.h"
+#include "kernel/scheduling/Scheduler.h"
+
+FsSlabInfo::FsSlabInfo() : FsNode(FILE_TYPE_DEVICE)
+{
+}
+
+static Iteration serialize_slab_cache(json::Value::Array *list, SlabCache *cache)
+{
+    json::Value::Object cache_object{};
+
+    cache_object["name"] = cache->name;
+    cache_object["object-size"] = (int)cache->object_size;
+    cache_object["used"] = (int)cache->used;
+    cache_object["pages"] = (int)cache->pages;
+    cache_object["hits"] = (int)cache->hits;
+    cache_object["misses"] = (int)cache->misses;
+
+    list->push_back(move(cache_object));
+
+    return Iteration::CONTINUE;
+}
+
+Result FsSlabInfo::open(FsHandle &handle)
+{
+    json::Value::Array list{};
+
+    slab_iterate(&list, (SlabCacheIterateCallback)serialize_slab_cache);
+
+    Prettifier pretty{};
+    json::prettify(pretty, list);
+
+    handle.attached = pretty.finalize().storage().give_ref();
+    handle.attached_size = reinterpret_cast<StringStorage *>(handle.attached)->size();
+
+    return SUCCESS;
+}
+
+void FsSlabInfo::close(FsHandle &handle)
+{
+    deref_if_not_null(reinterpret_cast<StringStorage *>(handle.attached));
+}
+
+ResultOr<size_t> FsSlabInfo::read(FsHandle &handle, void *buffer, size_t size)
+{
+    size_t read = 0;
+
+    if (handle.offset() <= handle.attached_size)
+    {
+        read = MIN(handle.attached_size - handle.offset(), size);
+        memcpy(buffer, reinterpret_cast<StringStorage *>(handle.attached)->cstring() + handle.offset(), read);
+    }
+
+    return read;
+}
+
+void slab_info_initialize()
+{
+    scheduler_running()->domain().link(Path::parse("/System/slabs"), make<FsSlabInfo>());
+}
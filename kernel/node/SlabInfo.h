@@ -0,0 +1,18 @@
+#pragma once
+
+#include "kernel/node/Node.h"
+
+class FsSlabInfo : public FsNode
+{
+private:
+public:
+    FsSlabInfo();
+
+    Result open(FsHandle &handle) override;
+
+    void close(FsHandle &handle) override;
+
+    ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size) override;
+};
+
+void slab_info_initialize();
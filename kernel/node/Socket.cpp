@@ -3,13 +3,13 @@
 #include "kernel/node/Connection.h"
 #include "kernel/node/Socket.h"
 
-FsSocket::FsSocket() : FsNode(FILE_TYPE_SOCKET)
+FsSocket::FsSocket(bool packets) : FsNode(FILE_TYPE_SOCKET), _packets(packets)
 {
 }
 
 ResultOr<RefPtr<FsNode>> FsSocket::connect()
 {
-    auto connection = make<FsConnection>();
+    auto connection = make<FsConnection>(_packets);
     _pending.push_back(connection);
     return {connection};
 }
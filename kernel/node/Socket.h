@@ -9,8 +9,11 @@ struct FsSocket : public FsNode
 private:
     Vector<RefPtr<FsNode>> _pending{};
 
+    // Connections keep the boundaries of messages, see OPEN_SEQPACKET.
+    bool _packets;
+
 public:
-    FsSocket();
+    FsSocket(bool packets);
 
     ResultOr<RefPtr<FsNode>> connect() override;
 
@@ -0,0 +1,79 @@
+#include <abi/Paths.h>
+#include <libsystem/Result.h>
+#include <libsystem/math/MinMax.h>
+#include <string.h>
+
+#include "kernel/node/Handle.h"
+#include "kernel/node/TraceInfo.h"
+#include "kernel/scheduling/Scheduler.h"
+#include "kernel/system/Trace.h"
+
+FsTraceInfo::FsTraceInfo() : FsNode(FILE_TYPE_DEVICE)
+{
+}
+
+Result FsTraceInfo::open(FsHandle &handle)
+{
+    // Each handle reads the records there were when it was opened.
+    TraceRecord *records = nullptr;
+    size_t count = trace_snapshot(&records);
+
+    handle.attached = records;
+    handle.attached_size = count * sizeof(TraceRecord);
+
+    return SUCCESS;
+}
+
+void FsTraceInfo::close(FsHandle &handle)
+{
+    delete[] reinterpret_cast<TraceRecord *>(handle.attached);
+}
+
+Result FsTraceInfo::call(FsHandle &handle, IOCall request, void *args)
+{
+    __unused(handle);
+
+    switch (request)
+    {
+    case IOCALL_TRACE_START:
+        return trace_start();
+
+    case IOCALL_TRACE_STOP:
+        trace_stop();
+        return SUCCESS;
+
+    case IOCALL_TRACE_GET_STATE:
+    {
+        auto state = reinterpret_cast<IOCallTraceStateArgs *>(args);
+
+        state->running = trace_running();
+        state->size = trace_size();
+
+        return SUCCESS;
+    }
+
+    case IOCALL_TRACE_SET_SIZE:
+        return trace_resize(reinterpret_cast<IOCallTraceStateArgs *>(args)->size);
+
+    default:
+        return ERR_INAPPROPRIATE_CALL_FOR_DEVICE;
+    }
+}
+
+ResultOr<size_t> FsTraceInfo::read(FsHandle &handle, void *buffer, size_t size)
+{
+    size_t read = 0;
+
+    if (handle.offset() <= handle.attached_size)
+    {
+        read = MIN(handle.attached_size - handle.offset(), size);
+        memcpy(buffer, reinterpret_cast<char *>(handle.attached) + handle.offset(), read);
+    }
+
+    return read;
+}
+
+void trace_info_initialize()
+{
+    scheduler_running()->domain().link(Path::parse(TRACE_PATH), make<FsTraceInfo>());
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "kernel/node/Node.h"
+
+class FsTraceInfo : public FsNode
+{
+private:
+public:
+    FsTraceInfo();
+
+    Result open(FsHandle &handle) override;
+
+    void close(FsHandle &handle) override;
+
+    Result call(FsHandle &handle, IOCall request, void *args) override;
+
+    ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size) override;
+};
+
+void trace_info_initialize();
@@ -7,6 +7,7 @@
 #include <libsystem/io/Stream.h>
 #include <libsystem/io/Stream_internal.h>
 #include <libsystem/system/System.h>
+#include <libsystem/utils/List.h>
 
 #include "archs/Architectures.h"
 #include "archs/VirtualMemory.h"
@@ -14,6 +15,7 @@
 #include "kernel/graphics/EarlyConsole.h"
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/memory/Memory.h"
+#include "kernel/memory/Slab.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
 #include "kernel/tasking/Handles.h"
@@ -60,19 +62,27 @@ TimeStamp __plug_system_get_time()
 
 Tick __plug_system_get_ticks()
 {
-    return system_get_ticks();
+    return system_get_tick();
+}
+
+uint64_t __plug_system_get_clock()
+{
+    return system_get_nanoseconds();
 }
 
 /* --- Memory allocator plugs ----------------------------------------------- */
 
+// Taken before the memory lock, see kernel/memory/Memory.h
+static Spinlock _heap_lock{"heap"};
+
 void __plug_memory_lock()
 {
-    interrupts_retain();
+    _heap_lock.acquire();
 }
 
 void __plug_memory_unlock()
 {
-    interrupts_release();
+    _heap_lock.release();
 }
 
 void *__plug_memory_alloc(size_t size)
@@ -87,16 +97,35 @@ void __plug_memory_free(void *address, size_t size)
     memory_free(arch_kernel_address_space(), (MemoryRange){(uintptr_t)address, size});
 }
 
+/* --- List plugs ----------------------------------------------------------- */
+
+static SlabCache _list_item_cache{"ListItem", sizeof(ListItem)};
+
+ListItem *__plug_list_item_alloc()
+{
+    auto item = reinterpret_cast<ListItem *>(slab_alloc(&_list_item_cache));
+    assert(item);
+    return item;
+}
+
+void __plug_list_item_free(ListItem *item)
+{
+    slab_free(&_list_item_cache, item);
+}
+
 /* --- Logger plugs --------------------------------------------------------- */
 
+// Taken last, the logger can be used while holding any other lock.
+static Spinlock _logger_lock{"logger"};
+
 void __plug_logger_lock()
 {
-    interrupts_retain();
+    _logger_lock.acquire();
 }
 
 void __plug_logger_unlock()
 {
-    interrupts_release();
+    _logger_lock.release();
 }
 
 void __no_return __plug_logger_fatal()
@@ -8,6 +8,11 @@ bool BlockerAccept::can_unblock(Task &)
     return !_node->is_acquire() && _node->can_accept();
 }
 
+void BlockerAccept::enqueue(Task &task)
+{
+    wait_on(_node->wait_queue(), task);
+}
+
 void BlockerAccept::on_unblock(Task &task)
 {
     _node->acquire(task.id);
@@ -20,6 +25,11 @@ bool BlockerConnect::can_unblock(Task &)
     return _connection->is_accepted();
 }
 
+void BlockerConnect::enqueue(Task &task)
+{
+    wait_on(_connection->wait_queue(), task);
+}
+
 /* --- BlockerRead ---------------------------------------------------------- */
 
 bool BlockerRead::can_unblock(Task &)
@@ -27,6 +37,11 @@ bool BlockerRead::can_unblock(Task &)
     return !_handle.node()->is_acquire() && _handle.node()->can_read(_handle);
 }
 
+void BlockerRead::enqueue(Task &task)
+{
+    wait_on(_handle.node()->wait_queue(), task);
+}
+
 void BlockerRead::on_unblock(Task &task)
 {
     _handle.node()->acquire(task.id);
@@ -53,6 +68,25 @@ bool BlockerSelect::can_unblock(Task &)
     return should_be_unblock;
 }
 
+void BlockerSelect::enqueue(Task &task)
+{
+    _wait_queue_entries = new WaitQueueEntry[_handles.count()];
+
+    for (size_t i = 0; i < _handles.count(); i++)
+    {
+        _handles[i].handle->node()->wait_queue().add(_wait_queue_entries[i], task);
+    }
+}
+
+void BlockerSelect::dequeue(Task &)
+{
+    for (size_t i = 0; i < _handles.count(); i++)
+    {
+        auto &entry = _wait_queue_entries[i];
+        entry.queue->remove(entry);
+    }
+}
+
 /* --- BlockerWait ---------------------------------------------------------- */
 
 bool BlockerWait::can_unblock(Task &)
@@ -60,6 +94,11 @@ bool BlockerWait::can_unblock(Task &)
     return _task->state() == TASK_STATE_CANCELED;
 }
 
+void BlockerWait::enqueue(Task &task)
+{
+    wait_on(_task->exit_wait_queue(), task);
+}
+
 void BlockerWait::on_unblock(Task &)
 {
     *_exit_value = _task->exit_value;
@@ -73,6 +112,11 @@ bool BlockerWrite::can_unblock(Task &)
            _handle.node()->can_write(_handle);
 }
 
+void BlockerWrite::enqueue(Task &task)
+{
+    wait_on(_handle.node()->wait_queue(), task);
+}
+
 void BlockerWrite::on_unblock(Task &task)
 {
     _handle.node()->acquire(task.id);
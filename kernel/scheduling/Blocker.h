@@ -5,7 +5,9 @@
 #include <libutils/Vector.h>
 
 #include "kernel/node/Handle.h"
+#include "kernel/scheduling/WaitQueue.h"
 #include "kernel/system/System.h"
+#include "kernel/system/Timer.h"
 
 struct Task;
 
@@ -16,6 +18,15 @@ private:
     TimeStamp _timeout = -1;
     bool _interrupted = false;
 
+    WaitQueueEntry _wait_queue_entry{};
+    Timer _timer{};
+
+protected:
+    void wait_on(WaitQueue &queue, Task &task)
+    {
+        queue.add(_wait_queue_entry, task);
+    }
+
 public:
     Result result() { return _result; }
 
@@ -23,6 +34,12 @@ public:
 
     virtual ~Blocker() {}
 
+    bool has_deadline() { return _timeout != (Timeout)-1; }
+
+    TimeStamp deadline() { return _timeout; }
+
+    Timer *timer() { return &_timer; }
+
     void unblock(Task &task)
     {
         _result = SUCCESS;
@@ -54,6 +71,18 @@ public:
 
     virtual bool can_unblock(Task &) { return true; }
 
+    // Put the task on the wait queues of the objects it is waiting for.
+    virtual void enqueue(Task &) {}
+
+    // Take the task off the wait queues it was put on by enqueue().
+    virtual void dequeue(Task &)
+    {
+        if (_wait_queue_entry.queue)
+        {
+            _wait_queue_entry.queue->remove(_wait_queue_entry);
+        }
+    }
+
     virtual void on_unblock(Task &) {}
 
     virtual void on_timeout(Task &) {}
@@ -73,6 +102,8 @@ public:
 
     bool can_unblock(Task &task) override;
 
+    void enqueue(Task &task) override;
+
     void on_unblock(Task &task) override;
 };
 
@@ -88,6 +119,8 @@ public:
     }
 
     bool can_unblock(Task &task) override;
+
+    void enqueue(Task &task) override;
 };
 
 class BlockerRead : public Blocker
@@ -103,6 +136,8 @@ public:
 
     bool can_unblock(Task &task) override;
 
+    void enqueue(Task &task) override;
+
     void on_unblock(Task &task) override;
 };
 
@@ -118,6 +153,7 @@ class BlockerSelect : public Blocker
 {
 private:
     Vector<Selected> &_handles;
+    WaitQueueEntry *_wait_queue_entries = nullptr;
 
 public:
     BlockerSelect(Vector<Selected> &handles)
@@ -125,7 +161,16 @@ public:
     {
     }
 
+    ~BlockerSelect()
+    {
+        delete[] _wait_queue_entries;
+    }
+
     bool can_unblock(Task &task) override;
+
+    void enqueue(Task &task) override;
+
+    void dequeue(Task &task) override;
 };
 
 class BlockerTime : public Blocker
@@ -150,6 +195,8 @@ public:
 
     bool can_unblock(Task &task) override;
 
+    void enqueue(Task &task) override;
+
     void on_unblock(Task &task) override;
 };
 
@@ -166,5 +213,7 @@ public:
 
     bool can_unblock(Task &task) override;
 
+    void enqueue(Task &task) override;
+
     void on_unblock(Task &task) override;
 };
@@ -1,82 +1,265 @@
-
 #include "archs/Architectures.h"
 #include "archs/VirtualMemory.h"
 
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/scheduling/Scheduler.h"
+#include "kernel/system/CPU.h"
+#include "kernel/system/Spinlock.h"
 #include "kernel/system/System.h"
+#include "kernel/system/Trace.h"
+
+// Quantum in ticks of each priority level, tasks consuming their whole
+// quantum are moved one level down, lower levels get longer quantums.
+static const Tick scheduler_quantum[SCHEDULER_PRIORITY_COUNT] = {5, 10, 20, 40};
+
+struct SchedulerQueue
+{
+    Spinlock lock{"scheduler-queue"};
+
+    Task *running = nullptr;
+    Task *idle = nullptr;
+    bool context_switch = false;
+
+    // Picked by the next schedule(), see scheduler_hand_off().
+    Task *hand_off = nullptr;
+
+    // Runnable tasks, one round-robin queue per priority level.
+    List *tasks[SCHEDULER_PRIORITY_COUNT] = {};
+    int count = 0;
 
-static bool scheduler_context_switch = false;
-static int scheduler_record[SCHEDULER_RECORD_COUNT] = {};
+    Tick last_boost = 0;
+    Tick last_tick = 0;
+    uint64_t last_cycles = 0;
+    uint64_t window_cycles = 0;
+};
 
-static Task *running = nullptr;
-static Task *idle = nullptr;
+// One run queue per processor, a task stays on the same processor
+// until another one with nothing to run steals it.
+static SchedulerQueue _queues[CPU_MAX_COUNT];
 
-static List *blocked_tasks;
-static List *running_tasks;
+static Tick scheduler_window_tick = 0;
+static uint64_t scheduler_usage_cycles = 0;
+
+static SchedulerQueue &scheduler_queue_this()
+{
+    return _queues[arch_cpu_current()];
+}
 
 void scheduler_initialize()
 {
-    blocked_tasks = list_create();
-    running_tasks = list_create();
+    for (int i = 0; i < CPU_MAX_COUNT; i++)
+    {
+        for (int j = 0; j < SCHEDULER_PRIORITY_COUNT; j++)
+        {
+            _queues[i].tasks[j] = list_create();
+        }
+    }
 }
 
 void scheduler_did_create_idle_task(Task *task)
 {
-    idle = task;
+    auto &queue = scheduler_queue_this();
+
+    task->cpu = arch_cpu_current();
+
+    queue.idle = task;
+    queue.last_cycles = arch_get_cycles();
+    queue.last_tick = system_get_tick();
 }
 
 void scheduler_did_create_running_task(Task *task)
 {
-    running = task;
+    scheduler_queue_this().running = task;
 }
 
-void scheduler_did_change_task_state(Task *task, TaskState oldstate, TaskState newstate)
+static int scheduler_least_loaded_cpu()
 {
-    ASSERT_INTERRUPTS_RETAINED();
+    int result = 0;
 
-    if (oldstate != newstate)
+    for (int i = 1; i < cpu_count(); i++)
     {
-        if (oldstate == TASK_STATE_RUNNING)
+        if (cpu_by_id(i)->online && _queues[i].count < _queues[result].count)
         {
-            list_remove(running_tasks, task);
+            result = i;
         }
+    }
+
+    return result;
+}
+
+static bool scheduler_is_idle(SchedulerQueue &queue)
+{
+    return __atomic_load_n(&queue.running, __ATOMIC_ACQUIRE) == queue.idle;
+}
 
-        if (oldstate == TASK_STATE_BLOCKED)
+// Idle processors stop their timer, so they have to be told when
+// there is something new to run, or to steal from a busy processor.
+static void scheduler_wake_idle(int cpu)
+{
+    int self = arch_cpu_current();
+
+    if (scheduler_is_idle(_queues[cpu]))
+    {
+        if (cpu != self)
         {
-            list_remove(blocked_tasks, task);
+            arch_cpu_wake(cpu);
         }
 
-        if (newstate == TASK_STATE_BLOCKED)
+        return;
+    }
+
+    for (int i = 0; i < cpu_count(); i++)
+    {
+        if (i != self && i != cpu && cpu_by_id(i)->online && scheduler_is_idle(_queues[i]))
+        {
+            arch_cpu_wake(i);
+            return;
+        }
+    }
+}
+
+// Tasks waiting in our queue, or waiting behind the running task of another one.
+static bool scheduler_has_work(int self)
+{
+    for (int i = 0; i < cpu_count(); i++)
+    {
+        int count = __atomic_load_n(&_queues[i].count, __ATOMIC_RELAXED);
+
+        if ((i == self && count > 0) || count > 1)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void scheduler_idle()
+{
+    while (true)
+    {
+        arch_disable_interrupts();
+
+        if (scheduler_has_work(arch_cpu_current()))
+        {
+            arch_enable_interrupts();
+            scheduler_yield();
+        }
+        else
         {
-            list_push(blocked_tasks, task);
+            arch_idle();
+        }
+    }
+}
+
+static void scheduler_enqueue(SchedulerQueue &queue, Task *task)
+{
+    list_pushback(queue.tasks[task->priority], task);
+    queue.count++;
+}
+
+static void scheduler_dequeue(SchedulerQueue &queue, Task *task)
+{
+    list_remove(queue.tasks[task->priority], task);
+    queue.count--;
+}
+
+void scheduler_did_change_task_state(Task *task, TaskState oldstate, TaskState newstate)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    if (oldstate == newstate)
+    {
+        return;
+    }
+
+    if (oldstate == TASK_STATE_NONE && newstate == TASK_STATE_RUNNING)
+    {
+        task->cpu = scheduler_least_loaded_cpu();
+    }
+
+    {
+        auto &queue = _queues[task->cpu];
+        SpinlockHolder holder(queue.lock);
+
+        if (oldstate == TASK_STATE_RUNNING)
+        {
+            scheduler_dequeue(queue, task);
+        }
+
+        if (oldstate == TASK_STATE_BLOCKED && newstate == TASK_STATE_RUNNING)
+        {
+            // Tasks giving up the cpu before the end of their quantum are
+            // waiting on io or user input, move them up to keep them responsive.
+            if (task->fixed_priority >= 0)
+            {
+                task->priority = task->fixed_priority;
+            }
+            else if (task->priority > 0)
+            {
+                task->priority--;
+            }
+
+            task->slice_used = 0;
         }
 
         if (newstate == TASK_STATE_RUNNING)
         {
-            list_push(running_tasks, task);
+            scheduler_enqueue(queue, task);
         }
     }
+
+    if (newstate == TASK_STATE_RUNNING)
+    {
+        scheduler_wake_idle(task->cpu);
+    }
 }
 
 bool scheduler_is_context_switch()
 {
-    return scheduler_context_switch;
+    return scheduler_queue_this().context_switch;
 }
 
 Task *scheduler_running()
 {
-    return running;
+    // Don't get moved to another processor between reading
+    // the processor id and reading its running task.
+    bool interrupts = arch_interrupts_enabled();
+    arch_disable_interrupts();
+
+    Task *task = scheduler_queue_this().running;
+
+    if (interrupts)
+    {
+        arch_enable_interrupts();
+    }
+
+    return task;
 }
 
 int scheduler_running_id()
 {
-    if (running == nullptr)
+    Task *task = scheduler_running();
+
+    if (task == nullptr)
     {
         return -1;
     }
 
-    return running->id;
+    return task->id;
+}
+
+bool scheduler_is_on_cpu(Task *task)
+{
+    for (int i = 0; i < cpu_count(); i++)
+    {
+        if (__atomic_load_n(&_queues[i].running, __ATOMIC_ACQUIRE) == task)
+        {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 void scheduler_yield()
@@ -84,52 +267,318 @@ void scheduler_yield()
     arch_yield();
 }
 
+void scheduler_hand_off(Task *task)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    int self = arch_cpu_current();
+    auto &queue = _queues[self];
+
+    if (task->state() != TASK_STATE_RUNNING || scheduler_is_on_cpu(task))
+    {
+        return;
+    }
+
+    if (task->cpu != self)
+    {
+        auto &owner = _queues[task->cpu];
+
+        // Never wait on another run queue, like when stealing.
+        if (!owner.lock.try_acquire())
+        {
+            return;
+        }
+
+        if (owner.running == task)
+        {
+            owner.lock.release();
+            return;
+        }
+
+        scheduler_dequeue(owner, task);
+        owner.lock.release();
+
+        SpinlockHolder holder(queue.lock);
+
+        task->cpu = self;
+        scheduler_enqueue(queue, task);
+    }
+
+    queue.hand_off = task;
+}
+
 int scheduler_get_usage(int task_id)
 {
     InterruptsRetainer retainer;
 
-    int count = 0;
+    Task *task = task_by_id(task_id);
+
+    if (!task || scheduler_usage_cycles == 0)
+    {
+        return 0;
+    }
+
+    return (task->usage_cycles * 100) / scheduler_usage_cycles;
+}
+
+int scheduler_get_cpu_usage()
+{
+    InterruptsRetainer retainer;
+
+    if (scheduler_usage_cycles == 0)
+    {
+        return 0;
+    }
+
+    uint64_t idle_cycles = 0;
 
-    for (int i = 0; i < SCHEDULER_RECORD_COUNT; i++)
+    for (int i = 0; i < cpu_count(); i++)
     {
-        if (scheduler_record[i] == task_id)
+        if (_queues[i].idle)
         {
-            count++;
+            idle_cycles += _queues[i].idle->usage_cycles;
         }
     }
 
-    return (count * 100) / SCHEDULER_RECORD_COUNT;
+    return 100 - (idle_cycles * 100) / scheduler_usage_cycles;
 }
 
-static Iteration wakeup_task_if_unblocked(void *, Task *task)
+static Iteration scheduler_rollover_usage(void *, Task *task)
 {
-    task->try_unblock();
+    task->usage_cycles = task->window_cycles;
+    task->window_cycles = 0;
 
     return Iteration::CONTINUE;
 }
 
+static void scheduler_account(SchedulerQueue &queue, Task *task, Tick tick, uint64_t cycles)
+{
+    Tick elapsed_ticks = tick - queue.last_tick;
+    uint64_t elapsed_cycles = cycles - queue.last_cycles;
+
+    task->slice_used += elapsed_ticks;
+    task->runtime_ticks += elapsed_ticks;
+    task->runtime_cycles += elapsed_cycles;
+    task->window_cycles += elapsed_cycles;
+
+    queue.last_tick = tick;
+    queue.last_cycles = cycles;
+    queue.window_cycles += elapsed_cycles;
+
+    if (tick - scheduler_window_tick >= SCHEDULER_USAGE_WINDOW)
+    {
+        // Every processors run schedule() with the big kernel lock held,
+        // so it's safe to look at the other queues and tasks here.
+        task_iterate(nullptr, scheduler_rollover_usage);
+
+        scheduler_usage_cycles = 0;
+
+        for (int i = 0; i < cpu_count(); i++)
+        {
+            scheduler_usage_cycles += _queues[i].window_cycles;
+            _queues[i].window_cycles = 0;
+        }
+
+        scheduler_window_tick = tick;
+    }
+}
+
+static void scheduler_boost(SchedulerQueue &queue, Tick tick)
+{
+    // Move everyone back to the top level, so cpu bound tasks
+    // don't starve and tasks changing behavior get a second chance.
+    for (int i = 1; i < SCHEDULER_PRIORITY_COUNT; i++)
+    {
+        Task *task = nullptr;
+
+        for (int count = queue.tasks[i]->count(); count > 0 && list_pop(queue.tasks[i], (void **)&task); count--)
+        {
+            task->slice_used = 0;
+
+            // Pinned tasks stay where they are.
+            if (task->fixed_priority >= 0)
+            {
+                list_pushback(queue.tasks[i], task);
+            }
+            else
+            {
+                task->priority = 0;
+                list_pushback(queue.tasks[0], task);
+            }
+        }
+    }
+
+    queue.last_boost = tick;
+}
+
+static int scheduler_highest_priority(SchedulerQueue &queue)
+{
+    for (int i = 0; i < SCHEDULER_PRIORITY_COUNT; i++)
+    {
+        if (queue.tasks[i]->any())
+        {
+            return i;
+        }
+    }
+
+    return SCHEDULER_PRIORITY_COUNT;
+}
+
+static bool scheduler_should_preempt(SchedulerQueue &queue, Task *task)
+{
+    if (task == queue.idle || task->state() != TASK_STATE_RUNNING || queue.hand_off)
+    {
+        return true;
+    }
+
+    if (task->slice_used >= scheduler_quantum[task->priority])
+    {
+        scheduler_dequeue(queue, task);
+
+        if (task->fixed_priority < 0 && task->priority + 1 < SCHEDULER_PRIORITY_COUNT)
+        {
+            task->priority++;
+        }
+
+        task->slice_used = 0;
+        scheduler_enqueue(queue, task);
+
+        return true;
+    }
+
+    return scheduler_highest_priority(queue) < task->priority;
+}
+
+static Task *scheduler_take_hand_off(SchedulerQueue &queue)
+{
+    Task *task = queue.hand_off;
+    queue.hand_off = nullptr;
+
+    // The task might have blocked or exited since, so it's only
+    // compared with the ones still runnable on this processor.
+    for (int i = 0; task && i < SCHEDULER_PRIORITY_COUNT; i++)
+    {
+        if (list_contains(queue.tasks[i], task))
+        {
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+static Task *scheduler_steal_from(SchedulerQueue &victim)
+{
+    for (int i = 0; i < SCHEDULER_PRIORITY_COUNT; i++)
+    {
+        list_foreach(Task, task, victim.tasks[i])
+        {
+            if (task != victim.running)
+            {
+                scheduler_dequeue(victim, task);
+                return task;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+static Task *scheduler_steal(SchedulerQueue &queue)
+{
+    int self = arch_cpu_current();
+
+    for (int i = 1; i < cpu_count(); i++)
+    {
+        auto &victim = _queues[(self + i) % cpu_count()];
+
+        // Never wait on another run queue while holding ours.
+        if (victim.count == 0 || !victim.lock.try_acquire())
+        {
+            continue;
+        }
+
+        Task *task = scheduler_steal_from(victim);
+
+        victim.lock.release();
+
+        if (task)
+        {
+            task->cpu = self;
+            scheduler_enqueue(queue, task);
+
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
 uintptr_t schedule(uintptr_t current_stack_pointer)
 {
-    scheduler_context_switch = true;
+    auto &queue = scheduler_queue_this();
+    SpinlockHolder holder(queue.lock);
+
+    queue.context_switch = true;
+
+    Tick tick = system_get_tick();
+
+    scheduler_account(queue, queue.running, tick, arch_get_cycles());
+
+    if (tick - queue.last_boost >= SCHEDULER_BOOST_INTERVAL)
+    {
+        scheduler_boost(queue, tick);
+    }
+
+    if (!scheduler_should_preempt(queue, queue.running))
+    {
+        system_timer_rearm(false);
 
-    running->kernel_stack_pointer = current_stack_pointer;
-    arch_save_context(running);
+        queue.context_switch = false;
+        return current_stack_pointer;
+    }
 
-    scheduler_record[system_get_tick() % SCHEDULER_RECORD_COUNT] = running->id;
+    queue.running->kernel_stack_pointer = current_stack_pointer;
+    queue.running->interrupts_depth = interrupts_get_depth();
+    arch_save_context(queue.running);
+
+    Task *next = scheduler_take_hand_off(queue);
+
+    if (!next)
+    {
+        int priority = scheduler_highest_priority(queue);
 
-    list_iterate(blocked_tasks, nullptr, (ListIterationCallback)wakeup_task_if_unblocked);
+        if (priority < SCHEDULER_PRIORITY_COUNT)
+        {
+            next = (Task *)list_peek(queue.tasks[priority]);
+        }
+        else
+        {
+            // Take some work from a busy processor,
+            // or the idle task if there are no running tasks.
+            next = scheduler_steal(queue);
+
+            if (!next)
+            {
+                next = queue.idle;
+            }
+        }
+    }
 
-    // Get the next task
-    if (!list_peek_and_pushback(running_tasks, (void **)&running))
+    if (next != queue.running)
     {
-        // Or the idle task if there are no running tasks.
-        running = idle;
+        trace_record(TRACE_EVENT_SWITCH, queue.running->id, next->id, queue.running->state());
     }
 
-    arch_address_space_switch(running->address_space);
-    arch_load_context(running);
+    __atomic_store_n(&queue.running, next, __ATOMIC_RELEASE);
+
+    system_timer_rearm(next == queue.idle);
+
+    interrupts_set_depth(next->interrupts_depth);
+    arch_address_space_switch(next->current_address_space());
+    arch_load_context(next);
 
-    scheduler_context_switch = false;
+    queue.context_switch = false;
 
-    return running->kernel_stack_pointer;
+    return next->kernel_stack_pointer;
 }
@@ -2,7 +2,15 @@
 
 #include "kernel/tasking/Task.h"
 
-#define SCHEDULER_RECORD_COUNT 1000
+// Multi-level feedback queue: tasks start at priority 0 (the highest),
+// go down when they use their whole quantum and up when they wake up.
+#define SCHEDULER_PRIORITY_COUNT 4
+
+// Every tasks are moved back to the highest priority at this interval (in ticks).
+#define SCHEDULER_BOOST_INTERVAL 1000
+
+// Interval (in ticks) over which scheduler_get_usage() is computed.
+#define SCHEDULER_USAGE_WINDOW 1000
 
 void scheduler_initialize();
 
@@ -10,16 +18,30 @@ void scheduler_did_create_idle_task(Task *task);
 
 void scheduler_did_create_running_task(Task *task);
 
+// Body of the idle tasks, sleep until there is something to run.
+void __no_return scheduler_idle();
+
 void scheduler_did_change_task_state(Task *task, TaskState oldstate, TaskState newstate);
 
 bool scheduler_is_context_switch();
 
+// Share of the time of every processors spent running this task, in percent.
 int scheduler_get_usage(int task_id);
 
+// Share of the time of every processors not spent idling, in percent.
+int scheduler_get_cpu_usage();
+
 Task *scheduler_running();
 
 int scheduler_running_id();
 
+// Is the task running on any processor right now.
+bool scheduler_is_on_cpu(Task *task);
+
 void scheduler_yield();
 
+// Run `task` next on this processor instead of what the priorities would
+// pick, for a task about to wait on it. Does nothing if it's not runnable.
+void scheduler_hand_off(Task *task);
+
 uintptr_t schedule(uintptr_t current_stack_pointer);
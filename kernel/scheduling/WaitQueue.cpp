@@ -0,0 +1,102 @@
+#include <assert.h>
+
+#include "kernel/interrupts/Interupts.h"
+#include "kernel/scheduling/WaitQueue.h"
+#include "kernel/tasking/Task.h"
+
+WaitQueue::~WaitQueue()
+{
+    assert(_head == nullptr);
+}
+
+void WaitQueue::add(WaitQueueEntry &entry, Task &task)
+{
+    entry.task = &task;
+    entry.callback = nullptr;
+
+    link(entry);
+}
+
+void WaitQueue::add(WaitQueueEntry &entry, WaitQueueCallback callback, void *target)
+{
+    entry.task = nullptr;
+    entry.callback = callback;
+    entry.target = target;
+
+    link(entry);
+}
+
+void WaitQueue::link(WaitQueueEntry &entry)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+    assert(entry.queue == nullptr);
+
+    entry.queue = this;
+    entry.prev = _tail;
+    entry.next = nullptr;
+
+    if (_tail)
+    {
+        _tail->next = &entry;
+    }
+    else
+    {
+        _head = &entry;
+    }
+
+    _tail = &entry;
+}
+
+void WaitQueue::remove(WaitQueueEntry &entry)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+    assert(entry.queue == this);
+
+    if (entry.prev)
+    {
+        entry.prev->next = entry.next;
+    }
+    else
+    {
+        _head = entry.next;
+    }
+
+    if (entry.next)
+    {
+        entry.next->prev = entry.prev;
+    }
+    else
+    {
+        _tail = entry.prev;
+    }
+
+    entry.queue = nullptr;
+    entry.prev = nullptr;
+    entry.next = nullptr;
+}
+
+void WaitQueue::wake_up()
+{
+    InterruptsRetainer retainer;
+
+    WaitQueueEntry *entry = _head;
+
+    while (entry)
+    {
+        if (entry->callback)
+        {
+            entry->callback(entry->target);
+            entry = entry->next;
+        }
+        // A task leaving its blocked state removes all of its entries,
+        // including ones further down this queue, so start over from the head.
+        else if (entry->task->try_unblock())
+        {
+            entry = _head;
+        }
+        else
+        {
+            entry = entry->next;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+struct Task;
+class WaitQueue;
+
+typedef void (*WaitQueueCallback)(void *target);
+
+// Link between a blocked task and a wait queue, it is owned by the blocker
+// so a task can wait on multiple queues without allocating anything.
+struct WaitQueueEntry
+{
+    Task *task = nullptr;
+    WaitQueue *queue = nullptr;
+
+    // Called instead of unblocking a task, for the kernel objects which
+    // follow the state of others. It must not remove any entry of the queue.
+    WaitQueueCallback callback = nullptr;
+    void *target = nullptr;
+
+    WaitQueueEntry *prev = nullptr;
+    WaitQueueEntry *next = nullptr;
+};
+
+// List of the tasks blocked on a kernel object (a node, a task, an interrupt source...).
+// Whoever changes the state of the object calls wake_up() to give the waiting
+// tasks a chance to unblock, so the scheduler never has to poll them.
+class WaitQueue
+{
+private:
+    WaitQueueEntry *_head = nullptr;
+    WaitQueueEntry *_tail = nullptr;
+
+    __noncopyable(WaitQueue);
+    __nonmovable(WaitQueue);
+
+    void link(WaitQueueEntry &entry);
+
+public:
+    bool empty() { return _head == nullptr; }
+
+    constexpr WaitQueue() {}
+
+    ~WaitQueue();
+
+    void add(WaitQueueEntry &entry, Task &task);
+
+    void add(WaitQueueEntry &entry, WaitQueueCallback callback, void *target);
+
+    void remove(WaitQueueEntry &entry);
+
+    void wake_up();
+};
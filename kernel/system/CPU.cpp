@@ -0,0 +1,76 @@
+#include "archs/Architectures.h"
+
+#include "kernel/system/CPU.h"
+
+// The boot processor is always cpu 0, it starts outside of the
+// interrupts holding and owns the big kernel lock.
+static CPU _cpus[CPU_MAX_COUNT] = {
+    {
+        .id = 0,
+        .arch_id = 0,
+        .online = true,
+        .interrupts_holded = false,
+        .interrupts_depth = 0,
+    },
+};
+
+static int _cpu_count = 1;
+
+CPU *cpu_this()
+{
+    return &_cpus[arch_cpu_current()];
+}
+
+CPU *cpu_by_id(int id)
+{
+    if (id < 0 || id >= _cpu_count)
+    {
+        return nullptr;
+    }
+
+    return &_cpus[id];
+}
+
+int cpu_count()
+{
+    return _cpu_count;
+}
+
+int cpu_online_count()
+{
+    int count = 0;
+
+    for (int i = 0; i < _cpu_count; i++)
+    {
+        if (__atomic_load_n(&_cpus[i].online, __ATOMIC_ACQUIRE))
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+CPU *cpu_register(int arch_id)
+{
+    if (_cpu_count == CPU_MAX_COUNT)
+    {
+        return nullptr;
+    }
+
+    CPU *cpu = &_cpus[_cpu_count];
+
+    // Application processors start as if they were running a task, so they
+    // take the big kernel lock by disabling the interrupts holding.
+    *cpu = {
+        .id = _cpu_count,
+        .arch_id = arch_id,
+        .online = false,
+        .interrupts_holded = true,
+        .interrupts_depth = 0,
+    };
+
+    _cpu_count++;
+
+    return cpu;
+}
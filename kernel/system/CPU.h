@@ -0,0 +1,32 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+#define CPU_MAX_COUNT 16
+
+struct CPU
+{
+    int id;
+    int arch_id; // The local APIC id on x86.
+    bool online;
+
+    // Interrupts holding and retained depth of this processor,
+    // see kernel/interrupts/Interupts.cpp
+    bool interrupts_holded;
+    int interrupts_depth;
+};
+
+// The processor running this code, interrupts should be disabled
+// or the running task may be moved to another processor in between.
+CPU *cpu_this();
+
+CPU *cpu_by_id(int id);
+
+// Number of processors known to the system, online or not.
+int cpu_count();
+
+int cpu_online_count();
+
+// Called by the arch code for each application processor found,
+// returns nullptr if there are already CPU_MAX_COUNT of them.
+CPU *cpu_register(int arch_id);
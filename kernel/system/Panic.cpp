@@ -51,8 +51,7 @@ static bool nested_panic = false;
 
 void system_panic_internal(__SOURCE_LOCATION__ location, void *stackframe, const char *message, ...)
 {
-    interrupts_retain();
-    interrupts_disable_holding();
+    interrupts_panic();
 
     font_set_bg(0xff333333);
 
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <assert.h>
+#include <libsystem/Common.h>
+
+#include "archs/Architectures.h"
+
+// Spinlocks protect the data shared by every processors outside of the
+// big kernel lock (memory manager, heap, logger, run queues...).
+// Interrupts are disabled on the local processor while one is held and
+// a processor can acquire the same spinlock again without deadlocking.
+//
+// Never retain interrupts while holding a spinlock: the big kernel lock
+// is always taken before them.
+class Spinlock
+{
+private:
+    static constexpr int NO_OWNER = -1;
+
+    int _owner = NO_OWNER;
+    int _depth = 0;
+    bool _interrupts = false;
+    const char *_name = "spinlock-not-initialized";
+
+    __noncopyable(Spinlock);
+    __nonmovable(Spinlock);
+
+public:
+    const char *name() const { return _name; }
+
+    constexpr Spinlock(const char *name) : _name{name}
+    {
+    }
+
+    bool held() const
+    {
+        return __atomic_load_n(&_owner, __ATOMIC_ACQUIRE) == arch_cpu_current();
+    }
+
+    void acquire()
+    {
+        bool interrupts = arch_interrupts_enabled();
+        arch_disable_interrupts();
+
+        int cpu = arch_cpu_current();
+
+        if (__atomic_load_n(&_owner, __ATOMIC_ACQUIRE) == cpu)
+        {
+            _depth++;
+            return;
+        }
+
+        int expected = NO_OWNER;
+
+        while (!__atomic_compare_exchange_n(&_owner, &expected, cpu, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            expected = NO_OWNER;
+            asm("pause");
+        }
+
+        _depth = 1;
+        _interrupts = interrupts;
+    }
+
+    bool try_acquire()
+    {
+        bool interrupts = arch_interrupts_enabled();
+        arch_disable_interrupts();
+
+        int cpu = arch_cpu_current();
+
+        if (__atomic_load_n(&_owner, __ATOMIC_ACQUIRE) == cpu)
+        {
+            _depth++;
+            return true;
+        }
+
+        int expected = NO_OWNER;
+
+        if (!__atomic_compare_exchange_n(&_owner, &expected, cpu, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            if (interrupts)
+            {
+                arch_enable_interrupts();
+            }
+
+            return false;
+        }
+
+        _depth = 1;
+        _interrupts = interrupts;
+
+        return true;
+    }
+
+    void release()
+    {
+        assert(held());
+
+        _depth--;
+
+        if (_depth == 0)
+        {
+            bool interrupts = _interrupts;
+
+            __atomic_store_n(&_owner, NO_OWNER, __ATOMIC_RELEASE);
+
+            if (interrupts)
+            {
+                arch_enable_interrupts();
+            }
+        }
+    }
+};
+
+class SpinlockHolder
+{
+private:
+    Spinlock &_spinlock;
+
+    __noncopyable(SpinlockHolder);
+    __nonmovable(SpinlockHolder);
+
+public:
+    SpinlockHolder(Spinlock &spinlock) : _spinlock(spinlock)
+    {
+        _spinlock.acquire();
+    }
+
+    ~SpinlockHolder()
+    {
+        _spinlock.release();
+    }
+};
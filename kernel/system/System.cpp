@@ -2,8 +2,10 @@
 #include <libsystem/Logger.h>
 
 #include "archs/Architectures.h"
+#include "kernel/interrupts/Interupts.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
+#include "kernel/system/Timer.h"
 
 void system_hang()
 {
@@ -25,21 +27,78 @@ void system_stop()
     }
 }
 
+/* --- Ticks ---------------------------------------------------------------- */
+
+// Timer interrupts are counted until the clock is calibrated, ticks are
+// derived from the clock after that, so they keep going on processors
+// which stopped their timer while idle.
 static uint32_t _system_tick;
 
+static bool _system_clock = false;
+static uint64_t _system_clock_base = 0;
+
 void system_tick()
 {
-    if (_system_tick + 1 < _system_tick)
+    if (!_system_clock)
     {
-        system_panic("System tick overflow!");
+        if (_system_tick + 1 < _system_tick)
+        {
+            system_panic("System tick overflow!");
+        }
+
+        _system_tick++;
     }
 
-    _system_tick++;
+    timer_tick(system_get_tick());
 }
 
 uint32_t system_get_tick()
 {
-    return _system_tick;
+    return system_get_nanoseconds() / NANOSECONDS_PER_TICK;
+}
+
+void system_clock_start()
+{
+    InterruptsRetainer retainer;
+
+    // Start where the tick counter is, so ticks never go backward.
+    _system_clock_base = arch_get_nanoseconds() - (uint64_t)_system_tick * NANOSECONDS_PER_TICK;
+    __atomic_store_n(&_system_clock, true, __ATOMIC_RELEASE);
+}
+
+uint64_t system_get_nanoseconds()
+{
+    if (!__atomic_load_n(&_system_clock, __ATOMIC_ACQUIRE))
+    {
+        return (uint64_t)_system_tick * NANOSECONDS_PER_TICK;
+    }
+
+    return arch_get_nanoseconds() - _system_clock_base;
+}
+
+void system_timer_rearm(bool idle)
+{
+    if (!_system_clock)
+    {
+        return;
+    }
+
+    Tick deadline = system_get_tick() + 1;
+
+    if (idle)
+    {
+        // Nothing to preempt, sleep until the first timer.
+        deadline = timer_next_deadline();
+    }
+
+    if (deadline == (Tick)-1)
+    {
+        arch_timer_oneshot((uint64_t)-1);
+    }
+    else
+    {
+        arch_timer_oneshot(_system_clock_base + (uint64_t)deadline * NANOSECONDS_PER_TICK);
+    }
 }
 
 static TimeStamp _system_boot_timestamp = 0;
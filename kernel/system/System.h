@@ -13,10 +13,27 @@ void __no_return system_hang();
 
 void __no_return system_stop();
 
+// The periodic timer runs at this frequency until the clock is calibrated,
+// ticks stay the unit of timeouts and timers after that.
+#define SYSTEM_TICKS_PER_SECOND 1000
+#define NANOSECONDS_PER_TICK (1000000000 / SYSTEM_TICKS_PER_SECOND)
+
+// Called from the timer interrupt, expire the timers which are due.
 void system_tick();
 
 uint32_t system_get_tick();
 
+// Switch from counting timer interrupts to the monotonic clock of the
+// arch, see arch_get_nanoseconds(). Called once it is calibrated.
+void system_clock_start();
+
+// Monotonic time since boot.
+uint64_t system_get_nanoseconds();
+
+// Program the next timer interrupt of this processor: the next tick if
+// it is running something, the first armed timer if it is idle.
+void system_timer_rearm(bool idle);
+
 ElapsedTime system_get_uptime();
 
 #define system_panic(__args...) \
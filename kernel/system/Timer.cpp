@@ -0,0 +1,187 @@
+#include <assert.h>
+#include <libsystem/math/MinMax.h>
+
+#include "kernel/interrupts/Interupts.h"
+#include "kernel/system/Timer.h"
+
+static Timer *_wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS] = {};
+
+// The next tick to be processed by timer_tick().
+static Tick _current = 0;
+static size_t _armed = 0;
+
+static constexpr Tick timer_level_span(int level)
+{
+    return 1u << (TIMER_WHEEL_BITS * level);
+}
+
+static Timer **timer_slot_for(Tick deadline)
+{
+    if (deadline < _current)
+    {
+        deadline = _current;
+    }
+
+    Tick delta = deadline - _current;
+
+    int level = 0;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= timer_level_span(level + 1))
+    {
+        level++;
+    }
+
+    return &_wheel[level][(deadline >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+}
+
+static void timer_link(Timer *timer)
+{
+    Timer **slot = timer_slot_for(timer->deadline);
+
+    timer->slot = slot;
+    timer->prev = nullptr;
+    timer->next = *slot;
+
+    if (*slot)
+    {
+        (*slot)->prev = timer;
+    }
+
+    *slot = timer;
+}
+
+static void timer_unlink(Timer *timer)
+{
+    if (timer->prev)
+    {
+        timer->prev->next = timer->next;
+    }
+    else
+    {
+        *timer->slot = timer->next;
+    }
+
+    if (timer->next)
+    {
+        timer->next->prev = timer->prev;
+    }
+
+    timer->slot = nullptr;
+    timer->prev = nullptr;
+    timer->next = nullptr;
+}
+
+void timer_arm(Timer *timer, Tick deadline, TimerCallback callback, void *target)
+{
+    InterruptsRetainer retainer;
+
+    assert(!timer_is_armed(timer));
+
+    timer->deadline = deadline;
+    timer->callback = callback;
+    timer->target = target;
+
+    timer_link(timer);
+    _armed++;
+}
+
+void timer_disarm(Timer *timer)
+{
+    InterruptsRetainer retainer;
+
+    if (timer_is_armed(timer))
+    {
+        timer_unlink(timer);
+        _armed--;
+    }
+}
+
+bool timer_is_armed(Timer *timer)
+{
+    return timer->slot != nullptr;
+}
+
+static void timer_cascade(int level, int index)
+{
+    Timer *timer = _wheel[level][index];
+    _wheel[level][index] = nullptr;
+
+    while (timer)
+    {
+        Timer *next = timer->next;
+        timer_link(timer);
+        timer = next;
+    }
+}
+
+void timer_tick(Tick now)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    while (_current <= now)
+    {
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+        {
+            if (_current & (timer_level_span(level) - 1))
+            {
+                break;
+            }
+
+            timer_cascade(level, (_current >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+        }
+
+        Timer **slot = &_wheel[0][_current & TIMER_WHEEL_MASK];
+
+        while (*slot)
+        {
+            Timer *timer = *slot;
+
+            timer_unlink(timer);
+            _armed--;
+
+            timer->callback(timer->target);
+        }
+
+        _current++;
+    }
+}
+
+Tick timer_next_deadline()
+{
+    InterruptsRetainer retainer;
+
+    if (_armed == 0)
+    {
+        return (Tick)-1;
+    }
+
+    Tick result = (Tick)-1;
+
+    for (Tick i = 0; i < TIMER_WHEEL_SLOTS; i++)
+    {
+        if (_wheel[0][(_current + i) & TIMER_WHEEL_MASK])
+        {
+            result = _current + i;
+            break;
+        }
+    }
+
+    // Timers in the upper levels may expire before that,
+    // so also wake up for the first cascade that will bring one down.
+    for (int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        Tick span = timer_level_span(level);
+        Tick cascade = __align_up(_current, span);
+
+        for (int i = 0; i < TIMER_WHEEL_SLOTS && cascade >= _current; i++, cascade += span)
+        {
+            if (_wheel[level][(cascade >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK])
+            {
+                result = MIN(result, cascade);
+                break;
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <libsystem/Common.h>
+#include <skift/Time.h>
+
+// Timers are kept in a hierarchical timing wheel: four levels of 256 slots,
+// each level covering 256 times the span of the previous one.
+// Timers are cascaded to a lower level when the wheel reaches their slot,
+// so expiring them costs O(1) per tick no matter how many are armed.
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+typedef void (*TimerCallback)(void *target);
+
+struct Timer
+{
+    Tick deadline;
+    TimerCallback callback;
+    void *target;
+
+    Timer *prev;
+    Timer *next;
+    Timer **slot;
+};
+
+// Call `callback(target)` from the timer interrupt once `deadline` is reached.
+void timer_arm(Timer *timer, Tick deadline, TimerCallback callback, void *target);
+
+void timer_disarm(Timer *timer);
+
+bool timer_is_armed(Timer *timer);
+
+// Expire every timers up to `now`.
+void timer_tick(Tick now);
+
+// Return a tick at which the wheel needs to be serviced, it is never later
+// than the earliest armed timer. Used to program the timer one-shot.
+Tick timer_next_deadline();
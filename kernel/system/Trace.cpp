@@ -0,0 +1,202 @@
+#include <libsystem/math/MinMax.h>
+#include <skift/Lock.h>
+#include <string.h>
+
+#include "archs/Architectures.h"
+#include "kernel/system/CPU.h"
+#include "kernel/system/System.h"
+#include "kernel/system/Trace.h"
+
+struct TraceRing
+{
+    TraceRecord *records;
+
+    // A power of two, `head` counts the records ever written and wraps
+    // around, `used` is how many of them are still in the ring.
+    size_t size;
+    size_t head;
+    size_t used;
+
+    // Set while this processor is appending, so the buffers are not freed under it.
+    bool writing;
+};
+
+bool _trace_running = false;
+
+static TraceRing _rings[CPU_MAX_COUNT] = {};
+static size_t _trace_size = TRACE_DEFAULT_SIZE;
+
+// Serializes start, stop, resize and snapshots, recording never takes it.
+static Lock _trace_lock{"trace"};
+
+void trace_record_internal(TraceEvent event, int task, uint32_t arg0, uint32_t arg1)
+{
+    bool interrupts = arch_interrupts_enabled();
+    arch_disable_interrupts();
+
+    int cpu = arch_cpu_current();
+    auto &ring = _rings[cpu];
+
+    __atomic_store_n(&ring.writing, true, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&_trace_running, __ATOMIC_SEQ_CST) && ring.records)
+    {
+        ring.records[ring.head & (ring.size - 1)] = {
+            system_get_nanoseconds(),
+            (uint16_t)event,
+            (uint16_t)cpu,
+            task,
+            arg0,
+            arg1,
+        };
+
+        if (ring.used < ring.size)
+        {
+            __atomic_store_n(&ring.used, ring.used + 1, __ATOMIC_RELEASE);
+        }
+
+        __atomic_store_n(&ring.head, ring.head + 1, __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&ring.writing, false, __ATOMIC_RELEASE);
+
+    if (interrupts)
+    {
+        arch_enable_interrupts();
+    }
+}
+
+static void trace_wait_writers()
+{
+    for (int i = 0; i < CPU_MAX_COUNT; i++)
+    {
+        while (__atomic_load_n(&_rings[i].writing, __ATOMIC_ACQUIRE))
+        {
+            asm("pause");
+        }
+    }
+}
+
+static void trace_free_rings()
+{
+    for (int i = 0; i < CPU_MAX_COUNT; i++)
+    {
+        delete[] _rings[i].records;
+        _rings[i] = {};
+    }
+}
+
+Result trace_start()
+{
+    LockHolder holder(_trace_lock);
+
+    if (_trace_running)
+    {
+        return SUCCESS;
+    }
+
+    for (int i = 0; i < cpu_count(); i++)
+    {
+        if (_rings[i].records)
+        {
+            continue;
+        }
+
+        _rings[i].records = new TraceRecord[_trace_size];
+        _rings[i].size = _trace_size;
+        _rings[i].head = 0;
+        _rings[i].used = 0;
+    }
+
+    __atomic_store_n(&_trace_running, true, __ATOMIC_SEQ_CST);
+
+    return SUCCESS;
+}
+
+void trace_stop()
+{
+    LockHolder holder(_trace_lock);
+
+    __atomic_store_n(&_trace_running, false, __ATOMIC_SEQ_CST);
+}
+
+bool trace_running()
+{
+    return __atomic_load_n(&_trace_running, __ATOMIC_ACQUIRE);
+}
+
+size_t trace_size()
+{
+    return _trace_size;
+}
+
+Result trace_resize(size_t size)
+{
+    LockHolder holder(_trace_lock);
+
+    if (size == 0)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    if (_trace_running)
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    size_t rounded = 1;
+
+    while (rounded < size)
+    {
+        rounded <<= 1;
+    }
+
+    // A processor may have seen the trace running just before it was stopped.
+    trace_wait_writers();
+    trace_free_rings();
+
+    _trace_size = rounded;
+
+    return SUCCESS;
+}
+
+size_t trace_snapshot(TraceRecord **records)
+{
+    LockHolder holder(_trace_lock);
+
+    size_t total = 0;
+
+    for (int i = 0; i < cpu_count(); i++)
+    {
+        total += __atomic_load_n(&_rings[i].used, __ATOMIC_ACQUIRE);
+    }
+
+    *records = new TraceRecord[MAX(total, 1)];
+
+    size_t count = 0;
+
+    for (int i = 0; i < cpu_count(); i++)
+    {
+        auto &ring = _rings[i];
+
+        size_t head = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+
+        // The ring may have grown since we counted.
+        size_t used = MIN(__atomic_load_n(&ring.used, __ATOMIC_ACQUIRE), total - count);
+
+        for (size_t j = 0; j < used; j++)
+        {
+            (*records)[count + j] = ring.records[(head - used + j) & (ring.size - 1)];
+        }
+
+        // Records overwritten while we were copying are dropped, they are the oldest ones.
+        size_t written = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE) - head;
+        size_t dropped = written > ring.size - used ? MIN(written - (ring.size - used), used) : 0;
+
+        memmove(&(*records)[count], &(*records)[count + dropped], (used - dropped) * sizeof(TraceRecord));
+
+        count += used - dropped;
+    }
+
+    return count;
+}
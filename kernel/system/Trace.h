@@ -0,0 +1,36 @@
+#pragma once
+
+#include <abi/Trace.h>
+#include <libsystem/Result.h>
+
+// Default number of records kept per processor.
+#define TRACE_DEFAULT_SIZE 4096
+
+// Each processor appends to its own ring buffer with interrupts disabled,
+// so recording an event never takes a lock. Once the ring is full the
+// oldest records are overwritten.
+extern bool _trace_running;
+
+void trace_record_internal(TraceEvent event, int task, uint32_t arg0, uint32_t arg1);
+
+static inline void trace_record(TraceEvent event, int task, uint32_t arg0 = 0, uint32_t arg1 = 0)
+{
+    if (__atomic_load_n(&_trace_running, __ATOMIC_RELAXED))
+    {
+        trace_record_internal(event, task, arg0, arg1);
+    }
+}
+
+Result trace_start();
+
+void trace_stop();
+
+bool trace_running();
+
+size_t trace_size();
+
+// Records are dropped, the trace must be stopped.
+Result trace_resize(size_t size);
+
+// Copy the records of every processors into a new buffer, returns their count.
+size_t trace_snapshot(TraceRecord **records);
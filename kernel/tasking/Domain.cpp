@@ -1,5 +1,6 @@
 #include <libsystem/Logger.h>
 
+#include "kernel/node/DentryCache.h"
 #include "kernel/node/Directory.h"
 #include "kernel/node/File.h"
 #include "kernel/node/Pipe.h"
@@ -41,9 +42,15 @@ RefPtr<FsNode> Domain::find(Path path)
         {
             auto element = path[i];
 
-            current->acquire(scheduler_running_id());
-            auto found = current->find(element);
-            current->release(scheduler_running_id());
+            RefPtr<FsNode> found;
+
+            if (!dentry_cache_lookup(current.naked(), element, found))
+            {
+                current->acquire(scheduler_running_id());
+                found = current->find(element);
+                dentry_cache_insert(current, element, found);
+                current->release(scheduler_running_id());
+            }
 
             current = found;
         }
@@ -70,7 +77,7 @@ ResultOr<RefPtr<FsHandle>> Domain::open(Path path, OpenFlag flags)
         {
             if (flags & OPEN_SOCKET)
             {
-                node = make<FsSocket>();
+                node = make<FsSocket>(flags & OPEN_SEQPACKET);
             }
             else
             {
@@ -1,44 +1,88 @@
 
 #include <libsystem/Logger.h>
+#include <libsystem/math/MinMax.h>
+#include <string.h>
 
+#include "kernel/interrupts/Interupts.h"
+#include "kernel/node/Connection.h"
 #include "kernel/node/Pipe.h"
+#include "kernel/node/Poller.h"
 #include "kernel/node/Terminal.h"
 #include "kernel/scheduling/Blocker.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/tasking/Handles.h"
+#include "kernel/tasking/Task-Memory.h"
 
 ResultOr<int> Handles::add(RefPtr<FsHandle> handle)
 {
     LockHolder holder(_lock);
 
-    for (int i = 0; i < PROCESS_HANDLE_COUNT; i++)
+    // Slots taken by add_at() stay in the free list, they are skipped here.
+    while (_free.any())
     {
-        if (_handles[i] == nullptr)
-        {
-            _handles[i] = handle;
+        int index = _free.pop_back();
 
-            return i;
+        if (_handles[index] == nullptr)
+        {
+            _handles[index] = handle;
+            return index;
         }
     }
 
-    return ERR_TOO_MANY_HANDLE;
+    if (_handles.count() >= PROCESS_HANDLE_MAX)
+    {
+        return ERR_TOO_MANY_HANDLE;
+    }
+
+    _handles.push_back(handle);
+
+    return _handles.count() - 1;
 }
 
 Result Handles::add_at(RefPtr<FsHandle> handle, int index)
 {
-    if (index < 0 && index >= PROCESS_HANDLE_COUNT)
+    if (index < 0 || index >= PROCESS_HANDLE_MAX)
     {
         return ERR_BAD_HANDLE;
     }
 
     LockHolder holder(_lock);
+
+    // The slots skipped over are free for the next handles.
+    while (_handles.count() <= (size_t)index)
+    {
+        _free.push_back(_handles.count());
+        _handles.push_back(nullptr);
+    }
+
     _handles[index] = handle;
+
+    // Each slot taken this way leaves a stale index behind in the free list.
+    if (_free.count() > 2 * _handles.count())
+    {
+        rebuild_free();
+    }
+
     return SUCCESS;
 }
 
+void Handles::rebuild_free()
+{
+    _free.clear();
+
+    // The lowest indexes are at the back, they are reused first.
+    for (size_t i = _handles.count(); i > 0; i--)
+    {
+        if (_handles[i - 1] == nullptr)
+        {
+            _free.push_back(i - 1);
+        }
+    }
+}
+
 bool Handles::is_valid_handle(int handle)
 {
-    return handle >= 0 && handle < PROCESS_HANDLE_COUNT &&
+    return handle >= 0 && (size_t)handle < _handles.count() &&
            _handles[handle] != nullptr;
 }
 
@@ -53,6 +97,7 @@ Result Handles::remove(int handle_index)
     }
 
     _handles[handle_index] = nullptr;
+    _free.push_back(handle_index);
 
     return SUCCESS;
 }
@@ -97,6 +142,25 @@ ResultOr<int> Handles::connect(Domain &domain, Path &path)
     return add(handle);
 }
 
+bool Handles::exists(int handle_index)
+{
+    LockHolder holder(_lock);
+
+    return is_valid_handle(handle_index);
+}
+
+RefPtr<FsHandle> Handles::find(int handle_index)
+{
+    LockHolder holder(_lock);
+
+    if (!is_valid_handle(handle_index))
+    {
+        return nullptr;
+    }
+
+    return _handles[handle_index];
+}
+
 Result Handles::close(int handle_index)
 {
     return remove(handle_index);
@@ -106,10 +170,8 @@ void Handles::close_all()
 {
     LockHolder holder(_lock);
 
-    for (int i = 0; i < PROCESS_HANDLE_COUNT; i++)
-    {
-        _handles[i] = nullptr;
-    }
+    _handles.clear();
+    _free.clear();
 }
 
 Result Handles::reopen(int handle, int *reopened)
@@ -172,6 +234,22 @@ Result Handles::poll(HandlePoll *handles, size_t count, Timeout timeout)
         });
     }
 
+    // Nothing to wait for, the scheduler would only wake us up on the next tick.
+    if (timeout == 0)
+    {
+        bool any = false;
+
+        for (size_t i = 0; i < selected.count(); i++)
+        {
+            selected[i].result = selected[i].handle->poll(selected[i].events);
+            any = any || selected[i].result != 0;
+        }
+
+        release_handles();
+
+        return any ? SUCCESS : TIMEOUT;
+    }
+
     {
         BlockerSelect blocker{selected};
         Result block_result = task_block(scheduler_running(), blocker, timeout);
@@ -220,6 +298,37 @@ ResultOr<size_t> Handles::write(int handle_index, const void *buffer, size_t siz
     return result_or_written;
 }
 
+ResultOr<size_t> Handles::splice(int source_index, int destination_index, size_t size)
+{
+    // The same handle can't be acquired twice.
+    if (source_index == destination_index)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    auto source = acquire(source_index);
+
+    if (!source)
+    {
+        return ERR_BAD_HANDLE;
+    }
+
+    auto destination = acquire(destination_index);
+
+    if (!destination)
+    {
+        release(source_index);
+        return ERR_BAD_HANDLE;
+    }
+
+    auto result_or_spliced = source->splice(*destination, size);
+
+    release(destination_index);
+    release(source_index);
+
+    return result_or_spliced;
+}
+
 ResultOr<ssize64_t> Handles::seek(int handle_index, IO::SeekFrom from)
 {
     auto handle = acquire(handle_index);
@@ -268,6 +377,27 @@ Result Handles::stat(int handle_index, FileState *stat)
     return result;
 }
 
+Result Handles::map(int handle_index, size_t offset, size_t size, MemoryFlags flags, uintptr_t *out_address)
+{
+    auto handle = acquire(handle_index);
+
+    if (!handle)
+    {
+        return ERR_BAD_HANDLE;
+    }
+
+    auto result = ERR_WRITE_ONLY_STREAM;
+
+    if (handle->has_flag(OPEN_READ))
+    {
+        result = task_memory_map_node(scheduler_running(), handle->node(), offset, size, 0, flags, out_address);
+    }
+
+    release(handle_index);
+
+    return result;
+}
+
 ResultOr<int> Handles::accept(int socket_handle_index)
 {
     auto socket_handle = acquire(socket_handle_index);
@@ -293,6 +423,186 @@ ResultOr<int> Handles::accept(int socket_handle_index)
     return add_result;
 }
 
+Result Handles::send(int handle_index, const HandleMessage &message)
+{
+    if (message.size > HANDLE_MESSAGE_MAX_SIZE ||
+        message.handles_count > HANDLE_MESSAGE_MAX_HANDLES ||
+        message.memories_count > HANDLE_MESSAGE_MAX_MEMORIES)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    auto connection = find(handle_index);
+
+    if (!connection)
+    {
+        return ERR_BAD_HANDLE;
+    }
+
+    auto packet = own<FsPacket>(message.buffer, message.size);
+
+    for (size_t i = 0; i < message.handles_count; i++)
+    {
+        auto attached = find(message.handles[i]);
+
+        if (!attached)
+        {
+            return ERR_BAD_HANDLE;
+        }
+
+        // The connection would keep itself alive until the message is received.
+        if (attached->node().naked() == connection->node().naked())
+        {
+            return ERR_INVALID_ARGUMENT;
+        }
+
+        packet->handles[packet->handles_count++] = make<FsHandle>(*attached);
+    }
+
+    for (size_t i = 0; i < message.memories_count; i++)
+    {
+        MemoryObject *memory_object = nullptr;
+        TRY(task_memory_object(scheduler_running(), message.memories[i].address, &memory_object));
+
+        packet->memories[packet->memories_count++] = memory_object_ref(memory_object);
+    }
+
+    // The packet is gone once sent, the objects are kept until they are made shared.
+    MemoryObject *memories[HANDLE_MESSAGE_MAX_MEMORIES];
+    size_t memories_count = packet->memories_count;
+
+    for (size_t i = 0; i < memories_count; i++)
+    {
+        memories[i] = memory_object_ref(packet->memories[i]);
+    }
+
+    Result result = ERR_BAD_HANDLE;
+    auto handle = acquire(handle_index);
+
+    if (handle)
+    {
+        result = handle->send(move(packet));
+        release(handle_index);
+    }
+
+    for (size_t i = 0; i < memories_count; i++)
+    {
+        // Only what was sent needs other tasks to see the writes of this one.
+        if (result == SUCCESS)
+        {
+            memories[i]->shared = true;
+        }
+
+        memory_object_deref(memories[i]);
+    }
+
+    return result;
+}
+
+Result Handles::receive(int handle_index, HandleMessage &message)
+{
+    auto handle = acquire(handle_index);
+
+    if (!handle)
+    {
+        return ERR_BAD_HANDLE;
+    }
+
+    auto result_or_packet = handle->receive();
+
+    release(handle_index);
+
+    if (!result_or_packet.success())
+    {
+        return result_or_packet.result();
+    }
+
+    auto packet = result_or_packet.take_value();
+
+    message.size = MIN(message.size, packet->size);
+    memcpy(message.buffer, packet->data, message.size);
+
+    // The message is consumed either way, what was added to the task so far is
+    // taken back, and the rest goes away with the packet.
+    message.handles_count = 0;
+
+    for (size_t i = 0; i < packet->handles_count; i++)
+    {
+        auto result_or_index = add(packet->handles[i]);
+
+        if (!result_or_index.success())
+        {
+            for (size_t j = 0; j < message.handles_count; j++)
+            {
+                remove(message.handles[j]);
+            }
+
+            message.handles_count = 0;
+            message.memories_count = 0;
+
+            return result_or_index.result();
+        }
+
+        message.handles[message.handles_count++] = result_or_index.value();
+    }
+
+    message.memories_count = 0;
+
+    for (size_t i = 0; i < packet->memories_count; i++)
+    {
+        Result result = task_memory_include_object(
+            scheduler_running(),
+            packet->memories[i],
+            &message.memories[i].address,
+            &message.memories[i].size);
+
+        if (result != SUCCESS)
+        {
+            for (size_t j = 0; j < message.memories_count; j++)
+            {
+                task_memory_free(scheduler_running(), message.memories[j].address);
+            }
+
+            for (size_t j = 0; j < message.handles_count; j++)
+            {
+                remove(message.handles[j]);
+            }
+
+            message.handles_count = 0;
+            message.memories_count = 0;
+
+            return result;
+        }
+
+        message.memories_count++;
+    }
+
+    return SUCCESS;
+}
+
+Result Handles::exchange(int handle_index, const HandleMessage &request, HandleMessage &reply)
+{
+    TRY(send(handle_index, request));
+
+    auto handle = find(handle_index);
+
+    if (handle && handle->node()->type() == FILE_TYPE_CONNECTION)
+    {
+        auto connection = static_cast<FsConnection *>(handle->node().naked());
+
+        InterruptsRetainer retainer;
+
+        Task *peer = task_by_id(connection->peer_task(*handle));
+
+        if (peer)
+        {
+            scheduler_hand_off(peer);
+        }
+    }
+
+    return receive(handle_index, reply);
+}
+
 Result Handles::duplex(
     RefPtr<FsNode> node,
     int *server,
@@ -368,6 +678,21 @@ Result Handles::pipe(int *reader, int *writer)
         OPEN_WRITE);
 }
 
+Result Handles::poller(int *handle)
+{
+    auto result_or_handle = add(make<FsHandle>(make<FsPoller>(), OPEN_READ));
+
+    if (!result_or_handle.success())
+    {
+        *handle = HANDLE_INVALID_ID;
+        return result_or_handle.result();
+    }
+
+    *handle = result_or_handle.value();
+
+    return SUCCESS;
+}
+
 Result Handles::pass(Handles &handles, int source, int destination)
 {
     {
@@ -392,3 +717,38 @@ Result Handles::pass(Handles &handles, int source, int destination)
 
     return add_result;
 }
+
+void Handles::pass_all(Handles &handles)
+{
+    // Copying a handle opens its node again, which can't be done under the lock.
+    Vector<RefPtr<FsHandle>> originals;
+
+    {
+        LockHolder holder(_lock);
+
+        for (size_t i = 0; i < _handles.count(); i++)
+        {
+            originals.push_back(_handles[i]);
+        }
+    }
+
+    Vector<RefPtr<FsHandle>> copies(originals.count());
+
+    for (size_t i = 0; i < originals.count(); i++)
+    {
+        if (originals[i] == nullptr)
+        {
+            copies.push_back(nullptr);
+            continue;
+        }
+
+        originals[i]->acquire(scheduler_running_id());
+        copies.push_back(make<FsHandle>(*originals[i]));
+        originals[i]->release(scheduler_running_id());
+    }
+
+    LockHolder holder(handles._lock);
+
+    handles._handles = move(copies);
+    handles.rebuild_free();
+}
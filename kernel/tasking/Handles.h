@@ -1,6 +1,7 @@
 #pragma once
 
 #include <libutils/Path.h>
+#include <libutils/Vector.h>
 
 #include "kernel/node/Handle.h"
 
@@ -9,12 +10,17 @@ class Handles
 private:
     Lock _lock{"handles-lock"};
 
-    RefPtr<FsHandle> _handles[PROCESS_HANDLE_COUNT];
+    // Grows as handles are added, the indexes of closed handles are
+    // reused first, so adding one doesn't have to look for a free slot.
+    Vector<RefPtr<FsHandle>> _handles{};
+    Vector<int> _free{};
 
     ResultOr<int> add(RefPtr<FsHandle> handle);
 
     Result add_at(RefPtr<FsHandle> handle, int index);
 
+    void rebuild_free();
+
     bool is_valid_handle(int handle);
 
     Result remove(int handle_index);
@@ -34,6 +40,11 @@ public:
 
     Result close(int handle_index);
 
+    bool exists(int handle_index);
+
+    // The handle at `handle_index` without acquiring it, or nullptr.
+    RefPtr<FsHandle> find(int handle_index);
+
     void close_all();
 
     Result reopen(int handle, int *reopened);
@@ -46,14 +57,25 @@ public:
 
     ResultOr<size_t> write(int handle_index, const void *buffer, size_t size);
 
+    ResultOr<size_t> splice(int source_index, int destination_index, size_t size);
+
     ResultOr<ssize64_t> seek(int handle_index, IO::SeekFrom from);
 
     Result call(int handle_index, IOCall request, void *args);
 
     Result stat(int handle_index, FileState *stat);
 
+    Result map(int handle_index, size_t offset, size_t size, MemoryFlags flags, uintptr_t *out_address);
+
     ResultOr<int> accept(int handle_index);
 
+    Result send(int handle_index, const HandleMessage &message);
+
+    Result receive(int handle_index, HandleMessage &message);
+
+    // Send `request`, let the other side run right away, and wait for its reply.
+    Result exchange(int handle_index, const HandleMessage &request, HandleMessage &reply);
+
     Result duplex(
         RefPtr<FsNode> node,
         int *server, OpenFlag server_flags,
@@ -63,5 +85,10 @@ public:
 
     Result pipe(int *reader, int *writer);
 
+    Result poller(int *handle);
+
     Result pass(Handles &handles, int source, int destination);
+
+    // Give every handle to `handles`, at the same indexes.
+    void pass_all(Handles &handles);
 };
@@ -10,9 +10,11 @@
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
+#include "kernel/system/Trace.h"
 #include "kernel/tasking/Syscalls.h"
 #include "kernel/tasking/Task-Launchpad.h"
 #include "kernel/tasking/Task-Memory.h"
+#include "kernel/tasking/Task-Ring.h"
 
 typedef Result (*SyscallHandler)(uintptr_t, uintptr_t, uintptr_t, uintptr_t, uintptr_t);
 
@@ -234,6 +236,16 @@ Result hj_memory_get_handle(uintptr_t address, int *out_handle)
     return task_memory_get_handle(scheduler_running(), address, out_handle);
 }
 
+Result hj_memory_map_handle(int handle, size_t offset, size_t size, int flags, uintptr_t *out_address)
+{
+    if (!syscall_validate_ptr((uintptr_t)out_address, sizeof(uintptr_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return scheduler_running()->handles().map(handle, offset, size, flags, out_address);
+}
+
 /* --- Filesystem ----------------------------------------------------------- */
 
 Result hj_filesystem_mkdir(const char *raw_path, size_t size)
@@ -345,7 +357,7 @@ Result hj_system_status(SystemStatus *status)
     status->used_ram = memory_get_used();
 
     status->running_tasks = task_count();
-    status->cpu_usage = 100 - scheduler_get_usage(0);
+    status->cpu_usage = scheduler_get_cpu_usage();
 
     return SUCCESS;
 }
@@ -368,6 +380,17 @@ Result hj_system_get_ticks(uint32_t *tick)
     return SUCCESS;
 }
 
+Result hj_system_get_clock(uint64_t *nanoseconds)
+{
+    if (!syscall_validate_ptr((uintptr_t)nanoseconds, sizeof(uint64_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    *nanoseconds = system_get_nanoseconds();
+    return SUCCESS;
+}
+
 Result hj_system_reboot()
 {
     arch_reboot();
@@ -406,6 +429,16 @@ Result hj_create_term(int *server_handle, int *client_handle)
     return handles.term(server_handle, client_handle);
 }
 
+Result hj_create_poller(int *handle)
+{
+    if (!syscall_validate_ptr((uintptr_t)handle, sizeof(int)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return scheduler_running()->handles().poller(handle);
+}
+
 /* --- Handles -------------------------------------------------------------- */
 
 Result hj_handle_open(int *handle,
@@ -442,7 +475,11 @@ Result hj_handle_close(int handle)
 {
     auto &handles = scheduler_running()->handles();
 
-    return handles.close(handle);
+    Result result = handles.close(handle);
+
+    task_ring_handle_closed(scheduler_running(), handle);
+
+    return result;
 }
 
 Result hj_handle_reopen(int handle, int *reopened)
@@ -461,7 +498,11 @@ Result hj_handle_copy(int source, int destination)
 {
     auto &handles = scheduler_running()->handles();
 
-    return handles.copy(source, destination);
+    Result result = handles.copy(source, destination);
+
+    task_ring_handle_closed(scheduler_running(), destination);
+
+    return result;
 }
 
 Result hj_handle_poll(HandlePoll *handle_poll, size_t count, Timeout timeout)
@@ -471,7 +512,7 @@ Result hj_handle_poll(HandlePoll *handle_poll, size_t count, Timeout timeout)
         return ERR_BAD_ADDRESS;
     }
 
-    if (count > PROCESS_HANDLE_COUNT)
+    if (count > PROCESS_HANDLE_MAX)
     {
         return ERR_TOO_MANY_HANDLE;
     }
@@ -539,6 +580,29 @@ Result hj_handle_write(int handle, const void *buffer, size_t size, size_t *writ
     }
 }
 
+Result hj_handle_splice(int source, int destination, size_t size, size_t *spliced)
+{
+    if (!syscall_validate_ptr((uintptr_t)spliced, sizeof(size_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    auto &handles = scheduler_running()->handles();
+
+    auto result_or_spliced = handles.splice(source, destination, size);
+
+    if (result_or_spliced.success())
+    {
+        *spliced = result_or_spliced.take_value();
+        return SUCCESS;
+    }
+    else
+    {
+        *spliced = 0;
+        return result_or_spliced.result();
+    }
+}
+
 Result hj_handle_call(int handle, IOCall request, void *args)
 {
     auto &handles = scheduler_running()->handles();
@@ -630,6 +694,98 @@ Result hj_handle_accept(int handle, int *connection_handle)
     }
 }
 
+static bool syscall_validate_message(const HandleMessage *message)
+{
+    return syscall_validate_ptr((uintptr_t)message, sizeof(HandleMessage)) &&
+           syscall_validate_ptr((uintptr_t)message->buffer, message->size);
+}
+
+Result hj_handle_send(int handle, const HandleMessage *message)
+{
+    if (!syscall_validate_ptr((uintptr_t)message, sizeof(HandleMessage)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    // Copied first, so the task can't change it once it's validated.
+    HandleMessage request = *message;
+
+    if (!syscall_validate_message(&request))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    auto &handles = scheduler_running()->handles();
+
+    return handles.send(handle, request);
+}
+
+Result hj_handle_receive(int handle, HandleMessage *message)
+{
+    if (!syscall_validate_ptr((uintptr_t)message, sizeof(HandleMessage)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    HandleMessage reply = *message;
+
+    if (!syscall_validate_message(&reply))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    auto &handles = scheduler_running()->handles();
+
+    Result result = handles.receive(handle, reply);
+
+    *message = reply;
+
+    return result;
+}
+
+Result hj_handle_exchange(int handle, const HandleMessage *message, HandleMessage *reply_message)
+{
+    if (!syscall_validate_ptr((uintptr_t)message, sizeof(HandleMessage)) ||
+        !syscall_validate_ptr((uintptr_t)reply_message, sizeof(HandleMessage)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    HandleMessage request = *message;
+    HandleMessage reply = *reply_message;
+
+    if (!syscall_validate_message(&request) ||
+        !syscall_validate_message(&reply))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    auto &handles = scheduler_running()->handles();
+
+    Result result = handles.exchange(handle, request, reply);
+
+    *reply_message = reply;
+
+    return result;
+}
+
+/* --- Ring ----------------------------------------------------------------- */
+
+Result hj_ring_setup(size_t entries, uintptr_t *out_address)
+{
+    if (!syscall_validate_ptr((uintptr_t)out_address, sizeof(uintptr_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return task_ring_setup(scheduler_running(), entries, out_address);
+}
+
+Result hj_ring_enter(size_t to_submit, size_t min_complete, Timeout timeout)
+{
+    return task_ring_enter(scheduler_running(), to_submit, min_complete, timeout);
+}
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-function-type"
 
@@ -648,6 +804,7 @@ static SyscallHandler syscalls[__SYSCALL_COUNT] = {
     [HJ_MEMORY_FREE] = reinterpret_cast<SyscallHandler>(hj_memory_free),
     [HJ_MEMORY_INCLUDE] = reinterpret_cast<SyscallHandler>(hj_memory_include),
     [HJ_MEMORY_GET_HANDLE] = reinterpret_cast<SyscallHandler>(hj_memory_get_handle),
+    [HJ_MEMORY_MAP_HANDLE] = reinterpret_cast<SyscallHandler>(hj_memory_map_handle),
     [HJ_FILESYSTEM_LINK] = reinterpret_cast<SyscallHandler>(hj_filesystem_link),
     [HJ_FILESYSTEM_UNLINK] = reinterpret_cast<SyscallHandler>(hj_filesystem_unlink),
     [HJ_FILESYSTEM_RENAME] = reinterpret_cast<SyscallHandler>(hj_filesystem_rename),
@@ -657,6 +814,7 @@ static SyscallHandler syscalls[__SYSCALL_COUNT] = {
     [HJ_SYSTEM_STATUS] = reinterpret_cast<SyscallHandler>(hj_system_status),
     [HJ_SYSTEM_TIME] = reinterpret_cast<SyscallHandler>(hj_system_get_time),
     [HJ_SYSTEM_TICKS] = reinterpret_cast<SyscallHandler>(hj_system_get_ticks),
+    [HJ_SYSTEM_CLOCK] = reinterpret_cast<SyscallHandler>(hj_system_get_clock),
     [HJ_SYSTEM_REBOOT] = reinterpret_cast<SyscallHandler>(hj_system_reboot),
     [HJ_SYSTEM_SHUTDOWN] = reinterpret_cast<SyscallHandler>(hj_system_shutdown),
     [HJ_HANDLE_OPEN] = reinterpret_cast<SyscallHandler>(hj_handle_open),
@@ -666,13 +824,20 @@ static SyscallHandler syscalls[__SYSCALL_COUNT] = {
     [HJ_HANDLE_POLL] = reinterpret_cast<SyscallHandler>(hj_handle_poll),
     [HJ_HANDLE_READ] = reinterpret_cast<SyscallHandler>(hj_handle_read),
     [HJ_HANDLE_WRITE] = reinterpret_cast<SyscallHandler>(hj_handle_write),
+    [HJ_HANDLE_SPLICE] = reinterpret_cast<SyscallHandler>(hj_handle_splice),
     [HJ_HANDLE_CALL] = reinterpret_cast<SyscallHandler>(hj_handle_call),
     [HJ_HANDLE_SEEK] = reinterpret_cast<SyscallHandler>(hj_handle_seek),
     [HJ_HANDLE_STAT] = reinterpret_cast<SyscallHandler>(hj_handle_stat),
     [HJ_HANDLE_CONNECT] = reinterpret_cast<SyscallHandler>(hj_handle_connect),
     [HJ_HANDLE_ACCEPT] = reinterpret_cast<SyscallHandler>(hj_handle_accept),
+    [HJ_HANDLE_SEND] = reinterpret_cast<SyscallHandler>(hj_handle_send),
+    [HJ_HANDLE_RECEIVE] = reinterpret_cast<SyscallHandler>(hj_handle_receive),
+    [HJ_HANDLE_EXCHANGE] = reinterpret_cast<SyscallHandler>(hj_handle_exchange),
     [HJ_CREATE_PIPE] = reinterpret_cast<SyscallHandler>(hj_create_pipe),
     [HJ_CREATE_TERM] = reinterpret_cast<SyscallHandler>(hj_create_term),
+    [HJ_CREATE_POLLER] = reinterpret_cast<SyscallHandler>(hj_create_poller),
+    [HJ_RING_SETUP] = reinterpret_cast<SyscallHandler>(hj_ring_setup),
+    [HJ_RING_ENTER] = reinterpret_cast<SyscallHandler>(hj_ring_enter),
 };
 
 #pragma GCC diagnostic pop
@@ -710,9 +875,15 @@ uintptr_t task_do_syscall(Syscall syscall, uintptr_t arg0, uintptr_t arg1, uintp
         return ERR_INVALID_ARGUMENT;
     }
 
-    scheduler_running()->begin_syscall(syscall);
+    Task *task = scheduler_running();
+
+    trace_record(TRACE_EVENT_SYSCALL_ENTER, task->id, syscall);
+
+    task->begin_syscall(syscall);
     result = handler(arg0, arg1, arg2, arg3, arg4);
-    scheduler_running()->end_syscall();
+    task->end_syscall();
+
+    trace_record(TRACE_EVENT_SYSCALL_EXIT, task->id, syscall, result);
 
     if (result != SUCCESS && result != TIMEOUT)
     {
@@ -4,4 +4,6 @@
 
 #include <libsystem/Common.h>
 
+bool syscall_validate_ptr(uintptr_t ptr, size_t size);
+
 uintptr_t task_do_syscall(Syscall syscall, uintptr_t arg0, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t arg4);
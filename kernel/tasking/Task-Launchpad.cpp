@@ -18,7 +18,28 @@ struct ELFLoader
     using Program = TELFFormat::Program;
     using Symbole = TELFFormat::Symbole;
 
-    static Result load_program(Task *task, Stream *elf_file, Program *program_header)
+    // Read-only segments are mapped straight from the file, every
+    // tasks running the same program share their physical pages.
+    static bool map_program(Task *task, RefPtr<FsNode> elf_node, Program *program_header)
+    {
+        if (!elf_node ||
+            (program_header->flags & ELF_PROGRAM_W) ||
+            program_header->filesz != program_header->memsz ||
+            program_header->vaddr % ARCH_PAGE_SIZE != program_header->offset % ARCH_PAGE_SIZE)
+        {
+            return false;
+        }
+
+        uintptr_t address = __align_down(program_header->vaddr, ARCH_PAGE_SIZE);
+        size_t offset = __align_down(program_header->offset, ARCH_PAGE_SIZE);
+        size_t size = PAGE_ALIGN_UP(program_header->vaddr + program_header->memsz) - address;
+
+        uintptr_t mapped = 0;
+
+        return task_memory_map_node(task, elf_node, offset, size, address, MEMORY_READONLY, &mapped) == SUCCESS;
+    }
+
+    static Result load_program(Task *task, Stream *elf_file, RefPtr<FsNode> elf_node, Program *program_header)
     {
         if (program_header->vaddr == 0)
         {
@@ -31,7 +52,12 @@ struct ELFLoader
             return ERR_EXEC_FORMAT_ERROR;
         }
 
-        void *parent_address_space = task_switch_address_space(scheduler_running(), task->address_space);
+        if (map_program(task, elf_node, program_header))
+        {
+            return SUCCESS;
+        }
+
+        Task *previous_owner = task_switch_address_space(scheduler_running(), task);
 
         MemoryRange range = MemoryRange::around_non_aligned_address(program_header->vaddr, program_header->memsz);
 
@@ -44,19 +70,19 @@ struct ELFLoader
         {
             logger_error("Didn't read the right amount from the ELF file!");
 
-            task_switch_address_space(scheduler_running(), parent_address_space);
+            task_switch_address_space(scheduler_running(), previous_owner);
 
             return ERR_EXEC_FORMAT_ERROR;
         }
         else
         {
-            task_switch_address_space(scheduler_running(), parent_address_space);
+            task_switch_address_space(scheduler_running(), previous_owner);
 
             return SUCCESS;
         }
     }
 
-    static Result load(Task *task, Stream *elf_file)
+    static Result load(Task *task, Stream *elf_file, RefPtr<FsNode> elf_node)
     {
         Header elf_header;
         size_t elf_header_size = stream_read(elf_file, &elf_header, sizeof(Header));
@@ -78,7 +104,7 @@ struct ELFLoader
                 return ERR_EXEC_FORMAT_ERROR;
             }
 
-            TRY(load_program(task, elf_file, &elf_program_header));
+            TRY(load_program(task, elf_file, elf_node, &elf_program_header));
         }
 
         return SUCCESS;
@@ -87,7 +113,7 @@ struct ELFLoader
 
 void task_pass_argc_argv_env(Task *task, Launchpad *launchpad)
 {
-    void *parent_address_space = task_switch_address_space(scheduler_running(), task->address_space);
+    Task *previous_owner = task_switch_address_space(scheduler_running(), task);
 
     uintptr_t argv_list[PROCESS_ARG_COUNT] = {};
 
@@ -106,7 +132,7 @@ void task_pass_argc_argv_env(Task *task, Launchpad *launchpad)
     task_user_stack_push_ptr(task, (void *)argv_list_ref);
     task_user_stack_push_long(task, launchpad->argc);
 
-    task_switch_address_space(scheduler_running(), parent_address_space);
+    task_switch_address_space(scheduler_running(), previous_owner);
 }
 
 void task_pass_handles(Task *parent_task, Task *child_task, Launchpad *launchpad)
@@ -116,7 +142,7 @@ void task_pass_handles(Task *parent_task, Task *child_task, Launchpad *launchpad
         int child_handle_id = i;
         int parent_handle_id = launchpad->handles[i];
 
-        if (parent_handle_id >= 0 && parent_handle_id < PROCESS_HANDLE_COUNT)
+        if (parent_task->handles().exists(parent_handle_id))
         {
             assert(parent_task->handles().pass(child_task->handles(), parent_handle_id, child_handle_id) == SUCCESS);
         }
@@ -141,10 +167,12 @@ Result task_launch(Task *parent_task, Launchpad *launchpad, int *pid)
     Task *task = task_create(parent_task, launchpad->name, true);
     interrupts_release();
 
+    auto elf_node = scheduler_running()->domain().find(Path::parse(launchpad->executable));
+
 #ifdef __x86_64__
-    Result result = ELFLoader<ELF64>::load(task, elf_file);
+    Result result = ELFLoader<ELF64>::load(task, elf_file, elf_node);
 #else
-    Result result = ELFLoader<ELF32>::load(task, elf_file);
+    Result result = ELFLoader<ELF32>::load(task, elf_file, elf_node);
 #endif
 
     if (result != SUCCESS)
@@ -178,10 +206,12 @@ Result task_exec(Task *task, Launchpad *launchpad)
 
     task_clear_userspace(task);
 
+    auto elf_node = scheduler_running()->domain().find(Path::parse(launchpad->executable));
+
 #ifdef __x86_64__
-    Result result = ELFLoader<ELF64>::load(task, elf_file);
+    Result result = ELFLoader<ELF64>::load(task, elf_file, elf_node);
 #else
-    Result result = ELFLoader<ELF32>::load(task, elf_file);
+    Result result = ELFLoader<ELF32>::load(task, elf_file, elf_node);
 #endif
 
     if (result != SUCCESS)
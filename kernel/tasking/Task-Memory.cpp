@@ -1,10 +1,15 @@
+#include <libsystem/math/MinMax.h>
 #include <string.h>
 
 #include "archs/VirtualMemory.h"
 
 #include "kernel/interrupts/Interupts.h"
+#include "kernel/memory/Slab.h"
+#include "kernel/scheduling/Scheduler.h"
 #include "kernel/tasking/Task-Memory.h"
 
+static SlabCache _memory_mapping_cache{"MemoryMapping", sizeof(MemoryMapping)};
+
 static bool will_i_be_kill_if_i_allocate_that(Task *task, size_t size)
 {
     auto usage = task_memory_usage(task);
@@ -28,74 +33,473 @@ static void kill_me_if_too_greedy(Task *task, size_t size)
     }
 }
 
-MemoryMapping *task_memory_mapping_create(Task *task, MemoryObject *memory_object)
+static MemoryFlags task_memory_mapping_flags(MemoryMapping *memory_mapping)
 {
-    InterruptsRetainer retainer;
+    if (memory_mapping->readonly || memory_mapping->copy_on_write)
+    {
+        return MEMORY_USER | MEMORY_READONLY;
+    }
 
-    auto memory_mapping = __create(MemoryMapping);
+    return MEMORY_USER;
+}
 
-    memory_mapping->object = memory_object_ref(memory_object);
-    memory_mapping->address = arch_virtual_alloc(task->address_space, memory_object->range(), MEMORY_USER).base();
-    memory_mapping->size = memory_object->range().size();
+// Map the pages of the object which are already backed, the others are faulted in.
+static void task_memory_mapping_map_resident(Task *task, MemoryMapping *memory_mapping)
+{
+    auto memory_object = memory_mapping->object;
 
-    list_pushback(task->memory_mapping, memory_mapping);
+    SpinlockHolder holder(memory_lock);
 
-    return memory_mapping;
+    size_t first = memory_mapping->offset / ARCH_PAGE_SIZE;
+    size_t end = MIN(first + memory_mapping->size / ARCH_PAGE_SIZE, memory_object->page_count());
+
+    size_t i = first;
+
+    while (i < end)
+    {
+        if (!memory_object->pages[i])
+        {
+            i++;
+            continue;
+        }
+
+        // Map physically contiguous pages in one go.
+        size_t count = 1;
+
+        while (i + count < end &&
+               memory_object->pages[i + count] == memory_object->pages[i] + count * ARCH_PAGE_SIZE)
+        {
+            count++;
+        }
+
+        MemoryRange physical_range{memory_object->pages[i], count * ARCH_PAGE_SIZE};
+        uintptr_t address = memory_mapping->address + (i - first) * ARCH_PAGE_SIZE;
+
+        assert(SUCCESS == arch_virtual_map(task->address_space, physical_range, address, task_memory_mapping_flags(memory_mapping)));
+
+        i += count;
+    }
 }
 
-MemoryMapping *task_memory_mapping_create_at(Task *task, MemoryObject *memory_object, uintptr_t address)
+/* --- Mappings index ------------------------------------------------------ */
+
+static int task_memory_mapping_height(MemoryMapping *node)
+{
+    return node ? node->height : 0;
+}
+
+static void task_memory_mapping_update(MemoryMapping *node)
+{
+    node->height = 1 + MAX(task_memory_mapping_height(node->left), task_memory_mapping_height(node->right));
+}
+
+static MemoryMapping *task_memory_mapping_rotate_right(MemoryMapping *node)
+{
+    MemoryMapping *left = node->left;
+
+    node->left = left->right;
+    left->right = node;
+
+    task_memory_mapping_update(node);
+    task_memory_mapping_update(left);
+
+    return left;
+}
+
+static MemoryMapping *task_memory_mapping_rotate_left(MemoryMapping *node)
+{
+    MemoryMapping *right = node->right;
+
+    node->right = right->left;
+    right->left = node;
+
+    task_memory_mapping_update(node);
+    task_memory_mapping_update(right);
+
+    return right;
+}
+
+static MemoryMapping *task_memory_mapping_balance(MemoryMapping *node)
+{
+    task_memory_mapping_update(node);
+
+    int balance = task_memory_mapping_height(node->left) - task_memory_mapping_height(node->right);
+
+    if (balance > 1)
+    {
+        if (task_memory_mapping_height(node->left->left) < task_memory_mapping_height(node->left->right))
+        {
+            node->left = task_memory_mapping_rotate_left(node->left);
+        }
+
+        return task_memory_mapping_rotate_right(node);
+    }
+
+    if (balance < -1)
+    {
+        if (task_memory_mapping_height(node->right->right) < task_memory_mapping_height(node->right->left))
+        {
+            node->right = task_memory_mapping_rotate_right(node->right);
+        }
+
+        return task_memory_mapping_rotate_left(node);
+    }
+
+    return node;
+}
+
+static MemoryMapping *task_memory_mapping_insert(MemoryMapping *root, MemoryMapping *node)
+{
+    if (!root)
+    {
+        node->left = nullptr;
+        node->right = nullptr;
+        node->height = 1;
+
+        return node;
+    }
+
+    if (node->address < root->address)
+    {
+        root->left = task_memory_mapping_insert(root->left, node);
+    }
+    else
+    {
+        root->right = task_memory_mapping_insert(root->right, node);
+    }
+
+    return task_memory_mapping_balance(root);
+}
+
+static MemoryMapping *task_memory_mapping_remove_min(MemoryMapping *root, MemoryMapping **min)
+{
+    if (!root->left)
+    {
+        *min = root;
+        return root->right;
+    }
+
+    root->left = task_memory_mapping_remove_min(root->left, min);
+
+    return task_memory_mapping_balance(root);
+}
+
+static MemoryMapping *task_memory_mapping_remove(MemoryMapping *root, MemoryMapping *node)
+{
+    if (node->address < root->address)
+    {
+        root->left = task_memory_mapping_remove(root->left, node);
+    }
+    else if (node->address > root->address)
+    {
+        root->right = task_memory_mapping_remove(root->right, node);
+    }
+    else
+    {
+        MemoryMapping *left = root->left;
+        MemoryMapping *right = root->right;
+
+        if (!right)
+        {
+            return left;
+        }
+
+        MemoryMapping *min = nullptr;
+        right = task_memory_mapping_remove_min(right, &min);
+
+        min->left = left;
+        min->right = right;
+
+        return task_memory_mapping_balance(min);
+    }
+
+    return task_memory_mapping_balance(root);
+}
+
+// Find a mapping overlapping [address, address + size), mappings never overlap each others.
+static MemoryMapping *task_memory_mapping_overlapping(Task *task, uintptr_t address, size_t size)
+{
+    MemoryMapping *node = task->memory_mappings;
+
+    while (node)
+    {
+        if (address + size <= node->address)
+        {
+            node = node->left;
+        }
+        else if (address >= node->address + node->size)
+        {
+            node = node->right;
+        }
+        else
+        {
+            return node;
+        }
+    }
+
+    return nullptr;
+}
+
+static void task_memory_mapping_add(Task *task, MemoryMapping *memory_mapping)
+{
+    task->memory_mappings = task_memory_mapping_insert(task->memory_mappings, memory_mapping);
+    task->memory_usage += memory_mapping->size;
+}
+
+static Iteration task_memory_mapping_iterate_node(MemoryMapping *node, void *target, MemoryMappingIterateCallback callback)
+{
+    if (!node)
+    {
+        return Iteration::CONTINUE;
+    }
+
+    if (task_memory_mapping_iterate_node(node->left, target, callback) == Iteration::STOP ||
+        callback(target, node) == Iteration::STOP)
+    {
+        return Iteration::STOP;
+    }
+
+    return task_memory_mapping_iterate_node(node->right, target, callback);
+}
+
+void task_memory_mapping_iterate(Task *task, void *target, MemoryMappingIterateCallback callback)
+{
+    task_memory_mapping_iterate_node(task->memory_mappings, target, callback);
+}
+
+/* --- Mappings ------------------------------------------------------------- */
+
+// Map `size` bytes of the object from `offset` at `address`, or anywhere if it's zero.
+static MemoryMapping *task_memory_mapping_create_range(Task *task, MemoryObject *memory_object, size_t offset, size_t size, uintptr_t address, bool copy_on_write, bool readonly)
 {
     InterruptsRetainer retainer;
 
-    auto memory_mapping = __create(MemoryMapping);
+    auto memory_mapping = reinterpret_cast<MemoryMapping *>(slab_alloc(&_memory_mapping_cache));
 
     memory_mapping->object = memory_object_ref(memory_object);
-    memory_mapping->address = address;
-    memory_mapping->size = memory_object->range().size();
+    memory_mapping->offset = offset;
+    memory_mapping->size = size;
+    memory_mapping->copy_on_write = copy_on_write;
+    memory_mapping->readonly = readonly;
 
-    assert(SUCCESS == arch_virtual_map(task->address_space, memory_object->range(), address, MEMORY_USER));
+    {
+        SpinlockHolder holder(memory_lock);
 
-    list_pushback(task->memory_mapping, memory_mapping);
+        if (address)
+        {
+            memory_mapping->address = address;
+            arch_virtual_reserve_at(task->address_space, memory_mapping->range());
+        }
+        else
+        {
+            memory_mapping->address = arch_virtual_reserve(task->address_space, size, MEMORY_USER).base();
+        }
+    }
+
+    task_memory_mapping_map_resident(task, memory_mapping);
+
+    task_memory_mapping_add(task, memory_mapping);
 
     return memory_mapping;
 }
 
+MemoryMapping *task_memory_mapping_create(Task *task, MemoryObject *memory_object)
+{
+    return task_memory_mapping_create_range(task, memory_object, 0, memory_object->size, 0, false, false);
+}
+
+MemoryMapping *task_memory_mapping_create_at(Task *task, MemoryObject *memory_object, uintptr_t address)
+{
+    return task_memory_mapping_create_range(task, memory_object, 0, memory_object->size, address, false, false);
+}
+
 void task_memory_mapping_destroy(Task *task, MemoryMapping *memory_mapping)
 {
     InterruptsRetainer retainer;
 
-    arch_virtual_free(task->address_space, (MemoryRange){memory_mapping->address, memory_mapping->size});
+    {
+        SpinlockHolder holder(memory_lock);
+        arch_virtual_free(task->address_space, (MemoryRange){memory_mapping->address, memory_mapping->size});
+    }
+
     memory_object_deref(memory_mapping->object);
 
-    list_remove(task->memory_mapping, memory_mapping);
-    free(memory_mapping);
+    task->memory_mappings = task_memory_mapping_remove(task->memory_mappings, memory_mapping);
+    task->memory_usage -= memory_mapping->size;
+    slab_free(&_memory_mapping_cache, memory_mapping);
 }
 
 MemoryMapping *task_memory_mapping_by_address(Task *task, uintptr_t address)
 {
-    list_foreach(MemoryMapping, memory_mapping, task->memory_mapping)
+    auto memory_mapping = task_memory_mapping_overlapping(task, address, 1);
+
+    if (memory_mapping && memory_mapping->address == address)
     {
-        if (memory_mapping->address == address)
-        {
-            return memory_mapping;
-        }
+        return memory_mapping;
     }
 
     return nullptr;
 }
 
+static MemoryMapping *task_memory_mapping_containing(Task *task, uintptr_t address)
+{
+    return task_memory_mapping_overlapping(task, address, 1);
+}
+
 bool task_memory_mapping_colides(Task *task, uintptr_t address, size_t size)
 {
-    list_foreach(MemoryMapping, memory_mapping, task->memory_mapping)
+    return task_memory_mapping_overlapping(task, address, size) != nullptr;
+}
+
+/* --- Page faults --------------------------------------------------------- */
+
+static void task_memory_clone_mapping(Task *parent, Task *child, MemoryMapping *memory_mapping)
+{
+    if (memory_mapping->readonly)
+    {
+        task_memory_mapping_create_range(child, memory_mapping->object, memory_mapping->offset, memory_mapping->size, memory_mapping->address, false, true);
+
+        return;
+    }
+
+    // Other tasks must keep seeing the writes of the parent, so
+    // the child gets its own copy of shared objects right away.
+    if (memory_mapping->object->shared)
+    {
+        auto copy = memory_object_copy(memory_mapping->object, memory_mapping->offset, memory_mapping->size);
+        task_memory_mapping_create_at(child, copy, memory_mapping->address);
+        memory_object_deref(copy);
+
+        return;
+    }
+
+    task_memory_mapping_create_range(child, memory_mapping->object, memory_mapping->offset, memory_mapping->size, memory_mapping->address, true, false);
+
+    if (!memory_mapping->copy_on_write)
+    {
+        memory_mapping->copy_on_write = true;
+        task_memory_mapping_map_resident(parent, memory_mapping);
+    }
+}
+
+static void task_memory_clone_mappings(Task *parent, Task *child, MemoryMapping *node)
+{
+    if (!node)
+    {
+        return;
+    }
+
+    task_memory_clone_mappings(parent, child, node->left);
+    task_memory_clone_mapping(parent, child, node);
+    task_memory_clone_mappings(parent, child, node->right);
+}
+
+void task_memory_clone(Task *parent, Task *child)
+{
+    InterruptsRetainer retainer;
+
+    task_memory_clone_mappings(parent, child, parent->memory_mappings);
+}
+
+static void task_memory_mapping_break_copy_on_write(Task *task, MemoryMapping *memory_mapping)
+{
+    auto memory_object = memory_mapping->object;
+
+    // If the other tasks sharing the object already made their
+    // own copy or exited, this one can keep it for itself.
+    if (__atomic_load_n(&memory_object->refcount, __ATOMIC_SEQ_CST) > 1)
+    {
+        memory_mapping->object = memory_object_copy(memory_object, memory_mapping->offset, memory_mapping->size);
+        memory_mapping->offset = 0;
+        memory_object_deref(memory_object);
+
+        task->cow_faults++;
+    }
+
+    memory_mapping->copy_on_write = false;
+
+    task_memory_mapping_map_resident(task, memory_mapping);
+}
+
+bool task_memory_handle_fault(Task *task, uintptr_t address)
+{
+    if (!task)
     {
-        if (address < memory_mapping->address + memory_mapping->size &&
-            address + size > memory_mapping->address)
+        return false;
+    }
+
+    InterruptsRetainer retainer;
+
+    // The kernel might be setting up the memory of another task.
+    if (task->address_space_owner)
+    {
+        task = task->address_space_owner;
+    }
+
+    auto memory_mapping = task_memory_mapping_containing(task, address);
+
+    if (!memory_mapping)
+    {
+        return false;
+    }
+
+    // Pages are never backed while shared copy-on-write,
+    // so the other tasks keep seeing them empty.
+    bool was_copy_on_write = memory_mapping->copy_on_write;
+
+    if (was_copy_on_write)
+    {
+        task_memory_mapping_break_copy_on_write(task, memory_mapping);
+    }
+
+    uintptr_t page_address = __align_down(address, ARCH_PAGE_SIZE);
+    size_t first_index = memory_mapping->offset / ARCH_PAGE_SIZE;
+    size_t index = first_index + (page_address - memory_mapping->address) / ARCH_PAGE_SIZE;
+
+    {
+        SpinlockHolder holder(memory_lock);
+
+        // Either the page was only read-only because of copy-on-write,
+        // or that's a real protection fault.
+        if (arch_virtual_present(task->address_space, page_address))
+        {
+            return was_copy_on_write;
+        }
+
+        if (!memory_mapping->object->pages[index])
         {
-            return true;
+            task->demand_faults++;
         }
     }
 
-    return false;
+    uintptr_t physical_page = memory_object_page(memory_mapping->object, index);
+
+    if (!physical_page)
+    {
+        return false;
+    }
+
+    SpinlockHolder holder(memory_lock);
+
+    // Bring in the whole large page at once, the arch maps it with a single entry if it's aligned.
+    size_t first = 0;
+    auto large_page = memory_object_large_page(memory_mapping->object, index, &first);
+
+    bool large_page_in_mapping = first >= first_index &&
+                                 (first - first_index) * ARCH_PAGE_SIZE + large_page.size() <= memory_mapping->size;
+
+    MemoryFlags flags = task_memory_mapping_flags(memory_mapping);
+
+    if (!large_page.empty() && large_page_in_mapping)
+    {
+        assert(SUCCESS == arch_virtual_map(task->address_space, large_page, memory_mapping->address + (first - first_index) * ARCH_PAGE_SIZE, flags));
+    }
+    else
+    {
+        assert(SUCCESS == arch_virtual_map(task->address_space, {physical_page, ARCH_PAGE_SIZE}, page_address, flags));
+    }
+
+    return true;
 }
 
 /* --- User facing API ------------------------------------------------------ */
@@ -117,6 +521,9 @@ Result task_memory_alloc(Task *task, size_t size, uintptr_t *out_address)
 
 Result task_memory_map(Task *task, uintptr_t address, size_t size, MemoryFlags flags)
 {
+    // Pages are cleared when they are touched for the first time, so MEMORY_CLEAR is implied.
+    __unused(flags);
+
     kill_me_if_too_greedy(task, size);
 
     if (task_memory_mapping_colides(task, address, size))
@@ -130,11 +537,6 @@ Result task_memory_map(Task *task, uintptr_t address, size_t size, MemoryFlags f
 
     memory_object_deref(memory_object);
 
-    if (flags & MEMORY_CLEAR)
-    {
-        memset((void *)address, 0, size);
-    }
-
     return SUCCESS;
 }
 
@@ -152,6 +554,21 @@ Result task_memory_free(Task *task, uintptr_t address)
     return SUCCESS;
 }
 
+Result task_memory_include_object(Task *task, MemoryObject *memory_object, uintptr_t *out_address, size_t *out_size)
+{
+    if (will_i_be_kill_if_i_allocate_that(task, memory_object->size))
+    {
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    auto memory_mapping = task_memory_mapping_create(task, memory_object);
+
+    *out_address = memory_mapping->address;
+    *out_size = memory_mapping->size;
+
+    return SUCCESS;
+}
+
 Result task_memory_include(Task *task, int handle, uintptr_t *out_address, size_t *out_size)
 {
     auto memory_object = memory_object_by_id(handle);
@@ -161,23 +578,54 @@ Result task_memory_include(Task *task, int handle, uintptr_t *out_address, size_
         return ERR_BAD_ADDRESS;
     }
 
-    if (will_i_be_kill_if_i_allocate_that(task, memory_object->range().size()))
+    kill_me_if_too_greedy(task, memory_object->size);
+
+    Result result = task_memory_include_object(task, memory_object, out_address, out_size);
+
+    memory_object_deref(memory_object);
+
+    return result;
+}
+
+Result task_memory_map_node(Task *task, RefPtr<FsNode> node, size_t offset, size_t size, uintptr_t address, MemoryFlags flags, uintptr_t *out_address)
+{
+    if (offset % ARCH_PAGE_SIZE != 0 || address % ARCH_PAGE_SIZE != 0 || size == 0)
     {
-        memory_object_deref(memory_object);
-        kill_me_if_too_greedy(task, memory_object->range().size());
+        return ERR_INVALID_ARGUMENT;
     }
 
-    auto memory_mapping = task_memory_mapping_create(task, memory_object);
+    size = PAGE_ALIGN_UP(size);
 
-    memory_object_deref(memory_object);
+    if (address && task_memory_mapping_colides(task, address, size))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    node->acquire(scheduler_running_id());
+
+    auto memory_object = node->memory_object();
+
+    if (!memory_object)
+    {
+        node->release(scheduler_running_id());
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    // Past the end of the file the mapping reads zeros.
+    memory_object_grow(memory_object, offset + size);
+
+    bool readonly = flags & MEMORY_READONLY;
+
+    auto memory_mapping = task_memory_mapping_create_range(task, memory_object, offset, size, address, !readonly, readonly);
+
+    node->release(scheduler_running_id());
 
     *out_address = memory_mapping->address;
-    *out_size = memory_mapping->size;
 
     return SUCCESS;
 }
 
-Result task_memory_get_handle(Task *task, uintptr_t address, int *out_handle)
+Result task_memory_object(Task *task, uintptr_t address, MemoryObject **out_memory_object)
 {
     auto memory_mapping = task_memory_mapping_by_address(task, address);
 
@@ -186,29 +634,67 @@ Result task_memory_get_handle(Task *task, uintptr_t address, int *out_handle)
         return ERR_BAD_ADDRESS;
     }
 
-    *out_handle = memory_mapping->object->id;
+    // That would give write access to the file.
+    if (memory_mapping->readonly)
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    if (memory_mapping->copy_on_write)
+    {
+        InterruptsRetainer retainer;
+        task_memory_mapping_break_copy_on_write(task, memory_mapping);
+    }
+
+    *out_memory_object = memory_mapping->object;
     return SUCCESS;
 }
 
-void *task_switch_address_space(Task *task, void *address_space)
+Result task_memory_share(Task *task, uintptr_t address, MemoryObject **out_memory_object)
 {
-    void *old_address_space = task->address_space;
+    TRY(task_memory_object(task, address, out_memory_object));
 
-    task->address_space = address_space;
+    (*out_memory_object)->shared = true;
 
-    arch_address_space_switch(address_space);
+    return SUCCESS;
+}
 
-    return old_address_space;
+Result task_memory_get_handle(Task *task, uintptr_t address, int *out_handle)
+{
+    MemoryObject *memory_object = nullptr;
+    TRY(task_memory_share(task, address, &memory_object));
+
+    *out_handle = memory_object->id;
+    return SUCCESS;
+}
+
+Task *task_switch_address_space(Task *task, Task *owner)
+{
+    InterruptsRetainer retainer;
+
+    Task *old_owner = task->address_space_owner;
+
+    task->address_space_owner = owner == task ? nullptr : owner;
+
+    arch_address_space_switch(task->current_address_space());
+
+    return old_owner;
 }
 
 size_t task_memory_usage(Task *task)
+{
+    return task->memory_usage;
+}
+
+size_t task_memory_resident(Task *task)
 {
     size_t total = 0;
 
-    list_foreach(MemoryMapping, memory_mapping, task->memory_mapping)
-    {
-        total += memory_mapping->size;
-    }
+    task_memory_mapping_iterate(task, &total, [](void *target, MemoryMapping *memory_mapping) {
+        *reinterpret_cast<size_t *>(target) += memory_mapping->object->resident * ARCH_PAGE_SIZE;
+
+        return Iteration::CONTINUE;
+    });
 
     return total;
 }
@@ -7,18 +7,45 @@ struct MemoryMapping
 {
     MemoryObject *object;
 
+    // Where the mapping starts in the object, a multiple of the page size.
+    size_t offset;
+
     uintptr_t address;
     size_t size;
 
+    // Mapped read-only, the object is shared with a clone
+    // and gets copied on the first write.
+    bool copy_on_write;
+
+    // Pages of a file which can never be written to, they
+    // stay shared with every other task mapping them.
+    bool readonly;
+
+    // Mappings of a task are indexed in a balanced tree sorted by address.
+    MemoryMapping *left;
+    MemoryMapping *right;
+    int height;
+
     MemoryRange range() { return {address, size}; }
 };
 
+typedef Iteration (*MemoryMappingIterateCallback)(void *target, MemoryMapping *memory_mapping);
+
 MemoryMapping *task_memory_mapping_create(Task *task, MemoryObject *memory_object);
 
 void task_memory_mapping_destroy(Task *task, MemoryMapping *memory_mapping);
 
 MemoryMapping *task_memory_mapping_by_address(Task *task, uintptr_t address);
 
+// Walk the mappings of `task` by increasing address.
+void task_memory_mapping_iterate(Task *task, void *target, MemoryMappingIterateCallback callback);
+
+void task_memory_clone(Task *parent, Task *child);
+
+// Bring in the page at `address` or copy memory shared copy-on-write,
+// returns false if the fault wasn't caused by one of those.
+bool task_memory_handle_fault(Task *task, uintptr_t address);
+
 Result task_memory_alloc(Task *task, size_t size, uintptr_t *out_address);
 
 Result task_memory_map(Task *task, uintptr_t address, size_t size, MemoryFlags flags);
@@ -27,8 +54,28 @@ Result task_memory_free(Task *task, uintptr_t address);
 
 Result task_memory_include(Task *task, int handle, uintptr_t *out_address, size_t *out_size);
 
+// Map the whole of `memory_object` in the address space of `task`, the mapping takes its own reference.
+// Unlike task_memory_include(), going over the memory limit of the task is an error, not a kill.
+Result task_memory_include_object(Task *task, MemoryObject *memory_object, uintptr_t *out_address, size_t *out_size);
+
+// Map `size` bytes of `node` from `offset`, read-only and shared with the other
+// tasks mapping it, or private and copied on the first access without MEMORY_READONLY.
+// The mapping is put at `address`, or anywhere if it's zero.
+Result task_memory_map_node(Task *task, RefPtr<FsNode> node, size_t offset, size_t size, uintptr_t address, MemoryFlags flags, uintptr_t *out_address);
+
+// The memory object behind the mapping at `address`, with its own copy of the
+// pages if they were copied on write. The caller takes a reference if it keeps it.
+Result task_memory_object(Task *task, uintptr_t address, MemoryObject **out_memory_object);
+
+// Like task_memory_object(), but the object is made shared so other tasks see the writes of this one.
+Result task_memory_share(Task *task, uintptr_t address, MemoryObject **out_memory_object);
+
 Result task_memory_get_handle(Task *task, uintptr_t address, int *out_handle);
 
-void *task_switch_address_space(Task *task, void *address_space);
+// Run `task` in the address space of `owner`, so the kernel can setup its
+// memory, returns the previous owner. Passing nullptr gets back to its own.
+Task *task_switch_address_space(Task *task, Task *owner);
 
 size_t task_memory_usage(Task *task);
+
+size_t task_memory_resident(Task *task);
@@ -0,0 +1,577 @@
+#include <libsystem/math/MinMax.h>
+#include <libutils/Vector.h>
+
+#include "kernel/interrupts/Interupts.h"
+#include "kernel/scheduling/Blocker.h"
+#include "kernel/scheduling/Scheduler.h"
+#include "kernel/system/System.h"
+#include "kernel/tasking/Syscalls.h"
+#include "kernel/tasking/Task-Memory.h"
+#include "kernel/tasking/Task-Ring.h"
+
+struct TaskRing;
+
+// Like the interests of a poller, pending polls are woken up by their node,
+// so entering the ring only looks at the ones which might be ready.
+struct RingPoll
+{
+    TaskRing *ring;
+
+    uint64_t user_data;
+    int handle;
+    PollEvent events;
+
+    // Completed with INTERRUPTED as soon as there is room for it.
+    bool canceled;
+
+    // Keeps the node and its wait queue alive, but not the handle.
+    RefPtr<FsNode> node;
+    WaitQueueEntry entry;
+
+    bool ready;
+    RingPoll *prev_ready;
+    RingPoll *next_ready;
+
+    // The other polls pending on the same handle.
+    RingPoll *prev_same_handle;
+    RingPoll *next_same_handle;
+};
+
+// The header lives in memory the task can write to, so the kernel keeps
+// its own copy of the indexes it moves and of the size of each ring.
+struct TaskRing
+{
+    uintptr_t address;
+    size_t size;
+
+    uint32_t submission_count;
+    uint32_t submission_head;
+
+    uint32_t completion_count;
+    uint32_t completion_tail;
+
+    // Pending polls, indexed by handle, the ready ones are also queued
+    // until the task enters the ring, where it waits for them.
+    Vector<RingPoll *> polls;
+    size_t polls_count;
+
+    RingPoll *ready_head;
+    RingPoll *ready_tail;
+
+    WaitQueue wait_queue;
+
+    RingHeader *header() { return reinterpret_cast<RingHeader *>(address); }
+
+    RingSubmission *submissions() { return reinterpret_cast<RingSubmission *>(header() + 1); }
+
+    RingCompletion *completions() { return reinterpret_cast<RingCompletion *>(submissions() + submission_count); }
+};
+
+static size_t task_ring_round_up(size_t entries)
+{
+    size_t count = 1;
+
+    while (count < entries)
+    {
+        count *= 2;
+    }
+
+    return count;
+}
+
+Result task_ring_setup(Task *task, size_t entries, uintptr_t *out_address)
+{
+    if (entries == 0 || entries > RING_MAX_ENTRIES)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    // One ring per task, a new one can be setup once the memory of the last one is freed.
+    if (task->ring && task_memory_mapping_by_address(task, task->ring->address))
+    {
+        return ERR_FILE_EXISTS;
+    }
+
+    task_ring_destroy(task);
+
+    auto ring = new TaskRing{};
+
+    ring->submission_count = task_ring_round_up(entries);
+    ring->completion_count = ring->submission_count * 2;
+    ring->size = PAGE_ALIGN_UP(ring_size(ring->submission_count, ring->completion_count));
+
+    auto memory_object = memory_object_create(ring->size);
+    auto memory_mapping = task_memory_mapping_create(task, memory_object);
+    memory_object_deref(memory_object);
+
+    ring->address = memory_mapping->address;
+
+    auto header = ring->header();
+    header->submission_count = ring->submission_count;
+    header->completion_count = ring->completion_count;
+
+    task->ring = ring;
+
+    *out_address = ring->address;
+
+    return SUCCESS;
+}
+
+static void task_ring_remove_poll(TaskRing *ring, RingPoll *poll);
+
+void task_ring_destroy(Task *task)
+{
+    auto ring = task->ring;
+
+    if (!ring)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < ring->polls.count(); i++)
+    {
+        while (ring->polls[i])
+        {
+            task_ring_remove_poll(ring, ring->polls[i]);
+        }
+    }
+
+    delete ring;
+    task->ring = nullptr;
+}
+
+/* --- Completions ---------------------------------------------------------- */
+
+static size_t task_ring_waiting(TaskRing *ring)
+{
+    uint32_t head = __atomic_load_n(&ring->header()->completion_head, __ATOMIC_ACQUIRE);
+
+    // A head the task moved past what was completed makes the ring look full.
+    return MIN(ring->completion_tail - head, ring->completion_count);
+}
+
+static size_t task_ring_room(TaskRing *ring)
+{
+    return ring->completion_count - task_ring_waiting(ring);
+}
+
+static void task_ring_complete(TaskRing *ring, uint64_t user_data, Result result, size_t value)
+{
+    assert(task_ring_room(ring) > 0);
+
+    auto &completion = ring->completions()[ring->completion_tail & (ring->completion_count - 1)];
+
+    completion.user_data = user_data;
+    completion.result = result;
+    completion.value = value;
+
+    ring->completion_tail++;
+    __atomic_store_n(&ring->header()->completion_tail, ring->completion_tail, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+static void task_ring_complete(TaskRing *ring, uint64_t user_data, ResultOr<T> result_or_value)
+{
+    if (result_or_value.success())
+    {
+        task_ring_complete(ring, user_data, SUCCESS, (size_t)result_or_value.value());
+    }
+    else
+    {
+        task_ring_complete(ring, user_data, result_or_value.result(), 0);
+    }
+}
+
+/* --- Polls ---------------------------------------------------------------- */
+
+static void task_ring_push_ready(RingPoll *poll)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    if (poll->ready)
+    {
+        return;
+    }
+
+    auto ring = poll->ring;
+
+    poll->ready = true;
+    poll->prev_ready = ring->ready_tail;
+    poll->next_ready = nullptr;
+
+    if (ring->ready_tail)
+    {
+        ring->ready_tail->next_ready = poll;
+    }
+    else
+    {
+        ring->ready_head = poll;
+    }
+
+    ring->ready_tail = poll;
+}
+
+static void task_ring_remove_ready(RingPoll *poll)
+{
+    ASSERT_INTERRUPTS_RETAINED();
+
+    if (!poll->ready)
+    {
+        return;
+    }
+
+    auto ring = poll->ring;
+
+    if (poll->prev_ready)
+    {
+        poll->prev_ready->next_ready = poll->next_ready;
+    }
+    else
+    {
+        ring->ready_head = poll->next_ready;
+    }
+
+    if (poll->next_ready)
+    {
+        poll->next_ready->prev_ready = poll->prev_ready;
+    }
+    else
+    {
+        ring->ready_tail = poll->prev_ready;
+    }
+
+    poll->ready = false;
+    poll->prev_ready = nullptr;
+    poll->next_ready = nullptr;
+}
+
+static void task_ring_wake_up(void *target)
+{
+    auto poll = reinterpret_cast<RingPoll *>(target);
+
+    task_ring_push_ready(poll);
+    poll->ring->wait_queue.wake_up();
+}
+
+static void task_ring_add_poll(Task *task, TaskRing *ring, RingSubmission &submission)
+{
+    auto handle = task->handles().find(submission.handle);
+
+    if (!handle)
+    {
+        task_ring_complete(ring, submission.user_data, ERR_BAD_HANDLE, 0);
+        return;
+    }
+
+    auto poll = new RingPoll{};
+
+    poll->ring = ring;
+    poll->user_data = submission.user_data;
+    poll->handle = submission.handle;
+    poll->events = submission.events;
+    poll->node = handle->node();
+
+    while (ring->polls.count() <= (size_t)poll->handle)
+    {
+        ring->polls.push_back(nullptr);
+    }
+
+    poll->next_same_handle = ring->polls[poll->handle];
+
+    if (poll->next_same_handle)
+    {
+        poll->next_same_handle->prev_same_handle = poll;
+    }
+
+    ring->polls[poll->handle] = poll;
+    ring->polls_count++;
+
+    // The node might be ready already, the task will look at it before waiting.
+    InterruptsRetainer retainer;
+    poll->node->wait_queue().add(poll->entry, task_ring_wake_up, poll);
+    task_ring_push_ready(poll);
+}
+
+static void task_ring_remove_poll(TaskRing *ring, RingPoll *poll)
+{
+    {
+        InterruptsRetainer retainer;
+
+        task_ring_remove_ready(poll);
+        poll->node->wait_queue().remove(poll->entry);
+    }
+
+    if (poll->prev_same_handle)
+    {
+        poll->prev_same_handle->next_same_handle = poll->next_same_handle;
+    }
+    else
+    {
+        ring->polls[poll->handle] = poll->next_same_handle;
+    }
+
+    if (poll->next_same_handle)
+    {
+        poll->next_same_handle->prev_same_handle = poll->prev_same_handle;
+    }
+
+    ring->polls_count--;
+
+    delete poll;
+}
+
+// Queue the polls on `handle` to be looked at on the next enter.
+static size_t task_ring_wake_polls(TaskRing *ring, int handle, bool cancel)
+{
+    if (handle < 0 || (size_t)handle >= ring->polls.count())
+    {
+        return 0;
+    }
+
+    size_t count = 0;
+
+    InterruptsRetainer retainer;
+
+    for (auto poll = ring->polls[handle]; poll; poll = poll->next_same_handle)
+    {
+        if (cancel && poll->canceled)
+        {
+            continue;
+        }
+
+        poll->canceled = poll->canceled || cancel;
+        task_ring_push_ready(poll);
+        count++;
+    }
+
+    return count;
+}
+
+static size_t task_ring_cancel_polls(TaskRing *ring, int handle)
+{
+    return task_ring_wake_polls(ring, handle, true);
+}
+
+void task_ring_handle_closed(Task *task, int handle)
+{
+    if (task->ring)
+    {
+        task_ring_wake_polls(task->ring, handle, false);
+    }
+}
+
+// Complete the polls woken up since the last time, as long as there is room.
+static void task_ring_complete_ready(Task *task, TaskRing *ring)
+{
+    auto &handles = task->handles();
+
+    while (task_ring_room(ring) > 0)
+    {
+        RingPoll *poll = nullptr;
+
+        {
+            InterruptsRetainer retainer;
+
+            poll = ring->ready_head;
+
+            if (poll)
+            {
+                task_ring_remove_ready(poll);
+            }
+        }
+
+        if (!poll)
+        {
+            return;
+        }
+
+        if (poll->canceled)
+        {
+            task_ring_complete(ring, poll->user_data, INTERRUPTED, 0);
+            task_ring_remove_poll(ring, poll);
+            continue;
+        }
+
+        auto handle = handles.find(poll->handle);
+
+        // The handle was closed, and maybe its index reused for another node.
+        if (!handle || handle->node().naked() != poll->node.naked())
+        {
+            task_ring_complete(ring, poll->user_data, ERR_BAD_HANDLE, 0);
+            task_ring_remove_poll(ring, poll);
+            continue;
+        }
+
+        PollEvent result = handle->poll(poll->events);
+
+        // Still pending, its node wakes it up again when it changes.
+        if (result == 0)
+        {
+            continue;
+        }
+
+        task_ring_complete(ring, poll->user_data, SUCCESS, result);
+        task_ring_remove_poll(ring, poll);
+    }
+}
+
+class BlockerRing : public Blocker
+{
+private:
+    TaskRing *_ring;
+
+public:
+    BlockerRing(TaskRing *ring) : _ring(ring) {}
+
+    bool can_unblock(Task &) override
+    {
+        return __atomic_load_n(&_ring->ready_head, __ATOMIC_SEQ_CST) != nullptr;
+    }
+
+    void enqueue(Task &task) override
+    {
+        wait_on(_ring->wait_queue, task);
+    }
+};
+
+/* --- Submissions ---------------------------------------------------------- */
+
+static void task_ring_submit(Task *task, TaskRing *ring, RingSubmission &submission)
+{
+    auto &handles = task->handles();
+
+    bool needs_buffer = submission.operation == RING_READ ||
+                        submission.operation == RING_WRITE ||
+                        submission.operation == RING_CONNECT;
+
+    if (needs_buffer && !syscall_validate_ptr(submission.buffer, submission.size))
+    {
+        task_ring_complete(ring, submission.user_data, ERR_BAD_ADDRESS, 0);
+        return;
+    }
+
+    switch (submission.operation)
+    {
+    case RING_NOP:
+        task_ring_complete(ring, submission.user_data, SUCCESS, 0);
+        break;
+
+    case RING_READ:
+        task_ring_complete(ring, submission.user_data, handles.read(submission.handle, (void *)submission.buffer, submission.size));
+        break;
+
+    case RING_WRITE:
+        task_ring_complete(ring, submission.user_data, handles.write(submission.handle, (const void *)submission.buffer, submission.size));
+        break;
+
+    case RING_POLL:
+        task_ring_add_poll(task, ring, submission);
+        break;
+
+    case RING_POLL_CANCEL:
+        task_ring_complete(ring, submission.user_data, SUCCESS, task_ring_cancel_polls(ring, submission.handle));
+        break;
+
+    case RING_ACCEPT:
+        task_ring_complete(ring, submission.user_data, handles.accept(submission.handle));
+        break;
+
+    case RING_CONNECT:
+    {
+        auto path = Path::parse((const char *)submission.buffer, submission.size).normalized();
+        task_ring_complete(ring, submission.user_data, handles.connect(task->domain(), path));
+        break;
+    }
+
+    default:
+        task_ring_complete(ring, submission.user_data, ERR_FUNCTION_NOT_IMPLEMENTED, 0);
+        break;
+    }
+}
+
+/* --- Enter ---------------------------------------------------------------- */
+
+static bool task_ring_is_mapped(Task *task, TaskRing *ring)
+{
+    if (!ring)
+    {
+        return false;
+    }
+
+    // The task could have freed the memory of its ring.
+    auto memory_mapping = task_memory_mapping_by_address(task, ring->address);
+
+    return memory_mapping && memory_mapping->size >= ring->size;
+}
+
+Result task_ring_enter(Task *task, size_t to_submit, size_t min_complete, Timeout timeout)
+{
+    auto ring = task->ring;
+
+    if (!task_ring_is_mapped(task, ring))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    uint32_t submission_tail = __atomic_load_n(&ring->header()->submission_tail, __ATOMIC_ACQUIRE);
+    to_submit = MIN(to_submit, MIN(submission_tail - ring->submission_head, ring->submission_count));
+
+    // Submissions stay queued when there is no room for their completion.
+    for (size_t i = 0; i < to_submit && task_ring_room(ring) > 0; i++)
+    {
+        // Copied first, the task could change it while it's being run.
+        RingSubmission submission = ring->submissions()[ring->submission_head & (ring->submission_count - 1)];
+
+        ring->submission_head++;
+        __atomic_store_n(&ring->header()->submission_head, ring->submission_head, __ATOMIC_RELEASE);
+
+        task_ring_submit(task, ring, submission);
+    }
+
+    // Woken up polls might not be ready after all, the task waits
+    // again for the others with what remains of the timeout.
+    Tick start = system_get_tick();
+
+    while (true)
+    {
+        task_ring_complete_ready(task, ring);
+
+        if (task_ring_waiting(ring) >= min_complete)
+        {
+            return SUCCESS;
+        }
+
+        Timeout remaining = timeout;
+
+        if (timeout != (Timeout)-1)
+        {
+            remaining -= MIN(system_get_tick() - start, timeout);
+        }
+
+        if (remaining == 0)
+        {
+            return timeout == 0 ? SUCCESS : TIMEOUT;
+        }
+
+        // Nothing could complete anymore, like the timers of an event loop,
+        // waiting for no polls at all only waits for the timeout.
+        if (task_ring_room(ring) == 0)
+        {
+            return SUCCESS;
+        }
+
+        BlockerRing blocker{ring};
+        Result result = task_block(task, blocker, remaining);
+
+        if (result != SUCCESS && result != TIMEOUT)
+        {
+            return result;
+        }
+
+        // Another thread could have freed the memory of the ring meanwhile.
+        if (!task_ring_is_mapped(task, ring))
+        {
+            return ERR_BAD_ADDRESS;
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <abi/Ring.h>
+
+#include "kernel/tasking/Task.h"
+
+// Map a ring with room for `entries` submissions, and twice as many
+// completions, in the address space of `task`. See abi/Ring.h.
+Result task_ring_setup(Task *task, size_t entries, uintptr_t *out_address);
+
+// Run up to `to_submit` submissions, then wait at most `timeout` until
+// there are `min_complete` completions the task didn't consume yet.
+Result task_ring_enter(Task *task, size_t to_submit, size_t min_complete, Timeout timeout);
+
+// Pending polls on `handle` are completed with ERR_BAD_HANDLE on the next
+// enter, instead of waiting for their node, which may never change again.
+void task_ring_handle_closed(Task *task, int handle);
+
+// The mapping of the ring goes away with the others, this only drops the
+// pending polls, when the task exits or executes another program.
+void task_ring_destroy(Task *task);
@@ -8,7 +8,9 @@
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
+#include "kernel/system/Trace.h"
 #include "kernel/tasking/Task-Memory.h"
+#include "kernel/tasking/Task-Ring.h"
 #include "kernel/tasking/Task.h"
 
 static int _task_ids = 0;
@@ -23,6 +25,11 @@ void Task::state(TaskState state)
 {
     scheduler_did_change_task_state(this, _state, state);
     _state = state;
+
+    if (state == TASK_STATE_CANCELED)
+    {
+        _exit_wait_queue.wake_up();
+    }
 }
 
 void Task::interrupt()
@@ -34,6 +41,11 @@ void Task::interrupt()
     if (_blocker)
     {
         _blocker->interrupt(*this, INTERRUPTED);
+
+        if (_state == TASK_STATE_BLOCKED)
+        {
+            try_unblock();
+        }
     }
 }
 
@@ -104,22 +116,17 @@ Task *task_create(Task *parent, const char *name, bool user)
     if (parent)
         task->_domain = parent->_domain;
 
-    // Setup shms
-    task->memory_mapping = list_create();
-
     memory_alloc(task->address_space, PROCESS_STACK_SIZE, MEMORY_CLEAR, (uintptr_t *)&task->kernel_stack);
     task->kernel_stack_pointer = ((uintptr_t)task->kernel_stack + PROCESS_STACK_SIZE);
 
     if (user)
     {
-        void *parent_address_space = task_switch_address_space(scheduler_running(), task->address_space);
         task_memory_map(task, 0xff000000, PROCESS_STACK_SIZE, MEMORY_CLEAR | MEMORY_USER);
         task->user_stack_pointer = 0xff000000 + PROCESS_STACK_SIZE;
         task->user_stack = (void *)0xff000000;
-        task_switch_address_space(scheduler_running(), parent_address_space);
     }
 
-    arch_save_context(task);
+    arch_initialize_context(task);
 
     list_pushback(_tasks, task);
 
@@ -143,46 +150,23 @@ Task *task_clone(Task *parent, uintptr_t sp, uintptr_t ip)
 
     task->address_space = arch_address_space_create();
 
-    // Setup shms
-    task->memory_mapping = list_create();
-
     if (parent)
         task->_domain = parent->_domain;
 
     // Setup fildes
-    for (int i = 0; i < PROCESS_HANDLE_COUNT; i++)
-    {
-        parent->handles().pass(task->handles(), i, i);
-    }
+    parent->handles().pass_all(task->handles());
 
     memory_alloc(task->address_space, PROCESS_STACK_SIZE, MEMORY_CLEAR, (uintptr_t *)&task->kernel_stack);
     task->kernel_stack_pointer = ((uintptr_t)task->kernel_stack + PROCESS_STACK_SIZE);
 
-    list_foreach(MemoryMapping, mapping, parent->memory_mapping)
-    {
-        auto virtual_range = mapping->range();
-
-        auto physical_range = mapping->object->range();
-
-        void *buffer = malloc(physical_range.size());
-        assert(buffer);
-        assert(virtual_range.base());
-        memcpy(buffer, (void *)virtual_range.base(), virtual_range.size());
-
-        void *parent_address_space = task_switch_address_space(scheduler_running(), task->address_space);
-
-        task_memory_map(task, virtual_range.base(), virtual_range.size(), MEMORY_USER);
-        memcpy((void *)virtual_range.base(), buffer, virtual_range.size());
-
-        task_switch_address_space(scheduler_running(), parent_address_space);
-
-        free(buffer);
-    }
+    task_memory_clone(parent, task);
 
     task->user_stack_pointer = sp;
     task->entry_point = (TaskEntryPoint)ip;
     task->user = true;
 
+    arch_initialize_context(task);
+
     list_pushback(_tasks, task);
 
     task_go(task);
@@ -199,15 +183,13 @@ void task_destroy(Task *task)
 
     interrupts_release();
 
-    MemoryMapping *mapping = nullptr;
+    task_ring_destroy(task);
 
-    while ((mapping = (MemoryMapping *)list_peek(task->memory_mapping)))
+    while (task->memory_mappings)
     {
-        task_memory_mapping_destroy(task, mapping);
+        task_memory_mapping_destroy(task, task->memory_mappings);
     }
 
-    list_destroy(task->memory_mapping);
-
     memory_free(task->address_space, MemoryRange{(uintptr_t)task->kernel_stack, PROCESS_STACK_SIZE});
 
     if (task->address_space != arch_kernel_address_space())
@@ -220,18 +202,16 @@ void task_destroy(Task *task)
 
 void task_clear_userspace(Task *task)
 {
-    MemoryMapping *mapping = nullptr;
+    task_ring_destroy(task);
 
-    while ((mapping = (MemoryMapping *)list_peek(task->memory_mapping)))
+    while (task->memory_mappings)
     {
-        task_memory_mapping_destroy(task, mapping);
+        task_memory_mapping_destroy(task, task->memory_mappings);
     }
 
-    void *parent_address_space = task_switch_address_space(scheduler_running(), task->address_space);
     task_memory_map(task, 0xff000000, PROCESS_STACK_SIZE, MEMORY_CLEAR | MEMORY_USER);
     task->user_stack_pointer = 0xff000000 + PROCESS_STACK_SIZE;
     task->user_stack = (void *)0xff000000;
-    task_switch_address_space(scheduler_running(), parent_address_space);
 }
 
 void task_iterate(void *target, TaskIterateCallback callback)
@@ -344,6 +324,11 @@ Result task_wait(int task_id, int *exit_value)
     return task_block(scheduler_running(), blocker, -1);
 }
 
+static void task_blocker_timeout(Task *task)
+{
+    task->try_unblock();
+}
+
 Result task_block(Task *task, Blocker &blocker, Timeout timeout)
 {
     assert(!task->_blocker);
@@ -367,6 +352,13 @@ Result task_block(Task *task, Blocker &blocker, Timeout timeout)
 
     task->_blocker = &blocker;
     task->state(TASK_STATE_BLOCKED);
+    trace_record(TRACE_EVENT_BLOCK, task->id, timeout);
+    blocker.enqueue(*task);
+
+    if (blocker.has_deadline())
+    {
+        timer_arm(blocker.timer(), blocker.deadline(), (TimerCallback)task_blocker_timeout, task);
+    }
 
     interrupts_release();
     scheduler_yield();
@@ -385,13 +377,15 @@ void task_dump(Task *task)
 
     stream_format(out_stream, "\n\t - Task %d %s", task->id, task->name);
     stream_format(out_stream, "\n\t   State: %s", task_state_string(task->state()));
+    stream_format(out_stream, "\n\t   Page faults: %d demand, %d copy-on-write", task->demand_faults, task->cow_faults);
     stream_format(out_stream, "\n\t   Memory: ");
 
-    list_foreach(MemoryMapping, mapping, task->memory_mapping)
-    {
+    task_memory_mapping_iterate(task, nullptr, [](void *, MemoryMapping *mapping) {
         auto virtual_range = mapping->range();
         stream_format(out_stream, "\n\t   - %08x - %08x (%08x)", virtual_range.base(), virtual_range.end(), virtual_range.size());
-    }
+
+        return Iteration::CONTINUE;
+    });
 
     if (task->address_space == arch_kernel_address_space())
     {
@@ -8,12 +8,18 @@
 
 #include "kernel/memory/Memory.h"
 #include "kernel/scheduling/Blocker.h"
+#include "kernel/scheduling/WaitQueue.h"
+#include "kernel/system/Trace.h"
 
 #include "kernel/tasking/Domain.h"
 #include "kernel/tasking/Handles.h"
 
 typedef void (*TaskEntryPoint)();
 
+struct MemoryMapping;
+
+struct TaskRing;
+
 struct Task
 {
     int id;
@@ -28,6 +34,22 @@ struct Task
     TaskState _state;
     Blocker *_blocker;
 
+    int priority = 0;
+    Tick slice_used = 0;
+
+    // Level the task stays at instead of moving through the feedback queue,
+    // for the tasks running interrupt bottom halves. -1 for every others.
+    int fixed_priority = -1;
+
+    // Processor whose run queue holds this task.
+    int cpu = 0;
+    int interrupts_depth = 0;
+
+    Tick runtime_ticks = 0;
+    uint64_t runtime_cycles = 0;
+    uint64_t window_cycles = 0;
+    uint64_t usage_cycles = 0;
+
     uintptr_t user_stack_pointer;
     void *user_stack;
 
@@ -35,18 +57,46 @@ struct Task
     void *kernel_stack;
 
     TaskEntryPoint entry_point;
-    char fpu_registers[512];
 
-    List *memory_mapping;
+    // Saved FPU state, only written when the task used the FPU during its
+    // last time slice. `fpu_cpu` is the last processor it was loaded on.
+    char fpu_registers[512] __aligned(16);
+    int fpu_cpu = -1;
+
+    // Root of the index of our mappings, see kernel/tasking/Task-Memory.h.
+    MemoryMapping *memory_mappings = nullptr;
+    size_t memory_usage = 0;
+
     void *address_space;
 
+    // Task whose address space is loaded instead of ours while the
+    // kernel sets up its memory, see task_switch_address_space().
+    Task *address_space_owner = nullptr;
+
+    // Page faults handled by bringing in a page, or by copying
+    // memory shared copy-on-write with another task.
+    size_t demand_faults = 0;
+    size_t cow_faults = 0;
+
+    // Shared submission and completion rings, see kernel/tasking/Task-Ring.h.
+    TaskRing *ring = nullptr;
+
     int exit_value = 0;
 
     Handles _handles;
     Domain _domain;
 
+    // Tasks waiting for this one to exit.
+    WaitQueue _exit_wait_queue{};
+
     Handles &handles() { return _handles; }
     Domain &domain() { return _domain; }
+    WaitQueue &exit_wait_queue() { return _exit_wait_queue; }
+
+    void *current_address_space()
+    {
+        return address_space_owner ? address_space_owner->address_space : address_space;
+    }
 
     TaskState state();
 
@@ -54,22 +104,27 @@ struct Task
 
     Result cancel(int exit_value);
 
-    void try_unblock()
+    bool try_unblock()
     {
         if (_blocker->can_unblock(*this))
         {
             _blocker->unblock(*this);
-            state(TASK_STATE_RUNNING);
         }
         else if (_blocker->has_timeout())
         {
             _blocker->timeout(*this);
-            state(TASK_STATE_RUNNING);
         }
-        else if (_blocker->is_interrupted())
+        else if (!_blocker->is_interrupted())
         {
-            state(TASK_STATE_RUNNING);
+            return false;
         }
+
+        timer_disarm(_blocker->timer());
+        _blocker->dequeue(*this);
+        state(TASK_STATE_RUNNING);
+        trace_record(TRACE_EVENT_UNBLOCK, id, _blocker->result());
+
+        return true;
     }
 
     void begin_syscall(Syscall current)
@@ -1,4 +1,5 @@
 #include "kernel/tasking/Tasking.h"
+#include "kernel/interrupts/Interupts.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
 #include "kernel/tasking/Task.h"
@@ -7,7 +8,8 @@ static Iteration destroy_task_if_canceled(void *target, Task *task)
 {
     __unused(target);
 
-    if (task->state() == TASK_STATE_CANCELED)
+    // Tasks canceled by another processor might not have been switched out yet.
+    if (task->state() == TASK_STATE_CANCELED && !scheduler_is_on_cpu(task))
     {
         task_destroy(task);
     }
@@ -24,15 +26,22 @@ void garbage_collector()
     }
 }
 
-void tasking_initialize()
+Task *tasking_create_idle_task()
 {
-    logger_info("Initializing tasking...");
+    InterruptsRetainer retainer;
 
-    Task *idle_task = task_spawn(nullptr, "idle", system_hang, nullptr, false);
+    Task *idle_task = task_spawn(nullptr, "idle", scheduler_idle, nullptr, false);
     task_go(idle_task);
     idle_task->state(TASK_STATE_HANG);
 
-    scheduler_did_create_idle_task(idle_task);
+    return idle_task;
+}
+
+void tasking_initialize()
+{
+    logger_info("Initializing tasking...");
+
+    scheduler_did_create_idle_task(tasking_create_idle_task());
 
     Task *kernel_task = task_spawn(nullptr, "system", nullptr, nullptr, false);
     task_go(kernel_task);
@@ -1,3 +1,8 @@
 #pragma once
 
+struct Task;
+
 void tasking_initialize();
+
+// Every processors run their own idle task when there is nothing else to do.
+Task *tasking_create_idle_task();
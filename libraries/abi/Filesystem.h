@@ -25,6 +25,7 @@ enum FileType
     FILE_TYPE_SOCKET,
     FILE_TYPE_CONNECTION,
     FILE_TYPE_TERMINAL,
+    FILE_TYPE_POLLER,
 };
 
 #define OPEN_READ (1 << 0)
@@ -38,6 +39,7 @@ enum FileType
 #define OPEN_SOCKET (1 << 8)
 #define OPEN_CLIENT (1 << 9)
 #define OPEN_SERVER (1 << 10)
+#define OPEN_SEQPACKET (1 << 11)
 
 typedef unsigned int OpenFlag;
 
@@ -25,6 +25,33 @@ struct HandlePoll
     PollEvent result;
 };
 
+// Connections of sockets opened with OPEN_SEQPACKET keep the boundaries of
+// messages. Each one is sent with the handles and the memory it carries,
+// and received as a whole, with new handles and mappings for the receiver.
+#define HANDLE_MESSAGE_MAX_SIZE (4096)
+#define HANDLE_MESSAGE_MAX_HANDLES (8)
+#define HANDLE_MESSAGE_MAX_MEMORIES (4)
+
+struct HandleMessageMemory
+{
+    uintptr_t address;
+    size_t size;
+};
+
+struct HandleMessage
+{
+    // Sent as is, received up to `size`, the rest of longer messages is dropped.
+    void *buffer;
+    size_t size;
+
+    int handles[HANDLE_MESSAGE_MAX_HANDLES];
+    size_t handles_count;
+
+    // Whole mappings of the sender, the size is ignored when sending.
+    HandleMessageMemory memories[HANDLE_MESSAGE_MAX_MEMORIES];
+    size_t memories_count;
+};
+
 #define HANDLE_INVALID_ID (-1)
 
 #define HANDLE(__subclass) ((Handle *)(__subclass))
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <abi/Handle.h>
 #include <abi/Network.h>
 
 struct IOCallTerminalSizeArgs
@@ -45,6 +46,24 @@ struct IOCallNetworkSateAgs
     MacAddress mac_address;
 };
 
+struct IOCallTraceStateArgs
+{
+    bool running;
+
+    // Records kept per processor, the oldest ones are overwritten.
+    size_t size;
+};
+
+// Add or change the interest of a poller in one of the handles of the task.
+// Level triggered handles are reported by every read as long as they are
+// ready, edge triggered ones only once each time their state changes.
+struct IOCallPollerArgs
+{
+    int handle;
+    PollEvent events;
+    bool edge_triggered;
+};
+
 enum IOCall
 {
     IOCALL_TERMINAL_GET_SIZE,
@@ -62,5 +81,13 @@ enum IOCall
 
     IOCALL_NETWORK_GET_STATE,
 
+    IOCALL_TRACE_START,
+    IOCALL_TRACE_STOP,
+    IOCALL_TRACE_GET_STATE,
+    IOCALL_TRACE_SET_SIZE,
+
+    IOCALL_POLLER_ADD,
+    IOCALL_POLLER_REMOVE,
+
     __IOCALL_COUNT,
 };
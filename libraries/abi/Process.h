@@ -3,6 +3,9 @@
 #define PROCESS_NAME_SIZE 128
 #define PROCESS_STACK_SIZE 65536
 #define PROCESS_ARG_COUNT 128
+// Handles given to a task when it's launched.
 #define PROCESS_HANDLE_COUNT 128
+// Handles a task can have open at once, the table grows up to that.
+#define PROCESS_HANDLE_MAX 16384
 #define PROCESS_SUCCESS (0)
 #define PROCESS_FAILURE (1)
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <libsystem/Common.h>
+#include <libsystem/Result.h>
+
+#include <abi/Handle.h>
+
+// A task can share a ring of submissions and a ring of completions with the
+// kernel, so it can queue many operations on its handles and run them all
+// with a single HJ_RING_ENTER.
+//
+// The memory starts with a RingHeader, followed by the array of submissions
+// then the array of completions. Each side only moves its own index: the task
+// produces submissions and consumes completions, the kernel does the opposite.
+// Indexes wrap around UINT32_MAX, entries are at `index & (count - 1)`.
+
+#define RING_MAX_ENTRIES 256
+
+enum RingOperation
+{
+    RING_NOP,
+
+    // Like hj_handle_read() and hj_handle_write() on `buffer` and `size`,
+    // `value` is how much was moved. They block like the syscalls would.
+    RING_READ,
+    RING_WRITE,
+
+    // Completes once one of `events` happens on `handle`, `value` tells which.
+    // Polls stay pending in the kernel across enters until they complete,
+    // closing the handle completes them with ERR_BAD_HANDLE.
+    RING_POLL,
+
+    // Complete the pending polls on `handle` with INTERRUPTED, each with its
+    // own completion, after this one. `value` is how many were canceled.
+    RING_POLL_CANCEL,
+
+    // `value` is the new handle, `buffer` and `size` is the path to connect to.
+    RING_ACCEPT,
+    RING_CONNECT,
+
+    __RING_OPERATION_COUNT,
+};
+
+struct RingSubmission
+{
+    // Handed back as is in the completion.
+    uint64_t user_data;
+
+    uint32_t operation;
+    int handle;
+
+    uintptr_t buffer;
+    size_t size;
+
+    PollEvent events;
+};
+
+struct RingCompletion
+{
+    uint64_t user_data;
+
+    Result result;
+    size_t value;
+};
+
+struct RingHeader
+{
+    uint32_t submission_head;
+    uint32_t submission_tail;
+    uint32_t submission_count;
+
+    uint32_t completion_head;
+    uint32_t completion_tail;
+    uint32_t completion_count;
+};
+
+static inline RingSubmission *ring_submissions(RingHeader *header)
+{
+    return reinterpret_cast<RingSubmission *>(header + 1);
+}
+
+static inline RingCompletion *ring_completions(RingHeader *header)
+{
+    return reinterpret_cast<RingCompletion *>(ring_submissions(header) + header->submission_count);
+}
+
+static inline size_t ring_size(size_t submission_count, size_t completion_count)
+{
+    return sizeof(RingHeader) +
+           sizeof(RingSubmission) * submission_count +
+           sizeof(RingCompletion) * completion_count;
+}
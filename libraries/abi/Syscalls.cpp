@@ -81,6 +81,11 @@ Result hj_memory_get_handle(uintptr_t address, int *out_handle)
     return __syscall(HJ_MEMORY_GET_HANDLE, address, (uintptr_t)out_handle);
 }
 
+Result hj_memory_map_handle(int handle, size_t offset, size_t size, int flags, uintptr_t *out_address)
+{
+    return __syscall(HJ_MEMORY_MAP_HANDLE, (uintptr_t)handle, offset, size, flags, (uintptr_t)out_address);
+}
+
 Result hj_filesystem_mkdir(const char *raw_path, size_t size)
 {
     return __syscall(HJ_FILESYSTEM_MKDIR, (uintptr_t)raw_path, (uintptr_t)size);
@@ -139,6 +144,11 @@ Result hj_system_tick(uint32_t *tick)
     return __syscall(HJ_SYSTEM_TICKS, (uintptr_t)tick);
 }
 
+Result hj_system_clock(uint64_t *nanoseconds)
+{
+    return __syscall(HJ_SYSTEM_CLOCK, (uintptr_t)nanoseconds);
+}
+
 Result hj_system_reboot()
 {
     return __syscall(HJ_SYSTEM_REBOOT);
@@ -159,6 +169,11 @@ Result hj_create_term(int *server_handle, int *client_handle)
     return __syscall(HJ_CREATE_TERM, (uintptr_t)server_handle, (uintptr_t)client_handle);
 }
 
+Result hj_create_poller(int *handle)
+{
+    return __syscall(HJ_CREATE_POLLER, (uintptr_t)handle);
+}
+
 Result hj_handle_open(int *handle, const char *raw_path, size_t size, OpenFlag flags)
 {
     return __syscall(HJ_HANDLE_OPEN, (uintptr_t)handle, (uintptr_t)raw_path, (uintptr_t)size, flags);
@@ -194,6 +209,11 @@ Result hj_handle_write(int handle, const void *buffer, size_t size, size_t *writ
     return __syscall(HJ_HANDLE_WRITE, (uintptr_t)handle, (uintptr_t)buffer, (uintptr_t)size, (uintptr_t)written);
 }
 
+Result hj_handle_splice(int source, int destination, size_t size, size_t *spliced)
+{
+    return __syscall(HJ_HANDLE_SPLICE, (uintptr_t)source, (uintptr_t)destination, (uintptr_t)size, (uintptr_t)spliced);
+}
+
 Result hj_handle_call(int handle, IOCall request, void *args)
 {
     return __syscall(HJ_HANDLE_CALL, (uintptr_t)handle, (uintptr_t)request, (uintptr_t)args);
@@ -221,3 +241,38 @@ Result hj_handle_accept(int handle, int *connection_handle)
         (uintptr_t)handle,
         (uintptr_t)connection_handle);
 }
+
+Result hj_handle_send(int handle, const HandleMessage *message)
+{
+    return __syscall(
+        HJ_HANDLE_SEND,
+        (uintptr_t)handle,
+        (uintptr_t)message);
+}
+
+Result hj_handle_receive(int handle, HandleMessage *message)
+{
+    return __syscall(
+        HJ_HANDLE_RECEIVE,
+        (uintptr_t)handle,
+        (uintptr_t)message);
+}
+
+Result hj_handle_exchange(int handle, const HandleMessage *request, HandleMessage *reply)
+{
+    return __syscall(
+        HJ_HANDLE_EXCHANGE,
+        (uintptr_t)handle,
+        (uintptr_t)request,
+        (uintptr_t)reply);
+}
+
+Result hj_ring_setup(size_t entries, uintptr_t *out_address)
+{
+    return __syscall(HJ_RING_SETUP, (uintptr_t)entries, (uintptr_t)out_address);
+}
+
+Result hj_ring_enter(size_t to_submit, size_t min_complete, Timeout timeout)
+{
+    return __syscall(HJ_RING_ENTER, (uintptr_t)to_submit, (uintptr_t)min_complete, (uintptr_t)timeout);
+}
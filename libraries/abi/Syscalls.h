@@ -25,6 +25,7 @@
     __ENTRY(HJ_MEMORY_FREE)       \
     __ENTRY(HJ_MEMORY_INCLUDE)    \
     __ENTRY(HJ_MEMORY_GET_HANDLE) \
+    __ENTRY(HJ_MEMORY_MAP_HANDLE) \
     __ENTRY(HJ_FILESYSTEM_LINK)   \
     __ENTRY(HJ_FILESYSTEM_UNLINK) \
     __ENTRY(HJ_FILESYSTEM_RENAME) \
@@ -34,6 +35,7 @@
     __ENTRY(HJ_SYSTEM_STATUS)     \
     __ENTRY(HJ_SYSTEM_TIME)       \
     __ENTRY(HJ_SYSTEM_TICKS)      \
+    __ENTRY(HJ_SYSTEM_CLOCK)      \
     __ENTRY(HJ_SYSTEM_REBOOT)     \
     __ENTRY(HJ_SYSTEM_SHUTDOWN)   \
     __ENTRY(HJ_HANDLE_OPEN)       \
@@ -43,13 +45,20 @@
     __ENTRY(HJ_HANDLE_POLL)       \
     __ENTRY(HJ_HANDLE_READ)       \
     __ENTRY(HJ_HANDLE_WRITE)      \
+    __ENTRY(HJ_HANDLE_SPLICE)     \
     __ENTRY(HJ_HANDLE_CALL)       \
     __ENTRY(HJ_HANDLE_SEEK)       \
     __ENTRY(HJ_HANDLE_STAT)       \
     __ENTRY(HJ_HANDLE_CONNECT)    \
     __ENTRY(HJ_HANDLE_ACCEPT)     \
+    __ENTRY(HJ_HANDLE_SEND)       \
+    __ENTRY(HJ_HANDLE_RECEIVE)    \
+    __ENTRY(HJ_HANDLE_EXCHANGE)   \
     __ENTRY(HJ_CREATE_PIPE)       \
-    __ENTRY(HJ_CREATE_TERM)
+    __ENTRY(HJ_CREATE_TERM)       \
+    __ENTRY(HJ_CREATE_POLLER)     \
+    __ENTRY(HJ_RING_SETUP)        \
+    __ENTRY(HJ_RING_ENTER)
 
 #define SYSCALL_ENUM_ENTRY(__entry) __entry,
 
@@ -126,6 +135,7 @@ Result hj_memory_map(uintptr_t address, size_t size, int flags);
 Result hj_memory_free(uintptr_t address);
 Result hj_memory_include(int handle, uintptr_t *out_address, size_t *out_size);
 Result hj_memory_get_handle(uintptr_t address, int *out_handle);
+Result hj_memory_map_handle(int handle, size_t offset, size_t size, int flags, uintptr_t *out_address);
 
 Result hj_filesystem_mkdir(const char *raw_path, size_t size);
 Result hj_filesystem_mkpipe(const char *raw_path, size_t size);
@@ -137,11 +147,13 @@ Result hj_system_info(SystemInfo *info);
 Result hj_system_status(SystemStatus *status);
 Result hj_system_time(TimeStamp *timestamp);
 Result hj_system_tick(uint32_t *tick);
+Result hj_system_clock(uint64_t *nanoseconds);
 Result hj_system_reboot();
 Result hj_system_shutdown();
 
 Result hj_create_pipe(int *reader_handle, int *writer_handle);
 Result hj_create_term(int *server_handle, int *client_handle);
+Result hj_create_poller(int *handle);
 
 Result hj_handle_open(int *handle, const char *raw_path, size_t size, OpenFlag flags);
 Result hj_handle_close(int handle);
@@ -150,10 +162,17 @@ Result hj_handle_copy(int source, int destination);
 Result hj_handle_poll(HandlePoll *handles, size_t count, Timeout timeout);
 Result hj_handle_read(int handle, void *buffer, size_t size, size_t *read);
 Result hj_handle_write(int handle, const void *buffer, size_t size, size_t *written);
+Result hj_handle_splice(int source, int destination, size_t size, size_t *spliced);
 Result hj_handle_call(int handle, IOCall request, void *args);
 Result hj_handle_seek(int handle, ssize64_t *offset, HjWhence whence, ssize64_t *result);
 Result hj_handle_stat(int handle, FileState *state);
 Result hj_handle_connect(int *handle, const char *raw_path, size_t size);
 Result hj_handle_accept(int handle, int *connection_handle);
+Result hj_handle_send(int handle, const HandleMessage *message);
+Result hj_handle_receive(int handle, HandleMessage *message);
+Result hj_handle_exchange(int handle, const HandleMessage *request, HandleMessage *reply);
+
+Result hj_ring_setup(size_t entries, uintptr_t *out_address);
+Result hj_ring_enter(size_t to_submit, size_t min_complete, Timeout timeout);
 
 __END_HEADER
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+enum TraceEvent
+{
+    // `task` gave the processor to the task `arg0`, it was left in state `arg1`.
+    TRACE_EVENT_SWITCH,
+
+    // `task` blocked, with a timeout of `arg0` ticks (-1 for none).
+    TRACE_EVENT_BLOCK,
+
+    // `task` was unblocked, `arg0` is the result of the blocker.
+    TRACE_EVENT_UNBLOCK,
+
+    // `task` entered the syscall `arg0`.
+    TRACE_EVENT_SYSCALL_ENTER,
+
+    // `task` returned `arg1` from the syscall `arg0`.
+    TRACE_EVENT_SYSCALL_EXIT,
+
+    // The interrupt `arg0` was raised while `task` was running.
+    TRACE_EVENT_INTERRUPT,
+
+    __TRACE_EVENT_COUNT,
+};
+
+// Reading the trace node returns an array of these, the records of each
+// processor are in chronological order but processors follow each others.
+struct TraceRecord
+{
+    uint64_t timestamp; // Nanoseconds since boot.
+
+    uint16_t event;
+    uint16_t cpu;
+    int task;
+
+    uint32_t arg0;
+    uint32_t arg1;
+};
@@ -37,26 +37,9 @@ struct __packed TARRawBlock
     }
 };
 
-bool tar_read(void *tarfile, TARBlock *block, size_t index)
+bool tar_next(void **cursor, TARBlock *block)
 {
-    TARRawBlock *header = (TARRawBlock *)tarfile;
-
-    for (size_t i = 0; i < index; i++)
-    {
-        if (header->name[0] == '\0')
-        {
-            return false;
-        }
-
-        size_t size = header->file_size();
-
-        header = (TARRawBlock *)((char *)header + ((size / 512) + 1) * 512);
-
-        if (size % 512)
-        {
-            header = (TARRawBlock *)((char *)header + 512);
-        }
-    }
+    TARRawBlock *header = (TARRawBlock *)*cursor;
 
     if (header->name[0] == '\0')
     {
@@ -69,6 +52,21 @@ bool tar_read(void *tarfile, TARBlock *block, size_t index)
     memcpy(block->linkname, header->linkname, 100);
     block->data = (char *)header + 512;
 
+    *cursor = block->data + __align_up(block->size, 512);
+
+    return true;
+}
+
+bool tar_read(void *tarfile, TARBlock *block, size_t index)
+{
+    for (size_t i = 0; i <= index; i++)
+    {
+        if (!tar_next(&tarfile, block))
+        {
+            return false;
+        }
+    }
+
     return true;
 }
 
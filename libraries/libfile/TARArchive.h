@@ -11,6 +11,10 @@ struct TARBlock
     char *data;
 };
 
+// Read the entry at `cursor` and move it to the next one, walking the
+// whole archive this way only goes through each header once.
+bool tar_next(void **cursor, TARBlock *block);
+
 bool tar_read(void *tarfile, TARBlock *block, size_t index);
 
 class TARArchive : public Archive
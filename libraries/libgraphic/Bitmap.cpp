@@ -9,6 +9,7 @@
 #include <libgraphic/Bitmap.h>
 #include <libio/Copy.h>
 #include <libio/File.h>
+#include <libio/Mapping.h>
 #include <libsystem/Logger.h>
 #include <libsystem/system/Memory.h>
 
@@ -70,7 +71,7 @@ ResultOr<RefPtr<Bitmap>> Bitmap::load_from(String path)
         return ERR_NO_SUCH_FILE_OR_DIRECTORY;
     }
 
-    auto png_data = TRY(IO::read_all(file));
+    auto png_data = TRY(IO::map_all(file));
 
     unsigned int decoded_width = 0;
     unsigned int decoded_height = 0;
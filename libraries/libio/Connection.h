@@ -19,6 +19,8 @@ private:
 public:
     RefPtr<Handle> handle() override { return _handle; }
 
+    RawHandle *raw_handle() override { return this; }
+
     Connection() {}
     Connection(RefPtr<Handle> handle) : _handle{handle} {}
 
@@ -38,6 +40,32 @@ public:
         return _handle->write(buffer, size);
     }
 
+    // Whole messages, on connections of sockets opened with OPEN_SEQPACKET.
+    Result send(const HandleMessage &message)
+    {
+        if (!_handle)
+            return ERR_STREAM_CLOSED;
+
+        return _handle->send(message);
+    }
+
+    Result receive(HandleMessage &message)
+    {
+        if (!_handle)
+            return ERR_STREAM_CLOSED;
+
+        return _handle->receive(message);
+    }
+
+    // Send `request` and wait for the reply, the other side runs right away.
+    Result exchange(const HandleMessage &request, HandleMessage &reply)
+    {
+        if (!_handle)
+            return ERR_STREAM_CLOSED;
+
+        return _handle->exchange(request, reply);
+    }
+
     bool closed()
     {
         return _handle == nullptr;
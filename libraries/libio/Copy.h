@@ -4,6 +4,7 @@
 #include <libutils/Slice.h>
 #include <libutils/Vector.h>
 
+#include <libio/Handle.h>
 #include <libio/MemoryReader.h>
 #include <libio/MemoryWriter.h>
 
@@ -12,41 +13,50 @@ namespace IO
 
 constexpr int COPY_CHUNK_SIZE = 4096;
 
-static inline Result copy(Reader &from, Writer &to, size_t n)
+// Both ends are handles, the kernel moves the data from one node to the other.
+static inline Result splice(RefPtr<Handle> source, RefPtr<Handle> destination, Writer &to, size_t n)
 {
     size_t remaining = n;
 
-    do
+    while (remaining > 0)
     {
-        Array<uint8_t, COPY_CHUNK_SIZE> copy_chunk;
-
-        size_t read = TRY(from.read(copy_chunk.raw_storage(), MIN(COPY_CHUNK_SIZE, remaining)));
+        size_t spliced = TRY(source->splice(*destination, remaining));
 
-        if (read == 0)
+        if (spliced == 0)
         {
-            to.flush();
-            return SUCCESS;
+            break;
         }
 
-        size_t written = TRY(to.write(copy_chunk.raw_storage(), read));
+        remaining -= spliced;
+    }
 
-        remaining -= read;
+    to.flush();
+    return SUCCESS;
+}
 
-        if (written == 0 || remaining == 0)
+static inline Result copy(Reader &from, Writer &to, size_t n)
+{
+    if (from.raw_handle() && to.raw_handle())
+    {
+        auto source = from.raw_handle()->handle();
+        auto destination = to.raw_handle()->handle();
+
+        if (source && destination)
         {
-            to.flush();
-            return SUCCESS;
+            // Anything the writer kept must go out before what's spliced.
+            TRY(to.flush());
+
+            return splice(source, destination, to, n);
         }
-    } while (1);
-}
+    }
+
+    size_t remaining = n;
 
-static inline Result copy(Reader &from, Writer &to)
-{
     do
     {
         Array<uint8_t, COPY_CHUNK_SIZE> copy_chunk;
 
-        auto read = TRY(from.read(copy_chunk.raw_storage(), copy_chunk.count()));
+        size_t read = TRY(from.read(copy_chunk.raw_storage(), MIN(COPY_CHUNK_SIZE, remaining)));
 
         if (read == 0)
         {
@@ -54,9 +64,11 @@ static inline Result copy(Reader &from, Writer &to)
             return SUCCESS;
         }
 
-        auto written = TRY(to.write(copy_chunk.raw_storage(), read));
+        size_t written = TRY(to.write(copy_chunk.raw_storage(), read));
 
-        if (written == 0)
+        remaining -= read;
+
+        if (written == 0 || remaining == 0)
         {
             to.flush();
             return SUCCESS;
@@ -64,6 +76,11 @@ static inline Result copy(Reader &from, Writer &to)
     } while (1);
 }
 
+static inline Result copy(Reader &from, Writer &to)
+{
+    return copy(from, to, SIZE_MAX);
+}
+
 static inline ResultOr<Slice> read_all(Reader &reader)
 {
     MemoryWriter memory;
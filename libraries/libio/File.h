@@ -44,6 +44,8 @@ public:
 
     virtual RefPtr<Handle> handle() override { return _handle; }
 
+    RawHandle *raw_handle() override { return this; }
+
     bool exist();
 };
 
@@ -67,6 +67,14 @@ public:
         return data_written;
     }
 
+    // Move up to `size` bytes to `destination` without copying them to this task.
+    ResultOr<size_t> splice(Handle &destination, size_t size)
+    {
+        size_t spliced = 0;
+        _result = TRY(hj_handle_splice(_handle, destination.id(), size, &spliced));
+        return spliced;
+    }
+
     Result call(IOCall request, void *args)
     {
         _result = hj_handle_call(_handle, request, args);
@@ -102,6 +110,24 @@ public:
         return make<Handle>(connection_handle);
     }
 
+    Result send(const HandleMessage &message)
+    {
+        _result = hj_handle_send(_handle, &message);
+        return _result;
+    }
+
+    Result receive(HandleMessage &message)
+    {
+        _result = hj_handle_receive(_handle, &message);
+        return _result;
+    }
+
+    Result exchange(const HandleMessage &request, HandleMessage &reply)
+    {
+        _result = hj_handle_exchange(_handle, &request, &reply);
+        return _result;
+    }
+
     bool valid()
     {
         return _handle != HANDLE_INVALID_ID;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <abi/Memory.h>
+#include <abi/Syscalls.h>
+
+#include <libutils/Slice.h>
+
+#include <libio/Copy.h>
+#include <libio/File.h>
+
+namespace IO
+{
+
+// Pages of a file mapped read-only, they are shared with
+// the file itself and every other task mapping it.
+class MappingStorage final :
+    public Storage
+{
+private:
+    void *_data = nullptr;
+    size_t _size = 0;
+
+public:
+    using Storage::end;
+    using Storage::start;
+
+    void *start() override { return _data; }
+
+    void *end() override { return reinterpret_cast<char *>(start()) + _size; }
+
+    MappingStorage(void *data, size_t size) : _data(data), _size(size)
+    {
+    }
+
+    ~MappingStorage() override
+    {
+        hj_memory_free(reinterpret_cast<uintptr_t>(_data));
+    }
+};
+
+// The content of `file` without copying it, or read if it can't be mapped.
+static inline ResultOr<Slice> map_all(File &file)
+{
+    size_t size = TRY(file.length());
+
+    if (size > 0)
+    {
+        uintptr_t address = 0;
+
+        if (hj_memory_map_handle(file.handle()->id(), 0, size, MEMORY_READONLY, &address) == SUCCESS)
+        {
+            return Slice{make<MappingStorage>(reinterpret_cast<void *>(address), size)};
+        }
+    }
+
+    return read_all(file);
+}
+
+} // namespace IO
@@ -5,11 +5,16 @@
 namespace IO
 {
 
+struct RawHandle;
+
 struct Reader
 {
     virtual ~Reader() {}
 
     virtual ResultOr<size_t> read(void *buffer, size_t size) = 0;
+
+    // The handle read from, if any, see IO::copy().
+    virtual RawHandle *raw_handle() { return nullptr; }
 };
 
 template <typename T>
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <abi/Ring.h>
+#include <abi/Syscalls.h>
+
+#include <libutils/OwnPtr.h>
+#include <libutils/ResultOr.h>
+
+namespace IO
+{
+
+// Operations on handles queued in memory shared with the kernel, and run
+// in batches by enter(). A task can only have one ring at a time.
+class Ring
+{
+private:
+    RingHeader *_header = nullptr;
+
+    // Submissions are written at the tail, the kernel only sees them once it's published.
+    uint32_t _submission_tail = 0;
+
+    __noncopyable(Ring);
+    __nonmovable(Ring);
+
+    Ring(RingHeader *header) : _header(header)
+    {
+    }
+
+    bool push(const RingSubmission &submission)
+    {
+        uint32_t head = __atomic_load_n(&_header->submission_head, __ATOMIC_ACQUIRE);
+
+        if (_submission_tail - head == _header->submission_count)
+        {
+            // Hand what is already queued to the kernel to make room.
+            if (result_is_error(enter(0, 0)))
+            {
+                return false;
+            }
+
+            head = __atomic_load_n(&_header->submission_head, __ATOMIC_ACQUIRE);
+
+            if (_submission_tail - head == _header->submission_count)
+            {
+                return false;
+            }
+        }
+
+        ring_submissions(_header)[_submission_tail & (_header->submission_count - 1)] = submission;
+
+        _submission_tail++;
+        __atomic_store_n(&_header->submission_tail, _submission_tail, __ATOMIC_RELEASE);
+
+        return true;
+    }
+
+public:
+    static ResultOr<OwnPtr<Ring>> create(size_t entries)
+    {
+        uintptr_t address = 0;
+        TRY(hj_ring_setup(entries, &address));
+
+        return OwnPtr<Ring>{new Ring{reinterpret_cast<RingHeader *>(address)}};
+    }
+
+    ~Ring()
+    {
+        hj_memory_free(reinterpret_cast<uintptr_t>(_header));
+    }
+
+    bool nop(uint64_t user_data)
+    {
+        return push({user_data, RING_NOP, HANDLE_INVALID_ID, 0, 0, 0});
+    }
+
+    bool read(int handle, void *buffer, size_t size, uint64_t user_data)
+    {
+        return push({user_data, RING_READ, handle, reinterpret_cast<uintptr_t>(buffer), size, 0});
+    }
+
+    bool write(int handle, const void *buffer, size_t size, uint64_t user_data)
+    {
+        return push({user_data, RING_WRITE, handle, reinterpret_cast<uintptr_t>(buffer), size, 0});
+    }
+
+    bool poll(int handle, PollEvent events, uint64_t user_data)
+    {
+        return push({user_data, RING_POLL, handle, 0, 0, events});
+    }
+
+    bool cancel_polls(int handle, uint64_t user_data)
+    {
+        return push({user_data, RING_POLL_CANCEL, handle, 0, 0, 0});
+    }
+
+    bool accept(int handle, uint64_t user_data)
+    {
+        return push({user_data, RING_ACCEPT, handle, 0, 0, 0});
+    }
+
+    bool connect(const char *path, size_t size, uint64_t user_data)
+    {
+        return push({user_data, RING_CONNECT, HANDLE_INVALID_ID, reinterpret_cast<uintptr_t>(path), size, 0});
+    }
+
+    // Run everything queued, then wait at most `timeout` until `min_complete` completions are ready.
+    Result enter(size_t min_complete, Timeout timeout)
+    {
+        uint32_t head = __atomic_load_n(&_header->submission_head, __ATOMIC_ACQUIRE);
+
+        return hj_ring_enter(_submission_tail - head, min_complete, timeout);
+    }
+
+    // Call `callback` with each completion ready, they are consumed as it goes.
+    template <typename Callback>
+    void completions(Callback callback)
+    {
+        uint32_t head = _header->completion_head;
+        uint32_t tail = __atomic_load_n(&_header->completion_tail, __ATOMIC_ACQUIRE);
+
+        while (head != tail)
+        {
+            RingCompletion completion = ring_completions(_header)[head & (_header->completion_count - 1)];
+
+            head++;
+            __atomic_store_n(&_header->completion_head, head, __ATOMIC_RELEASE);
+
+            callback(completion);
+        }
+    }
+};
+
+} // namespace IO
@@ -20,6 +20,7 @@ public:
 
     ResultOr<size_t> read(void *buffer, size_t size) override { return _handle->read(buffer, size); }
     RefPtr<Handle> handle() override { return _handle; }
+    RawHandle *raw_handle() override { return this; }
 };
 
 class OutStream :
@@ -36,6 +37,7 @@ public:
 
     ResultOr<size_t> write(const void *buffer, size_t size) override { return _handle->write(buffer, size); }
     RefPtr<Handle> handle() override { return _handle; }
+    RawHandle *raw_handle() override { return this; }
 };
 
 class ErrStream :
@@ -53,6 +55,7 @@ public:
 
     ResultOr<size_t> write(const void *buffer, size_t size) override { return _handle->write(buffer, size); }
     RefPtr<Handle> handle() override { return _handle; }
+    RawHandle *raw_handle() override { return this; }
 };
 
 class LogStream :
@@ -69,6 +72,7 @@ public:
 
     ResultOr<size_t> write(const void *buffer, size_t size) override { return _handle->write(buffer, size); }
     RefPtr<Handle> handle() override { return _handle; }
+    RawHandle *raw_handle() override { return this; }
 };
 
 InStream &in();
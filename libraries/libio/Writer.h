@@ -5,6 +5,8 @@
 namespace IO
 {
 
+struct RawHandle;
+
 struct Writer
 {
     virtual ~Writer() {}
@@ -12,6 +14,9 @@ struct Writer
     virtual ResultOr<size_t> write(const void *buffer, size_t size) = 0;
 
     virtual Result flush() { return SUCCESS; }
+
+    // The handle written to, if any, see IO::copy().
+    virtual RawHandle *raw_handle() { return nullptr; }
 };
 
 template <typename T>
@@ -25,6 +25,19 @@ void __plug_logger_unlock();
 
 void __no_return __plug_logger_fatal();
 
+/* --- Lists ---------------------------------------------------------------- */
+
+#ifdef __KERNEL__
+
+struct ListItem;
+
+// The kernel recycles list items through a slab cache instead of the heap.
+ListItem *__plug_list_item_alloc();
+
+void __plug_list_item_free(ListItem *item);
+
+#endif
+
 /* --- File system ---------------------------------------------------------- */
 
 Result __plug_filesystem_link(const char *oldpath, const char *newpath);
@@ -39,6 +52,8 @@ TimeStamp __plug_system_get_time();
 
 Tick __plug_system_get_ticks();
 
+uint64_t __plug_system_get_clock();
+
 /* --- Processes ------------------------------------------------------------ */
 
 int __plug_process_this();
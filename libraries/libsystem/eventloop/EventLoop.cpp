@@ -1,3 +1,4 @@
+#include <libio/Ring.h>
 #include <libsystem/Logger.h>
 #include <libsystem/eventloop/EventLoop.h>
 #include <libsystem/eventloop/Invoker.h>
@@ -15,48 +16,370 @@ namespace EventLoop
 
 /* --- Notifiers ------------------------------------------------------------ */
 
-static Vector<Notifier *> _notifiers;
+// The notifiers of each handle, and every events they wait for, indexed by handle.
+static Vector<Vector<Notifier *>> _notifiers;
+static Vector<PollEvent> _events;
+
+// Only used without a poller, rebuilt from the events when they changed.
 static Vector<HandlePoll> _polls;
+static bool _polls_changed = false;
+
+static PollEvent &events_slot(Vector<PollEvent> &table, int handle)
+{
+    while (table.count() <= (size_t)handle)
+    {
+        table.push_back(0);
+    }
+
+    return table[handle];
+}
+
+static PollEvent events_in(Vector<PollEvent> &table, int handle)
+{
+    return (size_t)handle < table.count() ? table[handle] : 0;
+}
 
-void update_notifier()
+static PollEvent events_of(int handle)
 {
-    _polls.clear();
+    return events_in(_events, handle);
+}
 
-    for (Notifier *notifier : _notifiers)
+static Vector<Notifier *> &notifiers_of(int handle)
+{
+    while (_notifiers.count() <= (size_t)handle)
     {
-        _polls.push_back({
-            notifier->handle()->id(),
-            notifier->events(),
-            0,
-        });
+        _notifiers.push_back({});
     }
+
+    return _notifiers[handle];
+}
+
+static void poller_update(int handle);
+
+static void ring_update(int handle);
+
+// Only the notifiers of `handle` are looked at, the others didn't change.
+static void update_events(int handle)
+{
+    PollEvent events = 0;
+
+    for (Notifier *notifier : notifiers_of(handle))
+    {
+        events |= notifier->events();
+    }
+
+    events_slot(_events, handle) = events;
+    _polls_changed = true;
+
+    poller_update(handle);
+    ring_update(handle);
 }
 
 void register_notifier(Notifier *notifier)
 {
+    int handle = notifier->handle()->id();
 
-    _notifiers.push_back(notifier);
+    if (handle < 0)
+    {
+        return;
+    }
+
+    notifiers_of(handle).push_back(notifier);
 
-    update_notifier();
+    update_events(handle);
 }
 
 void unregister_notifier(Notifier *notifier)
 {
-    _notifiers.remove_all_value(notifier);
+    int handle = notifier->handle()->id();
+
+    if (handle < 0)
+    {
+        return;
+    }
+
+    notifiers_of(handle).remove_value(notifier);
+
+    update_events(handle);
+}
+
+void update_notifier(int handle, PollEvent event)
+{
+    // Callbacks can add or remove notifiers, so the list is looked up again each time.
+    for (size_t i = 0; i < notifiers_of(handle).count(); i++)
+    {
+        Notifier *notifier = notifiers_of(handle)[i];
+
+        if (notifier->events() & event)
+        {
+            notifier->invoke();
+        }
+    }
+}
+
+static Result poll_notifiers(Timeout timeout)
+{
+    if (_polls_changed)
+    {
+        _polls.clear();
+
+        for (size_t i = 0; i < _events.count(); i++)
+        {
+            if (_events[i])
+            {
+                _polls.push_back({(int)i, _events[i], 0});
+            }
+        }
+
+        _polls_changed = false;
+    }
+
+    Result result = hj_handle_poll(_polls.raw_storage(), _polls.count(), timeout);
+
+    if (result_is_error(result))
+    {
+        return result;
+    }
+
+    // Callbacks only mark the polls as changed, they are rebuilt on the next pump.
+    for (const HandlePoll &poll : _polls)
+    {
+        update_notifier(poll.handle, poll.result);
+    }
+
+    return SUCCESS;
+}
+
+/* --- Poller --------------------------------------------------------------- */
+
+#define POLLER_BATCH 32
+
+static int _poller = HANDLE_INVALID_ID;
+static bool _poller_unavailable = false;
+
+// The poller keeps the events of each handle between pumps,
+// so it's only told about the handles whose notifiers changed.
+static void poller_update(int handle)
+{
+    if (_poller == HANDLE_INVALID_ID)
+    {
+        return;
+    }
+
+    IOCallPollerArgs args = {handle, events_of(handle), false};
+
+    if (args.events)
+    {
+        hj_handle_call(_poller, IOCALL_POLLER_ADD, &args);
+    }
+    else
+    {
+        hj_handle_call(_poller, IOCALL_POLLER_REMOVE, &args);
+    }
+}
+
+static bool poller_setup()
+{
+    if (_poller != HANDLE_INVALID_ID)
+    {
+        return true;
+    }
+
+    if (_poller_unavailable)
+    {
+        return false;
+    }
+
+    Result result = hj_create_poller(&_poller);
+
+    if (result != SUCCESS)
+    {
+        logger_warn("Failed to create the poller: %s", result_to_string(result));
+
+        _poller = HANDLE_INVALID_ID;
+        _poller_unavailable = true;
+
+        return false;
+    }
+
+    // Notifiers registered before the poller existed.
+    for (size_t i = 0; i < _events.count(); i++)
+    {
+        if (_events[i])
+        {
+            poller_update(i);
+        }
+    }
+
+    return true;
+}
+
+static void poller_destroy()
+{
+    if (_poller != HANDLE_INVALID_ID)
+    {
+        hj_handle_close(_poller);
+    }
+
+    _poller = HANDLE_INVALID_ID;
+    _poller_unavailable = false;
+}
+
+static Result poller_poll_notifiers(Timeout timeout)
+{
+    HandlePoll poller = {_poller, POLL_READ, 0};
+
+    Result result = hj_handle_poll(&poller, 1, timeout);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    // Notifiers come and go from their callbacks, so the events are all read first.
+    HandlePoll polls[POLLER_BATCH];
+    size_t read = 0;
+
+    result = hj_handle_read(_poller, polls, sizeof(polls), &read);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    for (size_t i = 0; i < read / sizeof(HandlePoll); i++)
+    {
+        update_notifier(polls[i].handle, polls[i].result);
+    }
+
+    return SUCCESS;
+}
+
+/* --- Ring ----------------------------------------------------------------- */
+
+#define RING_ENTRIES 64
+#define RING_CANCEL_USER_DATA UINT64_MAX
+
+static OwnPtr<IO::Ring> _ring;
+
+// Polls stay pending in the kernel until they complete, indexed by handle,
+// these are the events of the pending poll, or zero if there is none.
+static Vector<PollEvent> _ring_polls;
+
+// Handles whose notifiers changed or whose poll completed since the last pump.
+static Vector<int> _ring_changed;
+
+static void ring_update(int handle)
+{
+    if (_ring)
+    {
+        _ring_changed.push_back(handle);
+    }
+}
+
+bool use_ring()
+{
+    auto result_or_ring = IO::Ring::create(RING_ENTRIES);
+
+    if (!result_or_ring.success())
+    {
+        logger_warn("Failed to setup the ring: %s", result_to_string(result_or_ring.result()));
+        return false;
+    }
+
+    _ring = result_or_ring.take_value();
+
+    // Notifiers registered before the ring existed.
+    for (size_t i = 0; i < _events.count(); i++)
+    {
+        if (_events[i])
+        {
+            ring_update(i);
+        }
+    }
+
+    return true;
+}
+
+// Only submit what changed since the last pump, what doesn't fit waits for the next one.
+static void ring_update_polls()
+{
+    Vector<int> unsubmitted;
+
+    for (int handle : _ring_changed)
+    {
+        PollEvent pending = events_in(_ring_polls, handle);
+        PollEvent events = events_of(handle);
 
-    update_notifier();
+        if (pending == events)
+        {
+            continue;
+        }
+
+        if (pending)
+        {
+            if (!_ring->cancel_polls(handle, RING_CANCEL_USER_DATA))
+            {
+                unsubmitted.push_back(handle);
+                continue;
+            }
+
+            events_slot(_ring_polls, handle) = 0;
+        }
+
+        if (events)
+        {
+            if (!_ring->poll(handle, events, handle))
+            {
+                unsubmitted.push_back(handle);
+                continue;
+            }
+
+            events_slot(_ring_polls, handle) = events;
+        }
+    }
+
+    _ring_changed = move(unsubmitted);
 }
 
-void update_notifier(int id, PollEvent event)
+static Result ring_poll_notifiers(Timeout timeout)
 {
-    for (size_t i = 0; i < _notifiers.count(); i++)
+    ring_update_polls();
+
+    Result result = _ring->enter(timeout == 0 ? 0 : 1, timeout);
+
+    if (result_is_error(result))
+    {
+        return result;
+    }
+
+    // Notifiers come and go from their callbacks, so the completions are all taken first.
+    Vector<RingCompletion> completions;
+
+    _ring->completions([&](const RingCompletion &completion) {
+        completions.push_back(completion);
+    });
+
+    for (const RingCompletion &completion : completions)
     {
-        if (_notifiers[i]->handle()->id() == id &&
-            _notifiers[i]->events() & event)
+        // Canceled polls were already replaced by the ones with the new events.
+        if (completion.user_data == RING_CANCEL_USER_DATA || completion.result == INTERRUPTED)
+        {
+            continue;
+        }
+
+        int handle = (int)completion.user_data;
+
+        events_slot(_ring_polls, handle) = 0;
+        ring_update(handle);
+
+        if (completion.result == SUCCESS)
         {
-            _notifiers[i]->invoke();
+            update_notifier(handle, completion.value);
         }
     }
+
+    return SUCCESS;
 }
 
 /* --- Timers --------------------------------------------------------------- */
@@ -145,6 +468,12 @@ void uninitialize()
 
     _atexit_hooks.clear();
 
+    _ring = nullptr;
+    _ring_polls.clear();
+    _ring_changed.clear();
+
+    poller_destroy();
+
     _is_initialize = false;
 }
 
@@ -195,16 +524,24 @@ void pump(bool pool)
         timeout = get_timeout();
     }
 
-    Result result = hj_handle_poll(_polls.raw_storage(), _polls.count(), timeout);
+    Result result;
 
-    if (result_is_error(result))
+    if (_ring)
     {
-        exit(PROCESS_FAILURE);
+        result = ring_poll_notifiers(timeout);
+    }
+    else if (poller_setup())
+    {
+        result = poller_poll_notifiers(timeout);
+    }
+    else
+    {
+        result = poll_notifiers(timeout);
     }
 
-    for (const HandlePoll &poll : _polls)
+    if (result_is_error(result))
     {
-        update_notifier(poll.handle, poll.result);
+        exit(PROCESS_FAILURE);
     }
 
     update_timers();
@@ -29,6 +29,12 @@ void register_invoker(Invoker *timer);
 
 void unregister_invoker(Invoker *timer);
 
+/* --- Ring ----------------------------------------------------------------- */
+
+// Wait for the notifiers through the ring of the task, see libio/Ring.h,
+// instead of the poller the loop uses otherwise. False if it can't be setup.
+bool use_ring();
+
 /* --- Loop ----------------------------------------------------------------- */
 
 using AtExitHook = void (*)(void);
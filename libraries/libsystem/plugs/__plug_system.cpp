@@ -10,3 +10,10 @@ Tick __plug_system_get_ticks()
     assert(hj_system_tick(&result) == SUCCESS);
     return result;
 }
+
+uint64_t __plug_system_get_clock()
+{
+    uint64_t result = 0;
+    assert(hj_system_clock(&result) == SUCCESS);
+    return result;
+}
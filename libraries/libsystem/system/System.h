@@ -3,3 +3,6 @@
 #include <abi/System.h>
 
 Tick system_get_ticks();
+
+// Monotonic time since boot in nanoseconds.
+uint64_t system_get_clock();
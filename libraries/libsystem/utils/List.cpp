@@ -1,7 +1,26 @@
 
+#include <libsystem/core/Plugs.h>
 #include <libsystem/utils/List.h>
 #include <string.h>
 
+static ListItem *list_item_create()
+{
+#ifdef __KERNEL__
+    return __plug_list_item_alloc();
+#else
+    return __create(ListItem);
+#endif
+}
+
+static void list_item_destroy(ListItem *item)
+{
+#ifdef __KERNEL__
+    __plug_list_item_free(item);
+#else
+    free(item);
+#endif
+}
+
 List *list_create()
 {
     List *list = __create(List);
@@ -34,7 +53,7 @@ void list_clear_with_callback(List *list, ListDestroyElementCallback callback)
             callback(current->value);
         }
 
-        free(current);
+        list_item_destroy(current);
 
         current = next;
     }
@@ -71,7 +90,7 @@ void list_insert_sorted(List *list, void *value, ListCompareElementCallback call
             current = current->next;
         }
 
-        ListItem *item = __create(ListItem);
+        ListItem *item = list_item_create();
 
         item->prev = current;
         item->next = current->next;
@@ -258,7 +277,7 @@ void list_insert(List *list, int index, void *value)
         }
     }
 
-    ListItem *item = __create(ListItem);
+    ListItem *item = list_item_create();
 
     item->prev = current;
     item->next = current->next;
@@ -276,7 +295,7 @@ void list_insert(List *list, int index, void *value)
 
 void list_push(List *list, void *value)
 {
-    ListItem *item = __create(ListItem);
+    ListItem *item = list_item_create();
 
     item->value = value;
 
@@ -322,12 +341,14 @@ bool list_pop(List *list, void **value)
         *value = item->value;
     }
 
+    list_item_destroy(item);
+
     return true;
 }
 
 void list_pushback(List *list, void *value)
 {
-    ListItem *item = __create(ListItem);
+    ListItem *item = list_item_create();
 
     item->prev = nullptr;
     item->next = nullptr;
@@ -382,6 +403,8 @@ bool list_popback(List *list, void **value)
         *value = item->value;
     }
 
+    list_item_destroy(item);
+
     return true;
 }
 
@@ -417,7 +440,7 @@ bool list_remove_with_callback(List *list, void *value, ListDestroyElementCallba
                 callback(item->value);
             }
 
-            free(item);
+            list_item_destroy(item);
 
             return true;
         }
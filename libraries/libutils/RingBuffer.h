@@ -82,6 +82,16 @@ public:
         return _used;
     }
 
+    size_t size() const
+    {
+        return _size;
+    }
+
+    size_t available() const
+    {
+        return _size - _used;
+    }
+
     void put(char c)
     {
         assert(!full());
@@ -104,19 +114,76 @@ public:
 
     char peek(size_t peek)
     {
-        int offset = (_tail + peek) % (_size);
+        size_t offset = (_tail + peek) % (_size);
 
         return _buffer[offset];
     }
 
+    struct Span
+    {
+        char *start;
+        size_t size;
+    };
+
+    // The data at the tail which is contiguous in memory, it stays in the
+    // buffer until commit_read() says how much of it was used.
+    Span peek_read()
+    {
+        if (empty())
+        {
+            return {_buffer, 0};
+        }
+
+        size_t size = _tail < _head ? _head - _tail : _size - _tail;
+
+        return {_buffer + _tail, size};
+    }
+
+    void commit_read(size_t size)
+    {
+        assert(size <= _used);
+
+        _tail = (_tail + size) % _size;
+        _used -= size;
+    }
+
+    // The free space at the head which is contiguous in memory, producers can
+    // fill it directly then commit_write() how much they wrote.
+    Span peek_write()
+    {
+        if (full())
+        {
+            return {_buffer, 0};
+        }
+
+        size_t size = _head < _tail ? _tail - _head : _size - _head;
+
+        return {_buffer + _head, size};
+    }
+
+    void commit_write(size_t size)
+    {
+        assert(size <= available());
+
+        _head = (_head + size) % _size;
+        _used += size;
+    }
+
+    // Data wraps around the end of the buffer at most once, so it's always
+    // moved in one or two copies.
     size_t read(char *buffer, size_t size)
     {
         size_t read = 0;
 
-        while (!empty() && read < size)
+        for (int i = 0; i < 2 && read < size; i++)
         {
-            buffer[read] = get();
-            read++;
+            Span span = peek_read();
+            size_t chunk = span.size < size - read ? span.size : size - read;
+
+            memcpy(buffer + read, span.start, chunk);
+            commit_read(chunk);
+
+            read += chunk;
         }
 
         return read;
@@ -126,12 +193,40 @@ public:
     {
         size_t written = 0;
 
-        while (!full() && written < size)
+        for (int i = 0; i < 2 && written < size; i++)
         {
-            put(buffer[written]);
-            written++;
+            Span span = peek_write();
+            size_t chunk = span.size < size - written ? span.size : size - written;
+
+            memcpy(span.start, buffer + written, chunk);
+            commit_write(chunk);
+
+            written += chunk;
         }
 
         return written;
     }
+
+    // Move the data to a bigger buffer, it starts back at the beginning of it.
+    void grow(size_t size)
+    {
+        if (size <= _size)
+        {
+            return;
+        }
+
+        char *buffer = new char[size];
+        size_t used = read(buffer, _used);
+
+        if (_buffer)
+        {
+            delete[] _buffer;
+        }
+
+        _buffer = buffer;
+        _size = size;
+        _used = used;
+        _tail = 0;
+        _head = used;
+    }
 };
@@ -77,13 +77,11 @@ void do_message(const CompositorMessage &message)
     }
 }
 
-ResultOr<CompositorMessage> wait_for_message(CompositorMessageType expected_message)
+// Messages coming before the expected one are handled once it's received.
+ResultOr<CompositorMessage> wait_for_message(CompositorMessage message, CompositorMessageType expected_message)
 {
     Vector<CompositorMessage> pendings;
 
-    CompositorMessage message{};
-    TRY(_connection.read(&message, sizeof(message)));
-
     while (message.type != expected_message)
     {
         pendings.push_back(move(message));
@@ -108,9 +106,31 @@ ResultOr<CompositorMessage> wait_for_message(CompositorMessageType expected_mess
     return message;
 }
 
-void wait_for_ack()
+ResultOr<CompositorMessage> wait_for_message(CompositorMessageType expected_message)
 {
-    wait_for_message(COMPOSITOR_MESSAGE_ACK);
+    CompositorMessage message{};
+    TRY(_connection.read(&message, sizeof(message)));
+
+    return wait_for_message(message, expected_message);
+}
+
+// The compositor gets the cpu as soon as the message is sent,
+// and the first message back comes with the same syscall.
+ResultOr<CompositorMessage> send_and_wait_for(CompositorMessage message, CompositorMessageType expected_message)
+{
+    CompositorMessage reply{};
+
+    HandleMessage request{};
+    request.buffer = &message;
+    request.size = sizeof(message);
+
+    HandleMessage response{};
+    response.buffer = &reply;
+    response.size = sizeof(reply);
+
+    TRY(_connection.exchange(request, response));
+
+    return wait_for_message(reply, expected_message);
 }
 
 bool show_wireframe()
@@ -174,8 +194,7 @@ void flip_window(Window *window, Recti dirty)
         },
     };
 
-    send_message(message);
-    wait_for_ack();
+    send_and_wait_for(message, COMPOSITOR_MESSAGE_ACK);
 }
 
 void move_window(Window *window, Vec2i position)
@@ -215,9 +234,7 @@ Vec2i mouse_position()
         .mouse_position = {},
     };
 
-    send_message(message);
-
-    auto result_or_mouse_position = wait_for_message(COMPOSITOR_MESSAGE_MOUSE_POSITION);
+    auto result_or_mouse_position = send_and_wait_for(message, COMPOSITOR_MESSAGE_MOUSE_POSITION);
 
     if (result_or_mouse_position.success())
     {
@@ -238,9 +255,7 @@ void goodbye()
         .mouse_position = {},
     };
 
-    send_message(m);
-
-    wait_for_ack();
+    send_and_wait_for(m, COMPOSITOR_MESSAGE_ACK);
 }
 
 /* --- Windows -------------------------------------------------------------- */
@@ -0,0 +1,80 @@
+#include <libutils/RingBuffer.h>
+#include <libtest/AssertEqual.h>
+#include <libtest/AssertFalse.h>
+#include <libtest/AssertTrue.h>
+
+#include "tests/Driver.h"
+
+TEST(ring_buffer_read_write)
+{
+    RingBuffer buffer{8};
+
+    assert_equal(buffer.write("hello", 5), 5u);
+    assert_equal(buffer.used(), 5u);
+
+    char data[8] = {};
+    assert_equal(buffer.read(data, 8), 5u);
+    assert_equal(String(data, 5), "hello");
+    assert_true(buffer.empty());
+}
+
+TEST(ring_buffer_wraps_around)
+{
+    RingBuffer buffer{8};
+
+    char data[8] = {};
+
+    buffer.write("abcdef", 6);
+    buffer.read(data, 4);
+
+    // Only 2 bytes are left before the end of the buffer.
+    assert_equal(buffer.write("ghijklmn", 8), 6u);
+    assert_true(buffer.full());
+
+    assert_equal(buffer.read(data, 8), 8u);
+    assert_equal(String(data, 8), "efghijkl");
+}
+
+TEST(ring_buffer_peek_and_commit)
+{
+    RingBuffer buffer{8};
+
+    char data[8] = {};
+
+    buffer.write("abcdef", 6);
+    buffer.read(data, 6);
+
+    auto writable = buffer.peek_write();
+    assert_equal(writable.size, 2u);
+
+    memcpy(writable.start, "xy", 2);
+    buffer.commit_write(2);
+
+    auto readable = buffer.peek_read();
+    assert_equal(readable.size, 2u);
+    assert_equal(String(readable.start, 2), "xy");
+
+    buffer.commit_read(1);
+    assert_equal(buffer.get(), 'y');
+    assert_true(buffer.empty());
+}
+
+TEST(ring_buffer_grow_keeps_data)
+{
+    RingBuffer buffer{4};
+
+    char data[8] = {};
+
+    buffer.write("abc", 3);
+    buffer.read(data, 2);
+    buffer.write("def", 3);
+
+    buffer.grow(8);
+
+    assert_equal(buffer.size(), 8u);
+    assert_false(buffer.full());
+    assert_equal(buffer.write("gh", 2), 2u);
+
+    assert_equal(buffer.read(data, 8), 6u);
+    assert_equal(String(data, 6), "cdefgh");
+}